@@ -0,0 +1,307 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/adaptive_blur_controller.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/capabilities.h"
+#include "glfc/framebuffer.h"
+#include "glfc/gaussian_blur_filter.h"
+#include "glfc/gl_handle.h"
+#include "glfc/opengl_hook.h"
+#include "glfc/trace.h"
+
+namespace {
+
+// The weight of a new sample in the smoothed cost.
+const float kAverageWeight = 0.2f;
+
+// The fraction of the budget under which the quality may be raised.
+const float kUpgradeThreshold = 0.5f;
+
+// The number of consecutive samples over the budget that lower the quality.
+const int kDowngradeSampleCount = 3;
+
+// The initial and maximum number of samples well under the budget required
+// before raising the quality.
+const int kInitialUpgradeSampleCount = 30;
+const int kMaxUpgradeSampleCount = 480;
+
+// A raised level lowered again within this number of samples doubles the
+// number of samples required for the next raise.
+const int kUnstableLevelSampleCount = 10;
+
+// The number of renders between CPU measurements. Each one waits for the
+// GPU to finish, so it shouldn't happen on every frame.
+const int kCpuSampleInterval = 8;
+
+// The number of timer queries in flight. Results usually arrive a frame or
+// two after the render.
+const int kNumberOfQueries = 4;
+
+#ifdef GLFC_GL3_API
+// The query target and state of `GL_EXT_disjoint_timer_query`, which share
+// their values with the desktop `GL_ARB_timer_query`.
+const GLenum kTimeElapsed = 0x88BF;  // GL_TIME_ELAPSED(_EXT)
+const GLenum kGpuDisjoint = 0x8FBB;  // GL_GPU_DISJOINT_EXT
+#endif
+
+}  // namespace
+
+namespace glfc {
+
+AdaptiveBlurController::AdaptiveBlurController()
+    : average_time_(-1), blur_radius_(2), filter_(new GaussianBlurFilter),
+      has_checked_timer_support_(false),
+      is_using_gpu_timer_(false), number_of_renders_since_sample_(0),
+      number_of_samples_over_budget_(0), number_of_samples_under_budget_(0),
+      number_of_samples_at_level_(0), quality_level_(0), sigma_(2),
+      target_time_(4), upgrade_sample_count_(kInitialUpgradeSampleCount),
+      was_quality_raised_(false) {
+  set_bounds(bounds_);
+}
+
+AdaptiveBlurController::~AdaptiveBlurController() {
+}
+
+void AdaptiveBlurController::AddSample(const float time) {
+  // The first render at a level includes compiling its shaders.
+  if (++number_of_samples_at_level_ == 1)
+    return;
+
+  if (average_time_ < 0)
+    average_time_ = time;
+  else
+    average_time_ += kAverageWeight * (time - average_time_);
+
+  if (average_time_ > target_time_) {
+    number_of_samples_under_budget_ = 0;
+    if (++number_of_samples_over_budget_ < kDowngradeSampleCount ||
+        quality_level_ + 1 >= number_of_quality_levels())
+      return;
+    // A level that was just raised but can't keep up makes the next raise
+    // more reluctant.
+    if (was_quality_raised_ &&
+        number_of_samples_at_level_ <= kUnstableLevelSampleCount) {
+      upgrade_sample_count_ = std::min(upgrade_sample_count_ * 2,
+                                       kMaxUpgradeSampleCount);
+    }
+    SetQualityLevel(quality_level_ + 1);
+    return;
+  }
+
+  number_of_samples_over_budget_ = 0;
+  if (average_time_ > target_time_ * kUpgradeThreshold) {
+    number_of_samples_under_budget_ = 0;
+    return;
+  }
+  if (++number_of_samples_under_budget_ < upgrade_sample_count_ ||
+      quality_level_ == 0)
+    return;
+  SetQualityLevel(quality_level_ - 1);
+  was_quality_raised_ = true;
+}
+
+void AdaptiveBlurController::ApplyQualityLevel() {
+  const AdaptiveQualityLevel& kLevel = GetCurrentQualityLevel();
+  // Spacing the taps by `m` covers the same extent with `1 / m` of the taps,
+  // so the radius and sigma are scaled down in kernel space.
+  const float kMultiplier = kLevel.texel_spacing_multiplier;
+  filter_->set_blur_radius(blur_radius_ / kMultiplier);
+  filter_->set_sigma(sigma_ / kMultiplier);
+  filter_->set_texel_spacing_multiplier(kMultiplier);
+}
+
+void AdaptiveBlurController::CollectQueryResults() {
+#ifdef GLFC_GL3_API
+  if (pending_queries_.empty())
+    return;
+
+  // Timings straddling a disjoint event, such as a frequency change, are
+  // meaningless. Reading the state also clears it.
+  GLint is_disjoint = GL_FALSE;
+  if (GetCapabilities().is_gles)
+    glGetIntegerv(kGpuDisjoint, &is_disjoint);
+
+  while (!pending_queries_.empty()) {
+    const PendingQuery kQuery = pending_queries_.front();
+    const GLuint kName = queries_[kQuery.index].get();
+    GLuint is_available = GL_FALSE;
+    glGetQueryObjectuiv(kName, GL_QUERY_RESULT_AVAILABLE, &is_available);
+    if (is_available == GL_FALSE)
+      break;
+
+    pending_queries_.pop_front();
+    GLuint elapsed_nanoseconds = 0;
+    glGetQueryObjectuiv(kName, GL_QUERY_RESULT, &elapsed_nanoseconds);
+    if (is_disjoint == GL_FALSE && kQuery.quality_level == quality_level_)
+      AddSample(elapsed_nanoseconds / 1000000.0f);
+  }
+#endif  // GLFC_GL3_API
+}
+
+bool AdaptiveBlurController::Render(const GLuint input_texture,
+                                    const float width, const float height,
+                                    const float device_pixel_ratio) {
+  GLFC_TRACE_SCOPE("AdaptiveBlurController::Render");
+  if (!has_checked_timer_support_) {
+    has_checked_timer_support_ = true;
+#ifdef GLFC_GL3_API
+    is_using_gpu_timer_ = GetCapabilities().supports_timer_queries;
+    for (int index = 0; is_using_gpu_timer_ && index < kNumberOfQueries;
+         ++index) {
+      queries_.push_back(QueryHandle::Create());
+    }
+#endif
+  }
+
+#ifdef GLFC_GL3_API
+  if (is_using_gpu_timer_) {
+    CollectQueryResults();
+    // Skips the measurement if every query is still in flight.
+    if (pending_queries_.size() >= queries_.size()) {
+      return RenderAtQualityLevel(input_texture, width, height,
+                                  device_pixel_ratio);
+    }
+    const int kIndex = pending_queries_.empty() ? \
+        0 : (pending_queries_.back().index + 1) % kNumberOfQueries;
+    glBeginQuery(kTimeElapsed, queries_[kIndex].get());
+    const bool kResult = RenderAtQualityLevel(input_texture, width, height,
+                                              device_pixel_ratio);
+    glEndQuery(kTimeElapsed);
+    pending_queries_.push_back({kIndex, quality_level_});
+    return kResult;
+  }
+#endif
+
+  // Without timer queries the render is timed on the CPU, which requires
+  // waiting for the GPU to finish. This stalls the pipeline, so only every
+  // few renders are measured, besides the first ones at a new level.
+  if (number_of_samples_at_level_ > 1 &&
+      ++number_of_renders_since_sample_ < kCpuSampleInterval) {
+    return RenderAtQualityLevel(input_texture, width, height,
+                                device_pixel_ratio);
+  }
+  number_of_renders_since_sample_ = 0;
+  glFinish();
+  const auto kStartTime = std::chrono::steady_clock::now();
+  const bool kResult = RenderAtQualityLevel(input_texture, width, height,
+                                            device_pixel_ratio);
+  glFinish();
+  const std::chrono::duration<float, std::milli> kElapsedTime = \
+      std::chrono::steady_clock::now() - kStartTime;
+  if (kResult)
+    AddSample(kElapsedTime.count());
+  return kResult;
+}
+
+bool AdaptiveBlurController::RenderAtQualityLevel(
+    const GLuint input_texture, const float width, const float height,
+    const float device_pixel_ratio) {
+  const int kDownsampleFactor = GetCurrentQualityLevel().downsample_factor;
+  if (kDownsampleFactor <= 1) {
+    framebuffer_.reset();
+    return filter_->Render(input_texture, width, height, device_pixel_ratio);
+  }
+
+  // Renders the blur at the reduced resolution and scales the result up to
+  // the original framebuffer with the original viewport.
+  const float kDevicePixelRatio = device_pixel_ratio / kDownsampleFactor;
+  const int kWidth = std::max(
+      1, static_cast<int>(std::round(width * kDevicePixelRatio)));
+  const int kHeight = std::max(
+      1, static_cast<int>(std::round(height * kDevicePixelRatio)));
+  if (framebuffer_ &&
+      (framebuffer_->width() != kWidth || framebuffer_->height() != kHeight)) {
+    framebuffer_.reset();
+  }
+  if (!framebuffer_) {
+    framebuffer_.reset(new Framebuffer(kWidth, kHeight));
+    if (!framebuffer_->Init()) {
+      framebuffer_.reset();
+#ifdef DEBUG
+      GLFC_LOG("!! Failed to initialize downsampling framebuffer.\n");
+#endif
+      return false;
+    }
+  }
+
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  framebuffer_->Bind();
+  framebuffer_->Clear();
+  const bool kResult = filter_->Render(input_texture, width, height,
+                                       kDevicePixelRatio);
+  framebuffer_->Unbind();
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  if (!kResult)
+    return false;
+
+  framebuffer_->Render();
+  return true;
+}
+
+void AdaptiveBlurController::SetQualityLevel(const int quality_level) {
+  quality_level_ = quality_level;
+  average_time_ = -1;
+  number_of_renders_since_sample_ = 0;
+  number_of_samples_at_level_ = 0;
+  number_of_samples_over_budget_ = 0;
+  number_of_samples_under_budget_ = 0;
+  was_quality_raised_ = false;
+  ApplyQualityLevel();
+}
+
+void AdaptiveBlurController::set_blur_radius(const float blur_radius) {
+  blur_radius_ = blur_radius;
+  upgrade_sample_count_ = kInitialUpgradeSampleCount;
+  SetQualityLevel(quality_level_);
+}
+
+void AdaptiveBlurController::set_bounds(const AdaptiveQualityBounds& bounds) {
+  bounds_ = bounds;
+  const float kMaxMultiplier = std::max(1.0f,
+                                        bounds.max_texel_spacing_multiplier);
+
+  // Orders the levels so that each one costs roughly half of the previous
+  // one. Spacing the taps is tried before each further downsampling since
+  // it keeps the full resolution of the edges.
+  quality_levels_.clear();
+  for (int factor = 1; factor <= std::max(1, bounds.max_downsample_factor);
+       factor *= 2) {
+    quality_levels_.push_back({factor, 1});
+    if (kMaxMultiplier > 1)
+      quality_levels_.push_back({factor, kMaxMultiplier});
+  }
+  upgrade_sample_count_ = kInitialUpgradeSampleCount;
+  SetQualityLevel(std::min(quality_level_, number_of_quality_levels() - 1));
+}
+
+void AdaptiveBlurController::set_sigma(const float sigma) {
+  sigma_ = sigma;
+  upgrade_sample_count_ = kInitialUpgradeSampleCount;
+  SetQualityLevel(quality_level_);
+}
+
+}  // namespace glfc
@@ -0,0 +1,207 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_ADAPTIVE_BLUR_CONTROLLER_H_
+#define GLFC_ADAPTIVE_BLUR_CONTROLLER_H_
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/gl_handle.h"
+#include "glfc/opengl_hook.h"
+
+namespace glfc {
+
+// Forward declarations.
+class Framebuffer;
+class GaussianBlurFilter;
+
+// The limits within which `AdaptiveBlurController` may lower the quality.
+struct AdaptiveQualityBounds {
+  AdaptiveQualityBounds()
+      : max_downsample_factor(4), max_texel_spacing_multiplier(2) {}
+
+  // The maximum factor by which the blur is rendered at a lower resolution,
+  // which is rounded down to a power of 2. 1 disables downsampling.
+  int max_downsample_factor;
+
+  // The maximum spacing between the taps of the kernel. Spacing the taps
+  // by a factor of `n` divides the number of taps by `n` for the same blur
+  // extent. 1 keeps every tap.
+  float max_texel_spacing_multiplier;
+};
+
+// A quality level of `AdaptiveBlurController`.
+struct AdaptiveQualityLevel {
+  // The factor by which the blur is rendered at a lower resolution.
+  int downsample_factor;
+
+  // The spacing between the taps of the kernel.
+  float texel_spacing_multiplier;
+};
+
+// This class renders a Gaussian blur within a time budget. It measures the
+// cost of each render, with GPU timer queries if the context supports them
+// and otherwise with the CPU time of every few renders including
+// `glFinish()`, and moves between quality levels to keep the smoothed cost
+// under `target_time()`.
+//
+// Level 0 is the full quality. Each following level roughly halves the cost
+// by spacing the taps or rendering at a lower resolution and scaling the
+// result up, within the caller-set bounds. The quality drops after a few
+// renders over the budget but only rises after many renders well under it,
+// and rises more reluctantly each time a raised level proves too slow, so
+// the controller doesn't oscillate between levels.
+//
+// The blur radius and sigma must be set through this class since it scales
+// them for the current level. Other parameters, such as color stages, can be
+// set on `filter()` directly.
+class AdaptiveBlurController {
+ public:
+  AdaptiveBlurController();
+  ~AdaptiveBlurController();
+
+  // Renders the blur with the same arguments as `Filter::Render()` and
+  // adjusts the quality for the next render. Returns `false` on failure.
+  bool Render(const GLuint input_texture, const float width,
+              const float height, const float device_pixel_ratio);
+
+  // Returns the current quality level. 0 is the full quality and
+  // `number_of_quality_levels() - 1` is the lowest.
+  int quality_level() const { return quality_level_; }
+
+  // Returns the parameters of the current quality level.
+  const AdaptiveQualityLevel& GetCurrentQualityLevel() const {
+    return quality_levels_[quality_level_];
+  }
+
+  // Returns the number of quality levels allowed by the bounds.
+  int number_of_quality_levels() const {
+    return static_cast<int>(quality_levels_.size());
+  }
+
+  // Setters and accessors.
+  float average_time() const { return average_time_; }
+  float blur_radius() const { return blur_radius_; }
+  void set_blur_radius(const float blur_radius);
+  const AdaptiveQualityBounds& bounds() const { return bounds_; }
+  void set_bounds(const AdaptiveQualityBounds& bounds);
+  GaussianBlurFilter* filter() const { return filter_.get(); }
+  bool is_using_gpu_timer() const { return is_using_gpu_timer_; }
+  float sigma() const { return sigma_; }
+  void set_sigma(const float sigma);
+  float target_time() const { return target_time_; }
+  void set_target_time(const float target_time) {
+    target_time_ = target_time;
+  }
+
+ private:
+  // A GPU timer query waiting for its result.
+  struct PendingQuery {
+    // The index of the query in `queries_`.
+    int index;
+    // The quality level measured by the query.
+    int quality_level;
+  };
+
+  // Applies the blur radius, sigma and texel spacing of the current level to
+  // the filter.
+  void ApplyQualityLevel();
+
+  // Records the cost in milliseconds of a render at the current level and
+  // changes the level if needed.
+  void AddSample(const float time);
+
+  // Reads the results of the completed timer queries.
+  void CollectQueryResults();
+
+  // Renders the blur at the current level.
+  bool RenderAtQualityLevel(const GLuint input_texture, const float width,
+                            const float height,
+                            const float device_pixel_ratio);
+
+  // Switches to `quality_level` and resets the measurements.
+  void SetQualityLevel(const int quality_level);
+
+  // The smoothed cost in milliseconds of the current level, or a negative
+  // value if it hasn't been measured yet.
+  float average_time_;
+
+  // The radius in points of the blur at full quality.
+  float blur_radius_;
+
+  // The bounds of the quality levels.
+  AdaptiveQualityBounds bounds_;
+
+  // The framebuffer holding downsampled results. This is only allocated when
+  // downsampling.
+  std::unique_ptr<Framebuffer> framebuffer_;
+
+  // The blur filter.
+  std::unique_ptr<GaussianBlurFilter> filter_;
+
+  // Indicates whether timer queries have been set up for the context.
+  bool has_checked_timer_support_;
+
+  // Indicates whether renders are measured with GPU timer queries.
+  bool is_using_gpu_timer_;
+
+  // The number of renders since the last CPU measurement.
+  int number_of_renders_since_sample_;
+
+  // The number of consecutive samples over the budget.
+  int number_of_samples_over_budget_;
+
+  // The number of consecutive samples well under the budget.
+  int number_of_samples_under_budget_;
+
+  // The number of samples taken at the current level.
+  int number_of_samples_at_level_;
+
+  // The queries waiting for results in the order they were issued.
+  std::deque<PendingQuery> pending_queries_;
+
+  // The timer queries used in turn.
+  std::vector<QueryHandle> queries_;
+
+  // The current quality level.
+  int quality_level_;
+
+  // The quality levels allowed by `bounds_` from the highest quality.
+  std::vector<AdaptiveQualityLevel> quality_levels_;
+
+  // The sigma in points of the blur at full quality.
+  float sigma_;
+
+  // The target cost of a render in milliseconds. The default value is 4.
+  float target_time_;
+
+  // The number of samples well under the budget required before raising the
+  // quality. This doubles whenever a raised level is lowered again shortly.
+  int upgrade_sample_count_;
+
+  // Indicates whether the current level was reached by raising the quality.
+  bool was_quality_raised_;
+
+  GLFC_DISALLOW_COPY_AND_ASSIGN(AdaptiveBlurController);
+};
+
+}  // namespace glfc
+
+#endif  // GLFC_ADAPTIVE_BLUR_CONTROLLER_H_
@@ -18,7 +18,7 @@
 #ifndef GLFC_BASE_H_
 #define GLFC_BASE_H_
 
-#if defined GLFC_APPLE
+#if defined GLFC_APPLE || defined GLFC_LINUX
 #include <cstdio>
 #elif defined GLFC_ANDROID
 #include <android/log.h>
@@ -26,7 +26,7 @@
 
 namespace glfc {
 
-#if defined GLFC_APPLE
+#if defined GLFC_APPLE || defined GLFC_LINUX
 #define GLFC_LOG(...) std::printf(__VA_ARGS__);
 #elif defined GLFC_ANDROID
 #define GLFC_LOG(...) __android_log_print(ANDROID_LOG_INFO, "glfc", __VA_ARGS__)
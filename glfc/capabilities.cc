@@ -0,0 +1,139 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/capabilities.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "glfc/base.h"
+#include "glfc/context_state.h"
+#include "glfc/opengl_hook.h"
+
+namespace {
+
+// The prefix of the `GL_VERSION` string of OpenGL ES contexts.
+const char* kGlesVersionPrefix = "OpenGL ES ";
+
+// The minimum number of varying vectors guaranteed by OpenGL ES 2.
+const int kMinNumberOfVaryingVectors = 8;
+
+// The OpenGL ES extension providing `GL_TIME_ELAPSED` queries.
+const char* kTimerQueryExtension = "GL_EXT_disjoint_timer_query";
+
+#ifdef GLFC_GL3_API
+// Returns `true` if the current context supports the extension `name`.
+bool HasExtension(const char* name) {
+  GLint number_of_extensions = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &number_of_extensions);
+  for (GLint index = 0; index < number_of_extensions; ++index) {
+    const char* extension = reinterpret_cast<const char*>(
+        glGetStringi(GL_EXTENSIONS, index));
+    if (extension != nullptr && std::strcmp(extension, name) == 0)
+      return true;
+  }
+  return false;
+}
+#endif
+
+}  // namespace
+
+namespace glfc {
+
+Capabilities::Capabilities()
+    : is_gles(true), major_version(2),
+      max_varying_vectors(kMinNumberOfVaryingVectors), minor_version(0),
+      supports_3d_textures(false), supports_fence_sync(false),
+      supports_immutable_textures(false), supports_instancing(false),
+      supports_invalidate_framebuffer(false),
+      supports_pixel_buffer_objects(false), supports_red_textures(false),
+      supports_timer_queries(false), supports_vertex_array_objects(false) {
+}
+
+const Capabilities& GetCapabilities() {
+  static const Capabilities kDefaultCapabilities;
+  internal::ContextState* state = internal::GetCurrentContextState();
+  if (state == nullptr)
+    return kDefaultCapabilities;
+
+  if (!state->has_capabilities) {
+    state->capabilities = QueryCapabilities();
+    state->has_capabilities = true;
+  }
+  return state->capabilities;
+}
+
+Capabilities QueryCapabilities() {
+  Capabilities capabilities;
+  const char* version = reinterpret_cast<const char*>(
+      glGetString(GL_VERSION));
+  if (version == nullptr) {
+#ifdef DEBUG
+    GLFC_LOG("!! Failed to query OpenGL version.\n");
+#endif
+    return capabilities;
+  }
+  const char* version_number = std::strstr(version, kGlesVersionPrefix);
+  capabilities.is_gles = version_number != nullptr;
+  if (capabilities.is_gles)
+    version_number += std::strlen(kGlesVersionPrefix);
+  else
+    version_number = version;
+  if (std::sscanf(version_number, "%d.%d", &capabilities.major_version,
+                  &capabilities.minor_version) != 2) {
+    capabilities.major_version = capabilities.is_gles ? 2 : 1;
+    capabilities.minor_version = 0;
+  }
+
+#ifdef GL_MAX_VARYING_VECTORS
+  GLint max_varying_vectors = 0;
+  glGetIntegerv(GL_MAX_VARYING_VECTORS, &max_varying_vectors);
+  if (max_varying_vectors > kMinNumberOfVaryingVectors)
+    capabilities.max_varying_vectors = max_varying_vectors;
+#endif
+
+  const int kVersion = capabilities.major_version * 10 + \
+                       capabilities.minor_version;
+  if (capabilities.is_gles && kVersion >= 30)
+    capabilities.shading_language_version = "300 es";
+  else if (!capabilities.is_gles && kVersion >= 33)
+    capabilities.shading_language_version = "330";
+
+#ifdef GLFC_GL3_API
+  capabilities.supports_3d_textures = \
+      !capabilities.shading_language_version.empty();
+  capabilities.supports_fence_sync = \
+      capabilities.is_gles ? kVersion >= 30 : kVersion >= 32;
+  capabilities.supports_immutable_textures = \
+      capabilities.is_gles ? kVersion >= 30 : kVersion >= 42;
+  capabilities.supports_instancing = \
+      capabilities.is_gles ? kVersion >= 30 : kVersion >= 31;
+  capabilities.supports_pixel_buffer_objects = kVersion >= 30;
+  capabilities.supports_red_textures = kVersion >= 30;
+  capabilities.supports_timer_queries = \
+      capabilities.is_gles ? kVersion >= 30 && HasExtension(
+                                 kTimerQueryExtension) : kVersion >= 33;
+  capabilities.supports_vertex_array_objects = kVersion >= 30;
+#endif
+#ifdef GLFC_GLES3
+  capabilities.supports_invalidate_framebuffer = kVersion >= 30;
+#endif
+  return capabilities;
+}
+
+}  // namespace glfc
@@ -0,0 +1,94 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_CAPABILITIES_H_
+#define GLFC_CAPABILITIES_H_
+
+#include <string>
+
+namespace glfc {
+
+// Describes the features of an OpenGL context. glfc is compiled against one
+// set of headers but may run on an older context, such as an OpenGL ES 2
+// context created by an app built with the OpenGL ES 3 headers, so the fast
+// paths are selected at runtime from these capabilities. A feature is only
+// reported as supported if the headers also provide its API.
+struct Capabilities {
+  Capabilities();
+
+  // Indicates whether the context is OpenGL ES rather than desktop OpenGL.
+  bool is_gles;
+
+  // The major version of the context.
+  int major_version;
+
+  // The maximum number of four-component varying vectors.
+  int max_varying_vectors;
+
+  // The minor version of the context.
+  int minor_version;
+
+  // The argument of the `#version` directive of the shaders compiled by
+  // `Program`, which is "300 es" for OpenGL ES 3 and "330" for OpenGL 3.3
+  // and later. Shaders are compiled as written if this is empty.
+  std::string shading_language_version;
+
+  // Indicates whether 3D textures can be created and sampled by shaders
+  // written in GLSL ES 3.00.
+  bool supports_3d_textures;
+
+  // Indicates whether fences can be inserted with `glFenceSync()`.
+  bool supports_fence_sync;
+
+  // Indicates whether textures can be allocated with `glTexStorage2D()`.
+  bool supports_immutable_textures;
+
+  // Indicates whether instanced draws are supported.
+  bool supports_instancing;
+
+  // Indicates whether `glInvalidateFramebuffer()` is supported.
+  bool supports_invalidate_framebuffer;
+
+  // Indicates whether pixel buffer objects are supported and can be mapped
+  // with `glMapBufferRange()`.
+  bool supports_pixel_buffer_objects;
+
+  // Indicates whether textures can have the `GL_RED` and `GL_RG` formats,
+  // such as `GL_R8` textures.
+  bool supports_red_textures;
+
+  // Indicates whether the GPU time of commands can be measured with
+  // `GL_TIME_ELAPSED` queries, which requires OpenGL 3.3 or the
+  // `GL_EXT_disjoint_timer_query` extension on OpenGL ES 3.
+  bool supports_timer_queries;
+
+  // Indicates whether vertex array objects are supported.
+  bool supports_vertex_array_objects;
+};
+
+// Returns the capabilities of the context current on the calling thread.
+// They are queried on the first call with each context and kept until
+// `ForgetCurrentContext()` is called. The OpenGL ES 2 defaults are returned
+// without caching if no context is current.
+const Capabilities& GetCapabilities();
+
+// Queries the capabilities of the context current on the calling thread.
+Capabilities QueryCapabilities();
+
+}  // namespace glfc
+
+#endif  // GLFC_CAPABILITIES_H_
@@ -0,0 +1,202 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/color_stage.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "glfc/opengl_hook.h"
+#include "glfc/program.h"
+
+namespace {
+
+// The luminance weights of the Rec. 709 primaries used for saturation.
+const float kLuminanceWeights[3] = {0.2126f, 0.7152f, 0.0722f};
+
+// Returns the name of the uniform `suffix` of the stage at `index`.
+std::string GetUniformName(const int index, const char* suffix) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "colorStage%d%s", index, suffix);
+  return name;
+}
+
+}  // namespace
+
+namespace glfc {
+
+ColorStage::ColorStage(const ColorStageType type) : type_(type) {
+  std::memset(values_, 0, sizeof(values_));
+}
+
+ColorStage ColorStage::Add(const float red, const float green,
+                           const float blue, const float alpha) {
+  ColorStage stage(kColorStageTypeAdd);
+  stage.values_[0] = red;
+  stage.values_[1] = green;
+  stage.values_[2] = blue;
+  stage.values_[3] = alpha;
+  return stage;
+}
+
+void ColorStage::Apply(float rgba[4]) const {
+  switch (type_) {
+    case kColorStageTypeAdd:
+      for (int channel = 0; channel < 4; ++channel)
+        rgba[channel] += values_[channel];
+      break;
+    case kColorStageTypeColorMatrix: {
+      float result[4];
+      for (int row = 0; row < 4; ++row) {
+        const float* kRow = values_ + row * 5;
+        result[row] = kRow[0] * rgba[0] + kRow[1] * rgba[1] +
+                      kRow[2] * rgba[2] + kRow[3] * rgba[3] + kRow[4];
+      }
+      std::memcpy(rgba, result, sizeof(result));
+      break;
+    }
+    case kColorStageTypeMultiply:
+      for (int channel = 0; channel < 4; ++channel)
+        rgba[channel] *= values_[channel];
+      break;
+    case kColorStageTypePremultiply:
+      for (int channel = 0; channel < 3; ++channel)
+        rgba[channel] *= rgba[3];
+      break;
+    case kColorStageTypeUnpremultiply:
+      if (rgba[3] > 0) {
+        for (int channel = 0; channel < 3; ++channel)
+          rgba[channel] /= rgba[3];
+      }
+      break;
+  }
+}
+
+ColorStage ColorStage::Brightness(const float amount) {
+  return Add(amount, amount, amount, 0);
+}
+
+ColorStage ColorStage::ColorMatrix(const float matrix[20]) {
+  ColorStage stage(kColorStageTypeColorMatrix);
+  std::memcpy(stage.values_, matrix, sizeof(stage.values_));
+  return stage;
+}
+
+std::string ColorStage::GetShaderStatements(const int index) const {
+  switch (type_) {
+    case kColorStageTypeAdd:
+      return "  color += " + GetUniformName(index, "Vector") + ";\n";
+    case kColorStageTypeColorMatrix:
+      return "  color = " + GetUniformName(index, "Matrix") + " * color + " +
+             GetUniformName(index, "Vector") + ";\n";
+    case kColorStageTypeMultiply:
+      return "  color *= " + GetUniformName(index, "Vector") + ";\n";
+    case kColorStageTypePremultiply:
+      return "  color.rgb *= color.a;\n";
+    case kColorStageTypeUnpremultiply:
+      return "  if (color.a > 0.0) color.rgb /= color.a;\n";
+  }
+  return "";
+}
+
+std::string ColorStage::GetShaderUniforms(const int index) const {
+  switch (type_) {
+    case kColorStageTypeColorMatrix:
+      return "uniform mat4 " + GetUniformName(index, "Matrix") + ";\n"
+             "uniform vec4 " + GetUniformName(index, "Vector") + ";\n";
+    case kColorStageTypeAdd:
+    case kColorStageTypeMultiply:
+      return "uniform vec4 " + GetUniformName(index, "Vector") + ";\n";
+    default:
+      return "";
+  }
+}
+
+ColorStage ColorStage::Multiply(const float red, const float green,
+                                const float blue, const float alpha) {
+  ColorStage stage(kColorStageTypeMultiply);
+  stage.values_[0] = red;
+  stage.values_[1] = green;
+  stage.values_[2] = blue;
+  stage.values_[3] = alpha;
+  return stage;
+}
+
+ColorStage ColorStage::Opacity(const float opacity) {
+  return Multiply(opacity, opacity, opacity, opacity);
+}
+
+ColorStage ColorStage::Premultiply() {
+  return ColorStage(kColorStageTypePremultiply);
+}
+
+ColorStage ColorStage::Saturation(const float saturation) {
+  float matrix[20] = {0};
+  for (int row = 0; row < 3; ++row) {
+    for (int column = 0; column < 3; ++column) {
+      matrix[row * 5 + column] = (1 - saturation) * kLuminanceWeights[column];
+    }
+    matrix[row * 5 + row] += saturation;
+  }
+  matrix[18] = 1;
+  return ColorMatrix(matrix);
+}
+
+void ColorStage::SetUniforms(const int index, Program* program) const {
+  if (type_ == kColorStageTypeColorMatrix) {
+    // OpenGL ES expects column-major matrices and doesn't support
+    // transposing on upload.
+    GLfloat matrix[16];
+    GLfloat vector[4];
+    for (int row = 0; row < 4; ++row) {
+      for (int column = 0; column < 4; ++column)
+        matrix[column * 4 + row] = values_[row * 5 + column];
+      vector[row] = values_[row * 5 + 4];
+    }
+    glUniformMatrix4fv(glGetUniformLocation(
+                           program->program(),
+                           GetUniformName(index, "Matrix").c_str()),
+                       1, GL_FALSE, matrix);
+    glUniform4fv(glGetUniformLocation(program->program(),
+                                      GetUniformName(index, "Vector").c_str()),
+                 1, vector);
+  } else if (type_ == kColorStageTypeAdd ||
+             type_ == kColorStageTypeMultiply) {
+    glUniform4fv(glGetUniformLocation(program->program(),
+                                      GetUniformName(index, "Vector").c_str()),
+                 1, values_);
+  }
+}
+
+ColorStage ColorStage::Tint(const float red, const float green,
+                            const float blue, const float amount) {
+  const float kTint[3] = {red, green, blue};
+  float matrix[20] = {0};
+  for (int row = 0; row < 3; ++row) {
+    matrix[row * 5 + row] = 1 - amount;
+    matrix[row * 5 + 4] = kTint[row] * amount;
+  }
+  matrix[18] = 1;
+  return ColorMatrix(matrix);
+}
+
+ColorStage ColorStage::Unpremultiply() {
+  return ColorStage(kColorStageTypeUnpremultiply);
+}
+
+}  // namespace glfc
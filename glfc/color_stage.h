@@ -0,0 +1,134 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_COLOR_STAGE_H_
+#define GLFC_COLOR_STAGE_H_
+
+#include <string>
+
+namespace glfc {
+
+class Program;
+
+// The kinds of per-pixel color operations.
+enum ColorStageType {
+  // Adds a constant to each channel.
+  kColorStageTypeAdd,
+  // Transforms the color by a 4x5 matrix.
+  kColorStageTypeColorMatrix,
+  // Multiplies each channel by a constant.
+  kColorStageTypeMultiply,
+  // Multiplies the color channels by the alpha channel.
+  kColorStageTypePremultiply,
+  // Divides the color channels by the alpha channel.
+  kColorStageTypeUnpremultiply,
+};
+
+// A per-pixel color operation attached to a filter through
+// `Filter::set_color_stages()`. The stages are spliced into the fragment
+// shader of the filter's final pass, so they cost no extra pass or
+// intermediate texture.
+//
+// Stages only differing in parameters share the same shader, with the
+// parameters passed as uniforms, so animating a stage doesn't recompile the
+// program.
+//
+// Colors are in the [0, 1] range. Intermediate values aren't clamped between
+// stages, only the final result is when written to the framebuffer.
+//
+// Filters work on premultiplied colors. Stages that scale or linearly mix the
+// channels without a constant, such as `Multiply()`, `Opacity()` and
+// `Saturation()`, keep premultiplied colors valid. Stages that add a color
+// independent of alpha, namely `Add()`, `Brightness()`, `Tint()` and matrices
+// with a constant column, treat the color as straight alpha. Surround them
+// with `Unpremultiply()` and `Premultiply()` for translucent inputs, or the
+// result may exceed its alpha and transparent pixels gain color.
+class ColorStage {
+ public:
+  // Returns a stage adding the constants to the corresponded channels.
+  static ColorStage Add(const float red, const float green, const float blue,
+                        const float alpha);
+
+  // Returns a stage adding `amount` to the color channels. It expects
+  // straight alpha colors, see the class comment.
+  static ColorStage Brightness(const float amount);
+
+  // Returns a stage transforming the color by the row-major 4x5 `matrix`.
+  // Each row computes one channel of the result from the red, green, blue
+  // and alpha channels of the input plus a constant in the fifth column.
+  static ColorStage ColorMatrix(const float matrix[20]);
+
+  // Returns a stage multiplying the corresponded channels by the constants.
+  static ColorStage Multiply(const float red, const float green,
+                             const float blue, const float alpha);
+
+  // Returns a stage scaling all channels of premultiplied colors by
+  // `opacity`.
+  static ColorStage Opacity(const float opacity);
+
+  // Returns a stage multiplying the color channels by the alpha channel.
+  static ColorStage Premultiply();
+
+  // Returns a stage adjusting the saturation by `saturation`, where 0 gives
+  // grayscale and 1 keeps the color unchanged.
+  static ColorStage Saturation(const float saturation);
+
+  // Returns a stage mixing the color channels with the given color by
+  // `amount`, where 0 keeps the color unchanged. It expects straight alpha
+  // colors, see the class comment.
+  static ColorStage Tint(const float red, const float green, const float blue,
+                         const float amount);
+
+  // Returns a stage dividing the color channels by the alpha channel.
+  // Transparent colors are left unchanged.
+  static ColorStage Unpremultiply();
+
+  // Applies the stage to the `rgba` color in place, giving the same result
+  // as the shader.
+  void Apply(float rgba[4]) const;
+
+  // Returns the GLSL statements applying the stage to the `vec4 color`
+  // variable. The `index` identifies the stage's uniforms declared by
+  // `GetShaderUniforms()`.
+  std::string GetShaderStatements(const int index) const;
+
+  // Returns the GLSL declarations of the uniforms used by the statements
+  // returned by `GetShaderStatements()` with the same `index`.
+  std::string GetShaderUniforms(const int index) const;
+
+  // Sets the uniforms declared by `GetShaderUniforms()` with `index` for
+  // `program`, which must be in use.
+  void SetUniforms(const int index, Program* program) const;
+
+  // Accessors.
+  ColorStageType type() const { return type_; }
+
+ private:
+  explicit ColorStage(const ColorStageType type);
+
+  // The type of the operation.
+  ColorStageType type_;
+
+  // The parameters of the operation. For color matrices, these are the
+  // row-major 4x5 matrix. For adding and multiplying, the first four values
+  // are the per-channel constants. Other types have no parameters.
+  float values_[20];
+};
+
+}  // namespace glfc
+
+#endif  // GLFC_COLOR_STAGE_H_
@@ -0,0 +1,267 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/context_group.h"
+
+#ifdef GLFC_EGL
+
+#include <EGL/egl.h>
+
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "glfc/base.h"
+#include "glfc/context_state.h"
+#include "glfc/egl_context.h"
+#include "glfc/gl_handle.h"
+#include "glfc/opengl_hook.h"
+
+namespace {
+
+#ifdef GLFC_GL3_API
+typedef GLsync Fence;
+#else
+// Fences aren't available, each task finishes its commands instead.
+typedef void* Fence;
+#endif
+
+#ifdef GLFC_GL3_API
+// The timeout in nanoseconds of a single `glClientWaitSync()` call when
+// waiting for the commands of the tasks to finish.
+const GLuint64 kFenceWaitTimeout = 1000000000;
+
+// Deletes the fences at the front of `fences` that are signaled. Blocks until
+// all of them are signaled if `wait` is `true`. Returns the number of deleted
+// fences.
+int DeleteSignaledFences(const bool wait, std::deque<GLsync>* fences) {
+  int number_of_deleted_fences = 0;
+  while (!fences->empty()) {
+    // The flush bit guarantees the fence is eventually signaled even if the
+    // commands haven't been submitted yet.
+    GLenum result;
+    do {
+      result = glClientWaitSync(fences->front(), GL_SYNC_FLUSH_COMMANDS_BIT,
+                                wait ? kFenceWaitTimeout : 0);
+    } while (wait && result == GL_TIMEOUT_EXPIRED);
+    if (result == GL_TIMEOUT_EXPIRED)
+      break;
+
+    glDeleteSync(fences->front());
+    fences->pop_front();
+    ++number_of_deleted_fences;
+  }
+  return number_of_deleted_fences;
+}
+#endif  // GLFC_GL3_API
+
+}  // namespace
+
+namespace glfc {
+
+ContextGroup::ContextGroup(EGLDisplay display, EGLContext share_context,
+                           const int number_of_workers)
+    : display_(display), has_failed_worker_(false),
+      is_initialized_(false), number_of_pending_fences_(0),
+      number_of_unfinished_tasks_(0), number_of_waiters_(0),
+      number_of_workers_(number_of_workers), share_context_(share_context),
+      should_stop_(false) {
+}
+
+ContextGroup::~ContextGroup() {
+  if (is_initialized_)
+    Finalize();
+}
+
+bool ContextGroup::Init() {
+  if (is_initialized_)
+    Finalize();
+
+  if (number_of_workers_ <= 0)
+    return false;
+
+  // Creates the contexts. If there's no share context, all contexts share
+  // objects with the first one.
+  is_initialized_ = true;
+  for (int index = 0; index < number_of_workers_; ++index) {
+    EGLContext share_context = share_context_;
+    if (share_context == EGL_NO_CONTEXT && !contexts_.empty())
+      share_context = contexts_.front().context;
+    EglContext context;
+    if (!CreateEglContext(display_, share_context, &context)) {
+      Finalize();
+      return false;
+    }
+    contexts_.push_back(context);
+  }
+
+  // Starts the workers and waits until they all made their contexts current.
+  // The startup of each worker is counted as an unfinished task.
+  has_failed_worker_ = false;
+  should_stop_ = false;
+  number_of_unfinished_tasks_ = number_of_workers_;
+  worker_tasks_.resize(number_of_workers_);
+  for (int index = 0; index < number_of_workers_; ++index)
+    workers_.push_back(std::thread(&ContextGroup::RunWorker, this, index));
+  Wait();
+  if (has_failed_worker_) {
+    Finalize();
+#ifdef DEBUG
+    GLFC_LOG("!! Failed to make EGL context current for context group.\n");
+#endif
+    return false;
+  }
+  return true;
+}
+
+void ContextGroup::Finalize() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    should_stop_ = true;
+  }
+  queue_condition_.notify_all();
+  for (std::thread& worker : workers_)
+    worker.join();
+  workers_.clear();
+  worker_tasks_.clear();
+  shared_tasks_.clear();
+  number_of_pending_fences_ = 0;
+  number_of_unfinished_tasks_ = 0;
+
+  for (EglContext& context : contexts_)
+    DestroyEglContext(display_, &context);
+  contexts_.clear();
+  is_initialized_ = false;
+}
+
+void ContextGroup::RunOnEachWorker(const Task& task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::deque<Task>& tasks : worker_tasks_)
+      tasks.push_back(task);
+    number_of_unfinished_tasks_ += worker_tasks_.size();
+  }
+  queue_condition_.notify_all();
+}
+
+void ContextGroup::RunWorker(const int worker_index) {
+  const bool kIsCurrent = MakeEglContextCurrent(display_,
+                                                contexts_[worker_index]);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!kIsCurrent)
+      has_failed_worker_ = true;
+    if (--number_of_unfinished_tasks_ == 0)
+      tasks_finished_condition_.notify_all();
+  }
+  if (!kIsCurrent)
+    return;
+
+  // Objects released by a task are deleted once it completes.
+  DeletionQueue deletion_queue;
+  DeletionQueue::SetCurrent(&deletion_queue);
+  // The fences following the commands of the completed tasks, oldest first.
+  // The contexts are created for OpenGL ES 3 on GL3 API builds, so fences
+  // are always supported.
+  std::deque<Fence> fences;
+  std::deque<Task>& worker_tasks = worker_tasks_[worker_index];
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      queue_condition_.wait(lock, [&] {
+        return should_stop_ || !worker_tasks.empty() ||
+               !shared_tasks_.empty() ||
+               (number_of_waiters_ > 0 && !fences.empty());
+      });
+      // Pending tasks still run after stopping so per-worker objects can be
+      // destroyed with their context current.
+      std::deque<Task>& tasks = worker_tasks.empty() ? shared_tasks_ : \
+                                worker_tasks;
+      if (tasks.empty() && fences.empty())
+        break;
+
+      if (tasks.empty()) {
+#ifdef GLFC_GL3_API
+        // Waits for the commands of the completed tasks on behalf of
+        // `Wait()` once there's nothing else to run.
+        lock.unlock();
+        const int kNumberOfDeletedFences = DeleteSignaledFences(true,
+                                                                &fences);
+        lock.lock();
+        number_of_pending_fences_ -= kNumberOfDeletedFences;
+        if (number_of_unfinished_tasks_ == 0 &&
+            number_of_pending_fences_ == 0) {
+          tasks_finished_condition_.notify_all();
+        }
+#endif
+        continue;
+      }
+      task = tasks.front();
+      tasks.pop_front();
+    }
+
+    task(worker_index);
+    deletion_queue.Flush();
+    // Submits the commands without waiting for them, `Wait()` waits for the
+    // fence instead. Fences already signaled are deleted right away so they
+    // don't pile up between waits.
+#ifdef GLFC_GL3_API
+    glFlush();
+    fences.push_back(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+    const int kNumberOfAddedFences = 1 - DeleteSignaledFences(false,
+                                                              &fences);
+#else
+    glFinish();
+    const int kNumberOfAddedFences = 0;
+#endif
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    number_of_pending_fences_ += kNumberOfAddedFences;
+    if (--number_of_unfinished_tasks_ == 0 && number_of_pending_fences_ == 0)
+      tasks_finished_condition_.notify_all();
+  }
+  DeletionQueue::SetCurrent(nullptr);
+  deletion_queue.Flush();
+  ForgetCurrentContext();
+  eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  eglReleaseThread();
+}
+
+void ContextGroup::Submit(const Task& task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    shared_tasks_.push_back(task);
+    ++number_of_unfinished_tasks_;
+  }
+  queue_condition_.notify_one();
+}
+
+void ContextGroup::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  // Idle workers only wait for their fences while someone is waiting.
+  ++number_of_waiters_;
+  queue_condition_.notify_all();
+  tasks_finished_condition_.wait(lock, [this] {
+    return number_of_unfinished_tasks_ == 0 && number_of_pending_fences_ == 0;
+  });
+  --number_of_waiters_;
+}
+
+}  // namespace glfc
+
+#endif  // GLFC_EGL
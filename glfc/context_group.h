@@ -0,0 +1,149 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_CONTEXT_GROUP_H_
+#define GLFC_CONTEXT_GROUP_H_
+
+#ifdef GLFC_EGL
+
+#include <EGL/egl.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/egl_context.h"
+
+namespace glfc {
+
+// This class runs filter tasks in parallel on several worker threads. Each
+// worker owns an EGL context in the share group of the context passed to the
+// constructor, so textures and buffers are visible to all workers while each
+// worker renders independently.
+//
+// Objects that are not shared between contexts, such as framebuffer objects,
+// and glfc objects, which are not thread-safe, must not be used by more than
+// one worker. The usual pattern is keeping one filter instance per worker and
+// indexing it with the worker index passed to each task.
+//
+// Each worker binds a `DeletionQueue` to its context, so OpenGL objects
+// released by a task are deleted in a batch after the task rather than one
+// by one.
+class ContextGroup {
+ public:
+  // A task receives the index of the worker it runs on.
+  typedef std::function<void(const int worker_index)> Task;
+
+  // Creates a group of `number_of_workers` workers whose contexts share
+  // objects with `share_context` on `display`. Passing `EGL_NO_CONTEXT` to
+  // `share_context` makes the workers only share objects among themselves.
+  ContextGroup(EGLDisplay display, EGLContext share_context,
+               const int number_of_workers);
+  ~ContextGroup();
+
+  // Creates the contexts and starts the worker threads. Returns `false` on
+  // failure.
+  bool Init();
+
+  // Runs `task` on every worker once, which is useful for creating and
+  // destroying per-worker objects. The task runs before any task submitted
+  // later on the same worker.
+  void RunOnEachWorker(const Task& task);
+
+  // Runs `task` on the next idle worker.
+  void Submit(const Task& task);
+
+  // Blocks until all tasks have completed and their OpenGL commands have
+  // finished, so results are visible to other contexts of the share group
+  // once this method returns. Workers only flush their commands after each
+  // task and place a fence after them, which are waited for here rather
+  // than after every task.
+  void Wait();
+
+  // Accessors.
+  int number_of_workers() const { return number_of_workers_; }
+
+ private:
+  // Stops the worker threads and destroys the contexts.
+  void Finalize();
+
+  // The loop of the worker thread at `worker_index`.
+  void RunWorker(const int worker_index);
+
+  // The worker contexts.
+  std::vector<EglContext> contexts_;
+
+  // The display of all contexts.
+  EGLDisplay display_;
+
+  // Indicates whether any worker failed to make its context current.
+  bool has_failed_worker_;
+
+  // Indicates if the group has been initialized.
+  bool is_initialized_;
+
+  // Guards all queues and counters below.
+  std::mutex mutex_;
+
+  // The number of fences placed after completed tasks that haven't been
+  // signaled yet.
+  int number_of_pending_fences_;
+
+  // The number of tasks that are queued or running.
+  int number_of_unfinished_tasks_;
+
+  // The number of threads blocked in `Wait()`. Idle workers wait for their
+  // fences while this isn't 0.
+  int number_of_waiters_;
+
+  // The number of worker threads.
+  const int number_of_workers_;
+
+  // Signaled when a task is queued or the workers should stop.
+  std::condition_variable queue_condition_;
+
+  // The tasks that can run on any worker.
+  std::deque<Task> shared_tasks_;
+
+  // The context passed to the constructor.
+  EGLContext share_context_;
+
+  // Indicates whether the workers should stop.
+  bool should_stop_;
+
+  // Signaled when `number_of_unfinished_tasks_` and
+  // `number_of_pending_fences_` drop to 0.
+  std::condition_variable tasks_finished_condition_;
+
+  // The tasks that must run on a specific worker.
+  std::vector<std::deque<Task>> worker_tasks_;
+
+  // The worker threads.
+  std::vector<std::thread> workers_;
+
+  GLFC_DISALLOW_COPY_AND_ASSIGN(ContextGroup);
+};
+
+}  // namespace glfc
+
+#endif  // GLFC_EGL
+
+#endif  // GLFC_CONTEXT_GROUP_H_
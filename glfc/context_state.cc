@@ -0,0 +1,157 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/context_state.h"
+
+#if defined GLFC_NULL_GL
+// The null backend has no context API.
+#elif defined GLFC_EGL
+#include <EGL/egl.h>
+#elif defined GLFC_IOS
+#include <objc/message.h>
+#include <objc/runtime.h>
+#elif defined GLFC_MAC
+#include <OpenGL/OpenGL.h>
+#endif
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "glfc/gl_handle.h"
+
+namespace {
+
+// The state of the last context looked up on a thread.
+struct CachedContextState {
+  // The context whose state is cached.
+  const void* context;
+
+  // The value of `generation` when the state was looked up.
+  unsigned generation;
+
+  // The weak reference to the state of `context`.
+  glfc::internal::ContextState* state;
+};
+
+// Incremented whenever a state is discarded, which invalidates the states
+// cached by all threads.
+std::atomic<unsigned> generation(0);
+
+// Guards the map returned by `GetStates()`.
+std::mutex states_mutex;
+
+// The state of the last context looked up on the calling thread.
+thread_local CachedContextState cached_state = {nullptr, 0, nullptr};
+
+// Returns the states of the contexts glfc was used on keyed by context. The
+// map is never destroyed so handles released at exit can still reach it.
+std::map<const void*, std::unique_ptr<glfc::internal::ContextState>>&
+GetStates() {
+  static auto* states = new std::map<
+      const void*, std::unique_ptr<glfc::internal::ContextState>>;
+  return *states;
+}
+
+}  // namespace
+
+namespace glfc {
+
+void ForgetCurrentContext() {
+  const void* kContext = internal::GetCurrentContext();
+  if (kContext == nullptr)
+    return;
+
+  // The state is destroyed outside the lock since destroying its deletion
+  // queue unbinds it from all states.
+  std::unique_ptr<internal::ContextState> state;
+  {
+    std::lock_guard<std::mutex> lock(states_mutex);
+    auto iterator = GetStates().find(kContext);
+    if (iterator == GetStates().end())
+      return;
+    state = std::move(iterator->second);
+    GetStates().erase(iterator);
+    ++generation;
+  }
+  if (state->bound_deletion_queue != nullptr)
+    state->bound_deletion_queue->Flush();
+  state->default_deletion_queue.Flush();
+}
+
+namespace internal {
+
+ContextState::ContextState() : bound_deletion_queue(nullptr),
+                               has_capabilities(false), render_depth(0),
+                               stats(new ContextStats) {
+}
+
+const void* GetCurrentContext() {
+#if defined GLFC_NULL_GL
+  static const int kNullContext = 0;
+  return &kNullContext;
+#elif defined GLFC_EGL
+  const EGLContext kContext = eglGetCurrentContext();
+  return kContext == EGL_NO_CONTEXT ? nullptr : kContext;
+#elif defined GLFC_IOS
+  // Calls `[EAGLContext currentContext]` through the Objective-C runtime.
+  typedef id (*CurrentContextFunction)(Class, SEL);
+  const CurrentContextFunction kCurrentContext = \
+      reinterpret_cast<CurrentContextFunction>(objc_msgSend);
+  return kCurrentContext(objc_getClass("EAGLContext"),
+                         sel_registerName("currentContext"));
+#elif defined GLFC_MAC
+  return CGLGetCurrentContext();
+#else
+  return nullptr;
+#endif
+}
+
+ContextState* GetCurrentContextState() {
+  const void* kContext = GetCurrentContext();
+  if (kContext == nullptr)
+    return nullptr;
+
+  const unsigned kGeneration = generation.load(std::memory_order_acquire);
+  if (cached_state.context == kContext &&
+      cached_state.generation == kGeneration) {
+    return cached_state.state;
+  }
+
+  std::lock_guard<std::mutex> lock(states_mutex);
+  std::unique_ptr<ContextState>& state = GetStates()[kContext];
+  if (!state)
+    state.reset(new ContextState);
+  cached_state.context = kContext;
+  cached_state.generation = kGeneration;
+  cached_state.state = state.get();
+  return state.get();
+}
+
+void UnbindDeletionQueue(const DeletionQueue* queue) {
+  std::lock_guard<std::mutex> lock(states_mutex);
+  for (auto& context_state : GetStates()) {
+    if (context_state.second->bound_deletion_queue == queue)
+      context_state.second->bound_deletion_queue = nullptr;
+  }
+}
+
+}  // namespace internal
+
+}  // namespace glfc
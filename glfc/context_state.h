@@ -0,0 +1,93 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+//
+// The state glfc keeps for each OpenGL context, such as the queue of objects
+// waiting for deletion. Work can move between threads, e.g. when a context is
+// made current on another thread, so the state is keyed by the context
+// current on the calling thread rather than by the thread. Each thread caches
+// the state of its last context, so looking it up only costs querying the
+// current context of the platform.
+
+#ifndef GLFC_CONTEXT_STATE_H_
+#define GLFC_CONTEXT_STATE_H_
+
+#include <memory>
+
+#include "glfc/base.h"
+#include "glfc/capabilities.h"
+#include "glfc/gl_handle.h"
+#include "glfc/stats.h"
+
+namespace glfc {
+
+// Deletes the objects queued for deletion on the context current on the
+// calling thread and discards the state glfc keeps for it, such as its
+// capabilities and statistics. This must be called with the context current
+// before destroying a context glfc was used on, since a context created later
+// may get the same handle. The contexts created by glfc, such as the ones of
+// `ContextGroup` and `FilterExecutor`, are forgotten automatically.
+void ForgetCurrentContext();
+
+namespace internal {
+
+// The state of a single context. It's only accessed with the context
+// current, which is on one thread at a time.
+struct ContextState {
+  ContextState();
+
+  // The queue bound by `DeletionQueue::SetCurrent()`, or `nullptr` to use
+  // `default_deletion_queue`.
+  DeletionQueue* bound_deletion_queue;
+
+  // The capabilities returned by `GetCapabilities()`.
+  Capabilities capabilities;
+
+  // Collects the released objects unless another queue is bound. It's
+  // flushed when the outermost `Filter::Render()` starts.
+  DeletionQueue default_deletion_queue;
+
+  // Indicates whether `capabilities` has been queried.
+  bool has_capabilities;
+
+  // The number of `Filter::Render()` calls in progress.
+  int render_depth;
+
+  // The statistics returned by `GetStats()`, shared with the framebuffers
+  // counted against them.
+  std::shared_ptr<ContextStats> stats;
+
+ private:
+  GLFC_DISALLOW_COPY_AND_ASSIGN(ContextState);
+};
+
+// Returns the handle of the context current on the calling thread, or
+// `nullptr` if no context is current. The null backend has a single context
+// that is always current.
+const void* GetCurrentContext();
+
+// Returns the state of the context current on the calling thread, which is
+// created on first use. Returns `nullptr` if no context is current.
+ContextState* GetCurrentContextState();
+
+// Unbinds `queue` from every context it's bound to.
+void UnbindDeletionQueue(const DeletionQueue* queue);
+
+}  // namespace internal
+
+}  // namespace glfc
+
+#endif  // GLFC_CONTEXT_STATE_H_
@@ -0,0 +1,457 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/cpu_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/color_stage.h"
+#include "glfc/separable_convolution_filter.h"
+
+namespace {
+
+// The number of channels of a `GL_RGBA` pixel.
+const int kNumberOfChannels = 4;
+
+// The L2 cache size assumed for fitting tiles, which is at the low end of
+// current desktop and mobile cores.
+const size_t kL2CacheSize = 256 * 1024;
+
+// The minimum size of an output tile, below which the per-tile overhead
+// dominates.
+const int kMinTileSize = 32;
+
+// The number of scratch buffers of a tile.
+const int kNumberOfScratchBuffers = 2;
+
+// A rectangle of pixels in image coordinates. The maximum coordinates are
+// exclusive.
+struct Region {
+  int min_x;
+  int min_y;
+  int max_x;
+  int max_y;
+
+  int height() const { return max_y - min_y; }
+  int width() const { return max_x - min_x; }
+};
+
+// Returns `region` expanded by `amount` pixels on each side and clipped to
+// an image of `width` x `height` pixels.
+Region ExpandRegion(const Region& region, const int amount, const int width,
+                    const int height) {
+  return {std::max(region.min_x - amount, 0),
+          std::max(region.min_y - amount, 0),
+          std::min(region.max_x + amount, width),
+          std::min(region.max_y + amount, height)};
+}
+
+// Adds `count` values interpolated by `fraction` between `first` and
+// `first_next` and between `second` and `second_next`, weighted by `weight`,
+// to `sum`. The interpolation is skipped for whole-pixel taps.
+void AccumulateTap(const float* first, const float* first_next,
+                   const float* second, const float* second_next,
+                   const float fraction, const float weight, const int count,
+                   float* sum) {
+  if (fraction == 0) {
+    for (int index = 0; index < count; ++index)
+      sum[index] += (first[index] + second[index]) * weight;
+    return;
+  }
+  for (int index = 0; index < count; ++index) {
+    const float kFirst = \
+        first[index] + (first_next[index] - first[index]) * fraction;
+    const float kSecond = \
+        second[index] + (second_next[index] - second[index]) * fraction;
+    sum[index] += (kFirst + kSecond) * weight;
+  }
+}
+
+// Returns `value` clamped to [0, 1] and rounded to 8 bits like the store to
+// a `GL_RGBA8` framebuffer.
+float Quantize(const float value) {
+  return std::round(std::min(std::max(value, 0.0f), 1.0f) * 255) / 255;
+}
+
+// A bump allocator of scratch floats that keeps its memory between tiles.
+class ScratchArena {
+ public:
+  ScratchArena() : used_(0) {}
+
+  // Returns `count` floats of uninitialized memory.
+  float* Allocate(const size_t count) {
+    float* memory = memory_.data() + used_;
+    used_ += count;
+    return memory;
+  }
+
+  // Frees all allocations and makes sure that `capacity` floats can be
+  // allocated until the next reset. The memory only grows when a tile needs
+  // more than any previous one.
+  void Reset(const size_t capacity) {
+    if (memory_.size() < capacity)
+      memory_.resize(capacity);
+    used_ = 0;
+  }
+
+ private:
+  // The memory of the arena.
+  std::vector<float> memory_;
+
+  // The number of floats allocated since the last reset.
+  size_t used_;
+
+  GLFC_DISALLOW_COPY_AND_ASSIGN(ScratchArena);
+};
+
+}  // namespace
+
+namespace glfc {
+
+struct CpuRenderer::Worker {
+  Worker() : end_tile(0), first_tile(0) {}
+
+  // The scratch memory of the tiles rendered by the worker.
+  ScratchArena arena;
+
+  // The end of the range of tiles queued for the worker.
+  int end_tile;
+
+  // The beginning of the range of tiles queued for the worker. The owner
+  // takes tiles from the beginning while thieves take them from the end.
+  int first_tile;
+
+  // Guards `end_tile` and `first_tile`.
+  std::mutex mutex;
+};
+
+CpuRenderer::CpuRenderer(const int number_of_threads, const int tile_size)
+    : caller_(new Worker), generation_(0), height_(0), input_(nullptr),
+      input_row_stride_(0), number_of_busy_workers_(0),
+      number_of_columns_(0), output_(nullptr), output_row_stride_(0),
+      should_stop_(false), tile_extent_(0), tile_size_(tile_size),
+      width_(0) {
+  int total_threads = number_of_threads;
+  if (total_threads <= 0)
+    total_threads = std::max<int>(std::thread::hardware_concurrency(), 1);
+  for (int index = 1; index < total_threads; ++index)
+    workers_.emplace_back(new Worker);
+  for (auto& worker : workers_)
+    threads_.emplace_back(&CpuRenderer::Run, this, worker.get());
+}
+
+CpuRenderer::~CpuRenderer() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    should_stop_ = true;
+  }
+  condition_.notify_all();
+  for (std::thread& thread : threads_)
+    thread.join();
+}
+
+bool CpuRenderer::Render(
+    const std::vector<const SeparableConvolutionFilter*>& filters,
+    const void* input, void* output, const int width, const int height,
+    const size_t input_row_stride, const size_t output_row_stride) {
+  if (width <= 0 || height <= 0)
+    return true;
+
+  stages_.resize(filters.size());
+  int halo = 0;
+  for (size_t index = 0; index < filters.size(); ++index) {
+    const SeparableConvolutionFilter* filter = filters[index];
+    if (!filter->IsPlainConvolution()) {
+#ifdef DEBUG
+      GLFC_LOG("!! The CPU renderer only supports plain convolutions.\n");
+#endif
+      return false;
+    }
+    // The vectors of the stages keep their capacity between renders, only
+    // fetching the kernel allocates.
+    Stage& stage = stages_[index];
+    stage.kernel = filter->GetKernel(1);
+    if (stage.kernel.empty()) {
+#ifdef DEBUG
+      GLFC_LOG("!! The CPU renderer can't render an empty kernel.\n");
+#endif
+      return false;
+    }
+    stage.color_stages.assign(filter->color_stages().begin(),
+                              filter->color_stages().end());
+    stage.radius = filter->GetKernelRadius(1);
+    stage.tap_fractions.resize(stage.kernel.size());
+    stage.tap_offsets.resize(stage.kernel.size());
+    for (size_t tap = 1; tap < stage.kernel.size(); ++tap) {
+      const float kDistance = tap * filter->texel_spacing_multiplier();
+      stage.tap_offsets[tap] = static_cast<int>(std::floor(kDistance));
+      stage.tap_fractions[tap] = kDistance - stage.tap_offsets[tap];
+    }
+    halo += stage.radius;
+  }
+
+  // Fits two scratch buffers of the tile and its halo in the L2 cache, but
+  // keeps the tile at least twice as large as the halo so the recomputed
+  // halo at most doubles the work of the first horizontal pass.
+  if (tile_size_ > 0) {
+    tile_extent_ = tile_size_;
+  } else {
+    const int kFittedExtent = static_cast<int>(std::sqrt(
+        kL2CacheSize / (kNumberOfScratchBuffers * kNumberOfChannels *
+                        sizeof(float))));
+    tile_extent_ = std::max(std::max(kFittedExtent - halo * 2, halo * 2),
+                            kMinTileSize);
+  }
+
+  height_ = height;
+  input_ = static_cast<const unsigned char*>(input);
+  input_row_stride_ = input_row_stride > 0 ? \
+                      input_row_stride : width * kNumberOfChannels;
+  output_ = static_cast<unsigned char*>(output);
+  output_row_stride_ = output_row_stride > 0 ? \
+                       output_row_stride : width * kNumberOfChannels;
+  width_ = width;
+  number_of_columns_ = (width + tile_extent_ - 1) / tile_extent_;
+  const int kNumberOfRows = (height + tile_extent_ - 1) / tile_extent_;
+  const int kNumberOfTiles = number_of_columns_ * kNumberOfRows;
+
+  // Queues contiguous ranges of tiles so each thread walks neighboring tiles
+  // whose inputs overlap.
+  const int kNumberOfWorkers = static_cast<int>(workers_.size()) + 1;
+  for (int index = 0; index < kNumberOfWorkers; ++index) {
+    Worker* worker = index == 0 ? caller_.get() : workers_[index - 1].get();
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    worker->first_tile = kNumberOfTiles * index / kNumberOfWorkers;
+    worker->end_tile = kNumberOfTiles * (index + 1) / kNumberOfWorkers;
+  }
+
+  if (!workers_.empty()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++generation_;
+      number_of_busy_workers_ = static_cast<int>(workers_.size());
+    }
+    condition_.notify_all();
+  }
+  RenderTiles(caller_.get());
+  if (!workers_.empty()) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    finished_condition_.wait(lock, [this] {
+      return number_of_busy_workers_ == 0;
+    });
+  }
+  input_ = nullptr;
+  output_ = nullptr;
+  return true;
+}
+
+void CpuRenderer::RenderTile(const int tile_index, Worker* worker) {
+  const int kColumn = tile_index % number_of_columns_;
+  const int kRow = tile_index / number_of_columns_;
+  const Region kTile = {
+      kColumn * tile_extent_, kRow * tile_extent_,
+      std::min((kColumn + 1) * tile_extent_, width_),
+      std::min((kRow + 1) * tile_extent_, height_)};
+
+  int halo = 0;
+  int max_padding = 0;
+  for (const Stage& stage : stages_) {
+    halo += stage.radius;
+    max_padding = std::max(max_padding, stage.tap_offsets.back() + 1);
+  }
+
+  // The input region is the largest one of the chain, and the result of
+  // each pass fits in a buffer of its size.
+  Region source_region = ExpandRegion(kTile, halo, width_, height_);
+  const size_t kBufferSize = \
+      static_cast<size_t>(source_region.width()) * source_region.height() *
+      kNumberOfChannels;
+  const size_t kRowSumSize = \
+      static_cast<size_t>(source_region.width()) * kNumberOfChannels;
+  const size_t kPaddedRowSize = \
+      kRowSumSize + max_padding * 2 * kNumberOfChannels;
+  worker->arena.Reset(kBufferSize * kNumberOfScratchBuffers + kRowSumSize +
+                      kPaddedRowSize);
+  float* source = worker->arena.Allocate(kBufferSize);
+  float* target = worker->arena.Allocate(kBufferSize);
+  float* padded_row = worker->arena.Allocate(kPaddedRowSize);
+  float* row_sum = worker->arena.Allocate(kRowSumSize);
+
+  for (int y = source_region.min_y; y < source_region.max_y; ++y) {
+    const unsigned char* pixel = \
+        input_ + y * input_row_stride_ +
+        source_region.min_x * kNumberOfChannels;
+    float* value = \
+        source + (y - source_region.min_y) * source_region.width() *
+        kNumberOfChannels;
+    const int kNumberOfValues = source_region.width() * kNumberOfChannels;
+    for (int index = 0; index < kNumberOfValues; ++index)
+      value[index] = pixel[index] / 255.0f;
+  }
+
+  for (const Stage& stage : stages_) {
+    halo -= stage.radius;
+    const Region kTargetRegion = ExpandRegion(kTile, halo, width_, height_);
+    const int kSourceWidth = source_region.width();
+    const int kTargetWidth = kTargetRegion.width();
+    const int kKernelSize = static_cast<int>(stage.kernel.size());
+
+    // The horizontal pass reads all rows of the source and writes the
+    // columns of the target region. Each row is copied with its border
+    // pixels replicated by the farthest tap so whole rows can be accumulated
+    // at once. The source region is either clipped by the image border,
+    // where the replication matches the clamping of the OpenGL path, or wide
+    // enough that the replicated pixels are never read.
+    const int kPadding = stage.tap_offsets.back() + 1;
+    const int kRowSize = kTargetWidth * kNumberOfChannels;
+    const int kTargetOffset = \
+        kPadding + kTargetRegion.min_x - source_region.min_x;
+    for (int y = 0; y < source_region.height(); ++y) {
+      const float* source_row = source + y * kSourceWidth * kNumberOfChannels;
+      for (int x = -kPadding; x < kSourceWidth + kPadding; ++x) {
+        const float* value = \
+            source_row + std::min(std::max(x, 0), kSourceWidth - 1) *
+            kNumberOfChannels;
+        std::copy(value, value + kNumberOfChannels,
+                  padded_row + (x + kPadding) * kNumberOfChannels);
+      }
+      const float* center = padded_row + kTargetOffset * kNumberOfChannels;
+      for (int index = 0; index < kRowSize; ++index)
+        row_sum[index] = center[index] * stage.kernel[0];
+      for (int tap = 1; tap < kKernelSize; ++tap) {
+        const int kOffset = stage.tap_offsets[tap];
+        AccumulateTap(
+            padded_row + (kTargetOffset + kOffset) * kNumberOfChannels,
+            padded_row + (kTargetOffset + kOffset + 1) * kNumberOfChannels,
+            padded_row + (kTargetOffset - kOffset) * kNumberOfChannels,
+            padded_row + (kTargetOffset - kOffset - 1) * kNumberOfChannels,
+            stage.tap_fractions[tap], stage.kernel[tap], kRowSize, row_sum);
+      }
+      float* target_row = target + y * kRowSize;
+      for (int index = 0; index < kRowSize; ++index)
+        target_row[index] = Quantize(row_sum[index]);
+    }
+
+    // The vertical pass reads the result of the horizontal pass and writes
+    // the target region back to the source buffer, applying the color
+    // stages. Whole rows are accumulated at once so the reads are
+    // contiguous.
+    const int kLast = source_region.height() - 1;
+    for (int y = kTargetRegion.min_y; y < kTargetRegion.max_y; ++y) {
+      const int kCenter = y - source_region.min_y;
+      const float* center = target + kCenter * kRowSize;
+      for (int index = 0; index < kRowSize; ++index)
+        row_sum[index] = center[index] * stage.kernel[0];
+      for (int tap = 1; tap < kKernelSize; ++tap) {
+        const int kOffset = stage.tap_offsets[tap];
+        AccumulateTap(
+            target + std::min(kCenter + kOffset, kLast) * kRowSize,
+            target + std::min(kCenter + kOffset + 1, kLast) * kRowSize,
+            target + std::max(kCenter - kOffset, 0) * kRowSize,
+            target + std::max(kCenter - kOffset - 1, 0) * kRowSize,
+            stage.tap_fractions[tap], stage.kernel[tap], kRowSize, row_sum);
+      }
+      float* source_row = source + (y - kTargetRegion.min_y) * kRowSize;
+      for (int x = 0; x < kRowSize; x += kNumberOfChannels) {
+        float* sum = row_sum + x;
+        for (const ColorStage& color_stage : stage.color_stages)
+          color_stage.Apply(sum);
+        for (int channel = 0; channel < kNumberOfChannels; ++channel)
+          source_row[x + channel] = Quantize(sum[channel]);
+      }
+    }
+    source_region = kTargetRegion;
+  }
+
+  // The last target region is the tile itself.
+  for (int y = kTile.min_y; y < kTile.max_y; ++y) {
+    const float* value = \
+        source + (y - kTile.min_y) * kTile.width() * kNumberOfChannels;
+    unsigned char* pixel = \
+        output_ + y * output_row_stride_ + kTile.min_x * kNumberOfChannels;
+    const int kNumberOfValues = kTile.width() * kNumberOfChannels;
+    for (int index = 0; index < kNumberOfValues; ++index)
+      pixel[index] = static_cast<unsigned char>(
+          std::round(value[index] * 255));
+  }
+}
+
+void CpuRenderer::RenderTiles(Worker* worker) {
+  int tile_index;
+  while ((tile_index = TakeTile(worker)) >= 0)
+    RenderTile(tile_index, worker);
+}
+
+void CpuRenderer::Run(Worker* worker) {
+  unsigned rendered_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this, rendered_generation] {
+        return should_stop_ || generation_ != rendered_generation;
+      });
+      if (should_stop_)
+        return;
+      rendered_generation = generation_;
+    }
+    RenderTiles(worker);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --number_of_busy_workers_;
+    }
+    finished_condition_.notify_one();
+  }
+}
+
+int CpuRenderer::TakeTile(Worker* worker) {
+  {
+    std::lock_guard<std::mutex> lock(worker->mutex);
+    if (worker->first_tile < worker->end_tile)
+      return worker->first_tile++;
+  }
+
+  // Steals the last tile of the queue with the most tiles left, which is
+  // the farthest from where its owner is working.
+  while (true) {
+    Worker* victim = nullptr;
+    int max_number_of_tiles = 0;
+    const int kNumberOfWorkers = static_cast<int>(workers_.size()) + 1;
+    for (int index = 0; index < kNumberOfWorkers; ++index) {
+      Worker* other = index == 0 ? caller_.get() : workers_[index - 1].get();
+      if (other == worker)
+        continue;
+      std::lock_guard<std::mutex> lock(other->mutex);
+      const int kNumberOfTiles = other->end_tile - other->first_tile;
+      if (kNumberOfTiles > max_number_of_tiles) {
+        max_number_of_tiles = kNumberOfTiles;
+        victim = other;
+      }
+    }
+    if (victim == nullptr)
+      return -1;
+    std::lock_guard<std::mutex> lock(victim->mutex);
+    if (victim->first_tile < victim->end_tile)
+      return --victim->end_tile;
+  }
+}
+
+}  // namespace glfc
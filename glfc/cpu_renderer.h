@@ -0,0 +1,184 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_CPU_RENDERER_H_
+#define GLFC_CPU_RENDERER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/color_stage.h"
+
+namespace glfc {
+
+class SeparableConvolutionFilter;
+
+// This class applies chains of filters to `GL_RGBA` images in client memory
+// on the CPU, without an OpenGL context. Only plain convolutions, as
+// reported by `SeparableConvolutionFilter::IsPlainConvolution()`, along with
+// their color stages are supported. Like the OpenGL path, the input is
+// clamped at the image border, the result of the horizontal pass is clamped
+// to [0, 1], and the output of each filter is rounded to 8 bits before the
+// next filter reads it.
+//
+// Running each filter over the whole image would stream it through memory
+// once per pass. Instead, the output is split into tiles sized for the L2
+// cache. Each tile reads its input with a halo of the summed kernel radii of
+// the chain, and runs all passes of all filters on the tile's scratch
+// buffers before writing the tile's output, so the intermediate results stay
+// in cache. The halo is recomputed by neighboring tiles, which is cheap
+// compared with the memory traffic saved.
+//
+// Tiles are distributed over a pool of threads including the calling one.
+// Each thread takes tiles from its own queue and steals from the busiest
+// other queue once it runs dry, which balances tiles of uneven cost such as
+// the ones at the border. The scratch buffers come from a per-thread arena
+// that keeps its memory between renders, so rendering images of the same
+// dimension with the same chain makes no heap allocation per tile. The only
+// allocation per render is fetching the kernel of each filter.
+class CpuRenderer {
+ public:
+  // Creates a renderer with `number_of_threads` threads including the
+  // calling one and output tiles of at most `tile_size` pixels on each side.
+  // Passing 0 to `number_of_threads` uses the number of hardware threads,
+  // and passing 0 to `tile_size` fits the tile and its halo in the L2 cache.
+  CpuRenderer(const int number_of_threads, const int tile_size);
+  ~CpuRenderer();
+
+  // Applies `filters` in order to `input` and writes the result to
+  // `output`, both of `width` x `height` pixels with `input_row_stride` and
+  // `output_row_stride` bytes per row. Passing 0 to a stride means
+  // tightly-packed rows. The input and output must not overlap. Returns
+  // `false` if any filter is not a plain convolution or has an empty kernel,
+  // such as a blur radius of 0.
+  bool Render(const std::vector<const SeparableConvolutionFilter*>& filters,
+              const void* input, void* output, const int width,
+              const int height, const size_t input_row_stride,
+              const size_t output_row_stride);
+
+  // Accessors.
+  int number_of_threads() const {
+    return static_cast<int>(workers_.size()) + 1;
+  }
+  int tile_size() const { return tile_size_; }
+
+ private:
+  // A filter of the chain prepared for rendering.
+  struct Stage {
+    // The color stages applied to the result of the vertical pass.
+    std::vector<ColorStage> color_stages;
+    // The kernel weights from the center outward.
+    std::vector<float> kernel;
+    // The pixels read beyond the output on each side by both passes.
+    int radius;
+    // The whole pixels and the fraction of a pixel from the center to each
+    // tap of the kernel but the center, which is spaced by the texel spacing
+    // multiplier of the filter.
+    std::vector<float> tap_fractions;
+    std::vector<int> tap_offsets;
+  };
+
+  // The state of a thread rendering tiles.
+  struct Worker;
+
+  // Renders tiles until no queue has any left, using the scratch memory of
+  // `worker`.
+  void RenderTiles(Worker* worker);
+
+  // Renders the output tile at `tile_index` using the scratch memory of
+  // `worker`.
+  void RenderTile(const int tile_index, Worker* worker);
+
+  // The loop of the pool threads.
+  void Run(Worker* worker);
+
+  // Takes the next tile for `worker` from its own queue or steals one from
+  // the others. Returns -1 if no tile is left.
+  int TakeTile(Worker* worker);
+
+  // The state of the calling thread, which renders tiles along with the
+  // pool threads.
+  std::unique_ptr<Worker> caller_;
+
+  // Notifies the pool threads of a new render or shutdown.
+  std::condition_variable condition_;
+
+  // Notifies `Render()` that a pool thread finished its tiles.
+  std::condition_variable finished_condition_;
+
+  // The generation of the render in progress, which the pool threads wait
+  // to change.
+  unsigned generation_;
+
+  // The height in pixels of the image being rendered.
+  int height_;
+
+  // The weak reference to the input pixels being rendered.
+  const unsigned char* input_;
+
+  // The bytes per row of `input_`.
+  size_t input_row_stride_;
+
+  // Guards `generation_`, `number_of_busy_workers_` and `should_stop_`.
+  std::mutex mutex_;
+
+  // The number of pool threads still rendering tiles.
+  int number_of_busy_workers_;
+
+  // The number of tiles in each row of tiles of the render in progress.
+  int number_of_columns_;
+
+  // The weak reference to the output pixels being rendered.
+  unsigned char* output_;
+
+  // The bytes per row of `output_`.
+  size_t output_row_stride_;
+
+  // Indicates whether the pool threads should exit.
+  bool should_stop_;
+
+  // The filters of the chain being rendered in order. The members describing
+  // the render in progress are only written by `Render()` while the pool
+  // threads wait.
+  std::vector<Stage> stages_;
+
+  // The pool threads.
+  std::vector<std::thread> threads_;
+
+  // The size of the output tiles of the render in progress.
+  int tile_extent_;
+
+  // The maximum size of an output tile, or 0 to fit the L2 cache.
+  const int tile_size_;
+
+  // The width in pixels of the image being rendered.
+  int width_;
+
+  // The state of the pool threads.
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  GLFC_DISALLOW_COPY_AND_ASSIGN(CpuRenderer);
+};
+
+}  // namespace glfc
+
+#endif  // GLFC_CPU_RENDERER_H_
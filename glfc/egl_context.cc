@@ -0,0 +1,115 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/egl_context.h"
+
+#ifdef GLFC_EGL
+
+#include <EGL/egl.h>
+
+#include <cstring>
+
+#include "glfc/base.h"
+
+namespace {
+
+#ifdef GLFC_GLES3
+const EGLint kClientVersion = 3;
+const EGLint kRenderableType = 0x0040;  // EGL_OPENGL_ES3_BIT
+#else
+const EGLint kClientVersion = 2;
+const EGLint kRenderableType = EGL_OPENGL_ES2_BIT;
+#endif
+
+// Returns `true` if `display` supports making contexts current without
+// surfaces.
+bool SupportsSurfacelessContext(EGLDisplay display) {
+  const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+  return extensions != nullptr &&
+         std::strstr(extensions, "EGL_KHR_surfaceless_context") != nullptr;
+}
+
+}  // namespace
+
+namespace glfc {
+
+bool CreateEglContext(EGLDisplay display, EGLContext share_context,
+                      EglContext* context) {
+  // Shared contexts should use the same config as the share context.
+  const bool kIsSurfaceless = SupportsSurfacelessContext(display);
+  EGLint config_id = 0;
+  if (share_context != EGL_NO_CONTEXT)
+    eglQueryContext(display, share_context, EGL_CONFIG_ID, &config_id);
+  const EGLint kConfigIdAttributes[] = {EGL_CONFIG_ID, config_id, EGL_NONE};
+  const EGLint kConfigAttributes[] = {
+      EGL_RENDERABLE_TYPE, kRenderableType,
+      EGL_SURFACE_TYPE, kIsSurfaceless ? 0 : EGL_PBUFFER_BIT,
+      EGL_NONE};
+  EGLConfig config;
+  EGLint number_of_configs = 0;
+  if (!eglChooseConfig(display,
+                       config_id > 0 ? kConfigIdAttributes : kConfigAttributes,
+                       &config, 1, &number_of_configs) ||
+      number_of_configs == 0) {
+#ifdef DEBUG
+    GLFC_LOG("!! Failed to choose EGL config.\n");
+#endif
+    return false;
+  }
+
+  const EGLint kContextAttributes[] = {EGL_CONTEXT_CLIENT_VERSION,
+                                       kClientVersion, EGL_NONE};
+  context->context = eglCreateContext(display, config, share_context,
+                                      kContextAttributes);
+  if (context->context == EGL_NO_CONTEXT) {
+#ifdef DEBUG
+    GLFC_LOG("!! Failed to create EGL context.\n");
+#endif
+    return false;
+  }
+  if (!kIsSurfaceless) {
+    const EGLint kSurfaceAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1,
+                                         EGL_NONE};
+    context->surface = eglCreatePbufferSurface(display, config,
+                                               kSurfaceAttributes);
+    if (context->surface == EGL_NO_SURFACE) {
+      DestroyEglContext(display, context);
+      return false;
+    }
+  }
+  return true;
+}
+
+void DestroyEglContext(EGLDisplay display, EglContext* context) {
+  if (context->surface != EGL_NO_SURFACE) {
+    eglDestroySurface(display, context->surface);
+    context->surface = EGL_NO_SURFACE;
+  }
+  if (context->context != EGL_NO_CONTEXT) {
+    eglDestroyContext(display, context->context);
+    context->context = EGL_NO_CONTEXT;
+  }
+}
+
+bool MakeEglContextCurrent(EGLDisplay display, const EglContext& context) {
+  return eglMakeCurrent(display, context.surface, context.surface,
+                        context.context) == EGL_TRUE;
+}
+
+}  // namespace glfc
+
+#endif  // GLFC_EGL
@@ -0,0 +1,53 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_EGL_CONTEXT_H_
+#define GLFC_EGL_CONTEXT_H_
+
+#ifdef GLFC_EGL
+
+#include <EGL/egl.h>
+
+namespace glfc {
+
+// An offscreen EGL context along with the surface it should be made current
+// with. The surface is `EGL_NO_SURFACE` if the display supports surfaceless
+// contexts.
+struct EglContext {
+  EglContext() : context(EGL_NO_CONTEXT), surface(EGL_NO_SURFACE) {}
+
+  EGLContext context;
+  EGLSurface surface;
+};
+
+// Creates an offscreen context on `display` that shares objects with
+// `share_context`, which can be `EGL_NO_CONTEXT`. The context uses the same
+// config as `share_context` if possible. Returns `false` on failure.
+bool CreateEglContext(EGLDisplay display, EGLContext share_context,
+                      EglContext* context);
+
+// Destroys the context and surface created by `CreateEglContext()`.
+void DestroyEglContext(EGLDisplay display, EglContext* context);
+
+// Makes `context` current on the calling thread. Returns `false` on failure.
+bool MakeEglContextCurrent(EGLDisplay display, const EglContext& context);
+
+}  // namespace glfc
+
+#endif  // GLFC_EGL
+
+#endif  // GLFC_EGL_CONTEXT_H_
@@ -17,47 +17,150 @@
 
 #include "glfc/filter.h"
 
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <cstdio>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "glfc/base.h"
+#include "glfc/color_stage.h"
+#include "glfc/context_state.h"
 #include "glfc/framebuffer.h"
 #include "glfc/opengl_hook.h"
 #include "glfc/program.h"
+#include "glfc/stats.h"
+#include "glfc/texture_uploader.h"
+#include "glfc/trace.h"
 
 namespace glfc {
 
-Filter::Filter() : device_pixel_ratio_(1), framebuffer_(nullptr),
-                   program_(new Program) {
+Filter::Filter() : cache_hits_(0), cache_misses_(0),
+                   cached_device_pixel_ratio_(0), cached_input_generation_(0),
+                   cached_input_texture_(0), caching_enabled_(false),
+                   device_pixel_ratio_(1), has_cached_result_(false),
+                   input_generation_(0), program_(new Program),
+                   should_update_color_stages_(false) {
 }
 
 Filter::~Filter() {
-  if (framebuffer_ != nullptr) {
-    delete framebuffer_;
-  }
-  delete program_;
 }
 
-void Filter::ApplyFilterToFramebuffer(const GLuint input_texture,
+bool Filter::ApplyFilterToFramebuffer(const GLuint input_texture,
                                       Program* program,
                                       Framebuffer* framebuffer) {
   program->Use();
   SetUniforms(program);
+  SetColorStageUniforms(program, true);
   program->Render(input_texture);
+  return true;
+}
+
+uint64_t Filter::HashInput(const void* pixels, const size_t size) {
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(pixels);
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t index = 0; index < size; ++index) {
+    hash ^= bytes[index];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
 }
 
 bool Filter::Render(const GLuint input_texture, const float width,
                     const float height, const float device_pixel_ratio) {
-  const int kWidth = width * device_pixel_ratio;
-  const int kHeight = height * device_pixel_ratio;
+  GLFC_TRACE_SCOPE("Filter::Render");
+  // The outermost render on a context is the frame boundary where the
+  // objects released since the previous one are deleted, see `gl_handle.h`.
+  internal::ContextState* context_state = internal::GetCurrentContextState();
+  if (context_state != nullptr && context_state->render_depth++ == 0)
+    context_state->default_deletion_queue.Flush();
+
+  bool result;
+  if (caching_enabled_)
+    result = RenderCached(input_texture, width, height, device_pixel_ratio);
+  else
+    result = RenderUncached(input_texture, width, height, device_pixel_ratio);
+  if (context_state != nullptr)
+    --context_state->render_depth;
+  return result;
+}
+
+bool Filter::RenderCached(const GLuint input_texture, const float width,
+                          const float height,
+                          const float device_pixel_ratio) {
+  const int kWidth = std::round(width * device_pixel_ratio);
+  const int kHeight = std::round(height * device_pixel_ratio);
+  if (has_cached_result_ && cached_input_texture_ == input_texture &&
+      cached_input_generation_ == input_generation_ &&
+      cached_device_pixel_ratio_ == device_pixel_ratio &&
+      cache_framebuffer_->width() == kWidth &&
+      cache_framebuffer_->height() == kHeight) {
+    ++cache_hits_;
+    cache_framebuffer_->Render();
+    return true;
+  }
+
+  ++cache_misses_;
+  has_cached_result_ = false;
+  if (cache_framebuffer_ &&
+      (cache_framebuffer_->width() != kWidth ||
+       cache_framebuffer_->height() != kHeight)) {
+    // The resize is counted once when `framebuffer_` is recreated.
+    cache_framebuffer_.reset();
+  }
+  if (!cache_framebuffer_) {
+    cache_framebuffer_.reset(new Framebuffer(kWidth, kHeight));
+    if (!cache_framebuffer_->Init()) {
+      cache_framebuffer_.reset();
+#ifdef DEBUG
+      GLFC_LOG("!! Failed to initialize cache framebuffer.\n");
+#endif
+      return false;
+    }
+  }
+
+  // Renders the result to the cache framebuffer and then draws it to the
+  // original framebuffer with the original viewport.
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  cache_framebuffer_->Bind();
+  cache_framebuffer_->Clear();
+  const bool kResult = RenderUncached(input_texture, width, height,
+                                      device_pixel_ratio);
+  cache_framebuffer_->Unbind();
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  if (!kResult)
+    return false;
+
+  cached_device_pixel_ratio_ = device_pixel_ratio;
+  cached_input_generation_ = input_generation_;
+  cached_input_texture_ = input_texture;
+  has_cached_result_ = true;
+  cache_framebuffer_->Render();
+  return true;
+}
+
+bool Filter::RenderUncached(const GLuint input_texture, const float width,
+                            const float height,
+                            const float device_pixel_ratio) {
+  const float kScale = GetFramebufferScale();
+  const int kWidth = std::round(width * device_pixel_ratio * kScale);
+  const int kHeight = std::round(height * device_pixel_ratio * kScale);
   set_device_pixel_ratio(device_pixel_ratio);
-  if (framebuffer_ != nullptr &&
-      (framebuffer_->width() != kWidth || framebuffer_->height() != kHeight)) {
-    delete framebuffer_;
-    framebuffer_ = nullptr;
+  const FramebufferDescriptor kDescriptor = GetFramebufferDescriptor();
+  if (framebuffer_ &&
+      (framebuffer_->width() != kWidth || framebuffer_->height() != kHeight ||
+       framebuffer_->descriptor().color_format != kDescriptor.color_format ||
+       framebuffer_->descriptor().has_stencil_attachment != \
+           kDescriptor.has_stencil_attachment)) {
+    if (framebuffer_->width() != kWidth || framebuffer_->height() != kHeight)
+      internal::CountFramebufferResize();
+    framebuffer_.reset();
   }
-  if (framebuffer_ == nullptr) {
-    framebuffer_ = new Framebuffer(kWidth, kHeight);
+  if (!framebuffer_) {
+    framebuffer_.reset(new Framebuffer(kWidth, kHeight, kDescriptor));
     if (!framebuffer_->Init()) {
 #ifdef DEBUG
       GLFC_LOG("!! Failed to initialize framebuffer.\n");
@@ -66,8 +169,13 @@ bool Filter::Render(const GLuint input_texture, const float width,
     }
   }
 
-  if (!program_->is_initialized() || ShouldUpdateShaders()) {
-    if (!program_->Init(GetVertexShader(), GetFragmentShader())) {
+  if (!program_->is_initialized() || ShouldUpdateShaders() ||
+      should_update_color_stages_) {
+    if (program_->is_initialized())
+      internal::CountShaderRegeneration();
+    should_update_color_stages_ = false;
+    if (!program_->Init(GetVertexShader(),
+                        SpliceColorStages(GetFragmentShader()))) {
 #ifdef DEBUG
       GLFC_LOG("!! Failed to initialize program.\n");
       return false;
@@ -75,8 +183,103 @@ bool Filter::Render(const GLuint input_texture, const float width,
     }
   }
 
-  ApplyFilterToFramebuffer(input_texture, program_, framebuffer_);
-  return true;
+  return ApplyFilterToFramebuffer(input_texture, program_.get(),
+                                  framebuffer_.get());
+}
+
+void Filter::ResetCacheStatistics() {
+  cache_hits_ = 0;
+  cache_misses_ = 0;
+}
+
+void Filter::SetColorStageUniforms(Program* program,
+                                   const bool is_final_pass) const {
+  if (color_stages_.empty())
+    return;
+
+  glUniform1i(glGetUniformLocation(program->program(), "colorStagesEnabled"),
+              is_final_pass);
+  if (!is_final_pass)
+    return;
+  for (size_t index = 0; index < color_stages_.size(); ++index)
+    color_stages_[index].SetUniforms(index, program);
+}
+
+std::string Filter::SpliceColorStages(
+    const std::string& fragment_shader) const {
+  const std::string kMainSignature = "void main()";
+  const size_t kMainPosition = fragment_shader.find(kMainSignature);
+  if (color_stages_.empty() || kMainPosition == std::string::npos)
+    return fragment_shader;
+
+  // Renames the original `main()` function and redirects its output to a
+  // global variable.
+  std::string shader_string = fragment_shader.substr(0, kMainPosition);
+  shader_string.append("vec4 filterColor;\n\nvoid applyFilter()");
+  std::string body = \
+      fragment_shader.substr(kMainPosition + kMainSignature.size());
+  // GLSL ES 3.00 shaders write to the `fragColor` output variable instead of
+  // the built-in one.
+  const std::string kFragColor = \
+      fragment_shader.find("#version 300 es") == std::string::npos ? \
+      "gl_FragColor" : "fragColor";
+  const std::string kFilterColor = "filterColor";
+  for (size_t position = body.find(kFragColor);
+       position != std::string::npos;
+       position = body.find(kFragColor, position + kFilterColor.size())) {
+    body.replace(position, kFragColor.size(), kFilterColor);
+  }
+  shader_string.append(body);
+
+  // Applies the color stages to the output in the new `main()` function.
+  // They are skipped by passes other than the final one.
+  shader_string.append("\n\nuniform bool colorStagesEnabled;\n");
+  for (size_t index = 0; index < color_stages_.size(); ++index)
+    shader_string.append(color_stages_[index].GetShaderUniforms(index));
+  shader_string.append(R"(
+void main() {
+  applyFilter();
+  vec4 color = filterColor;
+  if (!colorStagesEnabled) {
+    )" + kFragColor + R"( = color;
+    return;
+  }
+)");
+  for (size_t index = 0; index < color_stages_.size(); ++index)
+    shader_string.append(color_stages_[index].GetShaderStatements(index));
+  shader_string.append("  " + kFragColor + " = color;\n}");
+  return shader_string;
+}
+
+void Filter::set_caching_enabled(const bool caching_enabled) {
+  if (caching_enabled == caching_enabled_)
+    return;
+
+  caching_enabled_ = caching_enabled;
+  has_cached_result_ = false;
+  if (!caching_enabled_)
+    cache_framebuffer_.reset();
+}
+
+void Filter::set_color_stages(const std::vector<ColorStage>& color_stages) {
+  bool types_changed = color_stages.size() != color_stages_.size();
+  for (size_t index = 0; !types_changed && index < color_stages.size();
+       ++index) {
+    types_changed = color_stages[index].type() != color_stages_[index].type();
+  }
+  color_stages_ = color_stages;
+  if (types_changed)
+    should_update_color_stages_ = true;
+  has_cached_result_ = false;
+}
+
+bool Filter::Render(const TextureUploader& uploader,
+                    const float device_pixel_ratio) {
+  if (uploader.texture() == 0)
+    return false;
+
+  return Render(uploader.texture(), uploader.width() / device_pixel_ratio,
+                uploader.height() / device_pixel_ratio, device_pixel_ratio);
 }
 
 }  // namespace glfc
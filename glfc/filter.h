@@ -18,35 +18,129 @@
 #ifndef GLFC_FILTER_H_
 #define GLFC_FILTER_H_
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "glfc/base.h"
+#include "glfc/color_stage.h"
+#include "glfc/framebuffer.h"
 #include "glfc/opengl_hook.h"
 
 namespace glfc {
 
-class Framebuffer;
 class Program;
+class TextureUploader;
 
 // This is the base class of all supported filters.
+//
+// A filter can optionally cache its result for inputs that rarely change,
+// such as a static backdrop behind a blurred panel. When caching is enabled,
+// the result is rendered to an internal framebuffer that is then drawn to
+// the binded framebuffer, replacing its contents. Subsequent renders with
+// the same input texture, input generation, dimension and filter parameters
+// draw the cached result without applying the filter again.
+//
+// Per-pixel color operations can be attached as color stages, which are
+// spliced into the fragment shader of the final pass instead of rendering
+// extra passes.
 class Filter {
  public:
   Filter();
   virtual ~Filter();
 
+  // Returns a 64-bit FNV-1a hash of `size` bytes at `pixels`, which can be
+  // passed to `set_input_generation()` if the input has no natural
+  // generation counter. Hashing costs a full pass over the memory.
+  static uint64_t HashInput(const void* pixels, const size_t size);
+
+  // Returns the distance in pixels of the farthest input pixel that affects
+  // an output pixel, given the current parameters and `device_pixel_ratio`.
+  // Tiled rendering uses this as the halo around each tile. The default
+  // implementation returns 0 for per-pixel filters.
+  virtual int GetKernelRadius(const float device_pixel_ratio) const {
+    return 0;
+  }
+
+  // Returns the fragment shader string. The returned shader must declare the
+  // `sampler2D inputImageTexture` uniform. GLSL ES 3.00 shaders must write
+  // their result to an output variable named `fragColor`. The shaders are
+  // public so their generation can be inspected and measured, `Render()`
+  // only generates them when the program needs to be initialized.
+  virtual std::string GetFragmentShader() const = 0;
+
+  // Returns the vertex shader string. The returned shader must declare both
+  // `vec4 position` and `vec2 inputTextureCoordinate` attributes.
+  virtual std::string GetVertexShader() const = 0;
+
   // Renders the filter with `input_texture` and its dimension to the
-  // framebuffer that is currently binded to OpenGL. This method is designed
-  // specifically for one pass rendering. A `Filter` subclass can override
-  // this method to implement two pass rendering or combine multiple filters.
+  // framebuffer that is currently binded to OpenGL. The dimension in pixels
+  // is the dimension in points times `device_pixel_ratio` rounded to the
+  // nearest integer. This method is designed specifically for one pass
+  // rendering. A `Filter` subclass can override this method to implement two
+  // pass rendering or combine multiple filters.
   bool Render(const GLuint input_texture, const float width,
               const float height, const float device_pixel_ratio);
 
+  // Renders the filter with the most recently committed texture of
+  // `uploader` as the input. The dimension in points is derived from the
+  // uploader's pixel dimension and `device_pixel_ratio`.
+  bool Render(const TextureUploader& uploader,
+              const float device_pixel_ratio);
+
+  // Resets the cache hit and miss counters.
+  void ResetCacheStatistics();
+
+  // Setters and accessors for color stages. The stages are applied in order
+  // to the result of the final pass. Changing only the parameters of the
+  // stages doesn't regenerate the shaders.
+  const std::vector<ColorStage>& color_stages() const {
+    return color_stages_;
+  }
+  void set_color_stages(const std::vector<ColorStage>& color_stages);
+
+  // Setters and accessors for caching.
+  uint64_t cache_hits() const { return cache_hits_; }
+  uint64_t cache_misses() const { return cache_misses_; }
+  bool caching_enabled() const { return caching_enabled_; }
+  void set_caching_enabled(const bool caching_enabled);
+  uint64_t input_generation() const { return input_generation_; }
+  // The generation identifies the contents of the input texture. It must
+  // change whenever the contents change, e.g. by incrementing a counter on
+  // each update or by passing the result of `HashInput()`.
+  void set_input_generation(const uint64_t input_generation) {
+    input_generation_ = input_generation;
+  }
+
  protected:
-  // Applies the filter to the specified `framebuffer`.
-  virtual void ApplyFilterToFramebuffer(const GLuint input_texture,
+  // Applies the filter to the specified `framebuffer`. Returns `false` on
+  // failure, which fails `Render()`.
+  virtual bool ApplyFilterToFramebuffer(const GLuint input_texture,
                                         Program* program,
                                         Framebuffer* framebuffer);
 
+  // Discards the cached result. Subclasses must call this whenever a
+  // parameter affecting the result changes.
+  void InvalidateCache() { has_cached_result_ = false; }
+
+  // Returns the descriptor of the framebuffer allocated in `Render()`. The
+  // default implementation only asks for the color attachment.
+  virtual FramebufferDescriptor GetFramebufferDescriptor() const {
+    return FramebufferDescriptor();
+  }
+
+  // Returns the scale of the framebuffer allocated in `Render()` relative to
+  // the output resolution. Filters whose intermediate result tolerates a
+  // lower resolution return a value below 1. The default value is 1.
+  virtual float GetFramebufferScale() const { return 1; }
+
+  // Sets the uniforms of the color stages for `program`, which must be in
+  // use. Filters rendering several passes with the same program must pass
+  // `false` to `is_final_pass` for all but the last pass.
+  void SetColorStageUniforms(Program* program, const bool is_final_pass) const;
+
   // Returns `true` if the corresponded shaders should update.
   virtual bool ShouldUpdateShaders() const { return false; }
 
@@ -57,26 +151,68 @@ class Filter {
   }
 
  private:
-  // Returns the fragment shader string. The returned shader must declare the
-  // `sampler2D inputImageTexture` uniform.
-  virtual std::string GetFragmentShader() const = 0;
-
-  // Returns the vertex shader string. The returned shader must declare both
-  // `vec4 position` and `vec2 inputTextureCoordinate` attributes.
-  virtual std::string GetVertexShader() const = 0;
-
   // Sets uniforms used in shaders except the `inputImageTexture` one.
   virtual void SetUniforms(Program* program) const {}
 
+  // Applies the filter through the cache framebuffer, or draws the cached
+  // result if it's still valid. The arguments are the same as `Render()`.
+  bool RenderCached(const GLuint input_texture, const float width,
+                    const float height, const float device_pixel_ratio);
+
+  // Applies the filter to the framebuffer that is currently binded to OpenGL
+  // without consulting the cache. The arguments are the same as `Render()`.
+  bool RenderUncached(const GLuint input_texture, const float width,
+                      const float height, const float device_pixel_ratio);
+
+  // Returns `fragment_shader` with its `main()` function wrapped to apply the
+  // color stages to the resulting color. The shader is returned unchanged if
+  // there is no color stage.
+  std::string SpliceColorStages(const std::string& fragment_shader) const;
+
+  // The number of renders that drew the cached result.
+  uint64_t cache_hits_;
+
+  // The number of renders with caching enabled that applied the filter.
+  uint64_t cache_misses_;
+
+  // The framebuffer holding the cached result. This is only allocated when
+  // caching is enabled.
+  std::unique_ptr<Framebuffer> cache_framebuffer_;
+
+  // The `device_pixel_ratio` of the cached result.
+  float cached_device_pixel_ratio_;
+
+  // The input generation of the cached result.
+  uint64_t cached_input_generation_;
+
+  // The input texture of the cached result.
+  GLuint cached_input_texture_;
+
+  // The color stages applied to the result of the final pass.
+  std::vector<ColorStage> color_stages_;
+
+  // Indicates whether caching is enabled. The default value is `false`.
+  bool caching_enabled_;
+
   // Indicates the ratio between physical pixels and logical pixels. This value
   // will be updated whenever `Render()` is called. The default value is 1.
   float device_pixel_ratio_;
 
-  // The strong reference to the framebuffer that holds the result.
-  Framebuffer* framebuffer_;
+  // The framebuffer that holds the result.
+  std::unique_ptr<Framebuffer> framebuffer_;
+
+  // Indicates whether `cache_framebuffer_` holds a valid result.
+  bool has_cached_result_;
+
+  // The generation of the input texture's contents.
+  uint64_t input_generation_;
+
+  // The program that utilizing filter shaders.
+  std::unique_ptr<Program> program_;
 
-  // The strong reference to the program that utilizing filter shaders.
-  Program* program_;
+  // Indicates whether the program should be regenerated because the types of
+  // the color stages changed.
+  bool should_update_color_stages_;
 
   GLFC_DISALLOW_COPY_AND_ASSIGN(Filter);
 };
@@ -0,0 +1,276 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/filter_executor.h"
+
+#ifdef GLFC_EGL
+
+#include <EGL/egl.h>
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/context_state.h"
+#include "glfc/egl_context.h"
+#include "glfc/filter.h"
+#include "glfc/framebuffer.h"
+#include "glfc/gl_handle.h"
+#include "glfc/opengl_hook.h"
+#include "glfc/texture_uploader.h"
+
+namespace {
+
+// The maximum number of jobs rendered between two synchronizations. This also
+// bounds the number of framebuffers and uploaders kept by the executor.
+const size_t kMaxBatchSize = 16;
+
+}  // namespace
+
+namespace glfc {
+
+FilterExecutor::FilterExecutor(EGLDisplay display, EGLContext share_context)
+    : display_(display), is_initialized_(false), is_sleeping_(false),
+      number_of_submissions_(0), share_context_(share_context),
+      should_stop_(false) {
+}
+
+FilterExecutor::~FilterExecutor() {
+  if (is_initialized_)
+    Finalize();
+}
+
+bool FilterExecutor::Init() {
+  if (is_initialized_)
+    Finalize();
+
+  if (!CreateEglContext(display_, share_context_, &context_))
+    return false;
+
+  std::promise<bool> started;
+  std::future<bool> result = started.get_future();
+  should_stop_ = false;
+  thread_ = std::thread(&FilterExecutor::Run, this, &started);
+  if (!result.get()) {
+    thread_.join();
+    DestroyEglContext(display_, &context_);
+#ifdef DEBUG
+    GLFC_LOG("!! Failed to make EGL context current for filter executor.\n");
+#endif
+    return false;
+  }
+  is_initialized_ = true;
+  return true;
+}
+
+void FilterExecutor::Finalize() {
+  should_stop_ = true;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wake_condition_.notify_one();
+  }
+  thread_.join();
+  DestroyEglContext(display_, &context_);
+  is_initialized_ = false;
+}
+
+void FilterExecutor::RenderBatch(std::vector<PendingJob>* batch) {
+  std::vector<bool> results(batch->size());
+  for (size_t slot = 0; slot < batch->size(); ++slot)
+    results[slot] = RenderJob((*batch)[slot].job, slot);
+
+  // Synchronizes once for the whole batch, the results are then visible to
+  // the share group and can be read back without stalling.
+  glFinish();
+
+  for (size_t slot = 0; slot < batch->size(); ++slot) {
+    Job& job = (*batch)[slot].job;
+    if (results[slot] && job.output_pixels != nullptr) {
+      Framebuffer* framebuffer = framebuffers_[slot].get();
+      framebuffer->Bind();
+      glPixelStorei(GL_PACK_ALIGNMENT, 4);
+      glReadPixels(0, 0, job.width, job.height, GL_RGBA, GL_UNSIGNED_BYTE,
+                   job.output_pixels);
+      framebuffer->Unbind();
+    }
+    if (job.callback)
+      job.callback(results[slot]);
+    (*batch)[slot].promise.set_value(results[slot]);
+    job.filter.reset();
+  }
+}
+
+bool FilterExecutor::RenderJob(const Job& job, const size_t slot) {
+  if (!job.filter || job.width <= 0 || job.height <= 0 ||
+      (job.input_texture == 0 && job.input_pixels == nullptr) ||
+      (job.output_texture == 0 && job.output_pixels == nullptr)) {
+    return false;
+  }
+
+  // Uploads the input pixels with the uploader reserved for the slot.
+  GLuint input_texture = job.input_texture;
+  if (input_texture == 0) {
+    if (uploaders_.size() <= slot)
+      uploaders_.resize(slot + 1);
+    std::unique_ptr<TextureUploader>& uploader = uploaders_[slot];
+    if (!uploader || uploader->width() != job.width ||
+        uploader->height() != job.height) {
+      uploader.reset(new TextureUploader(job.width, job.height, 1, 0));
+      if (!uploader->Init()) {
+        uploader.reset();
+        return false;
+      }
+    }
+    if (!uploader->Upload(job.input_pixels))
+      return false;
+    input_texture = uploader->texture();
+  }
+
+  // Renders to the output texture directly.
+  if (job.output_texture != 0) {
+    glBindFramebuffer(GL_FRAMEBUFFER, output_framebuffer_.get());
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D, job.output_texture, 0);
+    bool result = glCheckFramebufferStatus(GL_FRAMEBUFFER) == \
+                  GL_FRAMEBUFFER_COMPLETE;
+    if (result) {
+      glViewport(0, 0, job.width, job.height);
+      glClearColor(0, 0, 0, 0);
+      glClear(GL_COLOR_BUFFER_BIT);
+      glEnable(GL_BLEND);
+      glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+      result = job.filter->Render(input_texture, job.width, job.height, 1);
+    }
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
+                           GL_TEXTURE_2D, 0, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return result;
+  }
+
+  // Renders to the framebuffer reserved for the slot, which is read back
+  // after the batch completes.
+  if (framebuffers_.size() <= slot)
+    framebuffers_.resize(slot + 1);
+  std::unique_ptr<Framebuffer>& framebuffer = framebuffers_[slot];
+  if (!framebuffer || framebuffer->width() != job.width ||
+      framebuffer->height() != job.height) {
+    framebuffer.reset(new Framebuffer(job.width, job.height));
+    if (!framebuffer->Init()) {
+      framebuffer.reset();
+      return false;
+    }
+  }
+  framebuffer->Bind();
+  framebuffer->Clear();
+  const bool kResult = job.filter->Render(input_texture, job.width,
+                                          job.height, 1);
+  framebuffer->Unbind();
+  return kResult;
+}
+
+void FilterExecutor::Run(std::promise<bool>* started) {
+  const bool kIsCurrent = MakeEglContextCurrent(display_, context_);
+  started->set_value(kIsCurrent);
+  if (!kIsCurrent)
+    return;
+
+  // Objects released while rendering are deleted between batches.
+  DeletionQueue deletion_queue;
+  DeletionQueue::SetCurrent(&deletion_queue);
+  output_framebuffer_ = FramebufferHandle::Create();
+  std::vector<PendingJob> batch;
+  while (true) {
+    PendingJob pending_job;
+    while (batch.size() < kMaxBatchSize && queue_.Pop(&pending_job))
+      batch.push_back(std::move(pending_job));
+    if (!batch.empty()) {
+      RenderBatch(&batch);
+      batch.clear();
+      deletion_queue.Flush();
+      continue;
+    }
+    if (should_stop_)
+      break;
+
+    // Sleeps until a job is queued. The fence pairs with the one in
+    // `Submit()` so either the queued job is seen here or the submitting
+    // thread sees `is_sleeping_` and wakes this thread.
+    std::unique_lock<std::mutex> lock(mutex_);
+    is_sleeping_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    wake_condition_.wait(lock, [this] {
+      return !queue_.IsEmpty() || should_stop_;
+    });
+    is_sleeping_.store(false, std::memory_order_relaxed);
+  }
+
+  // Fails the jobs pushed after the queue was drained, so their filters are
+  // released with the context current. Once no submission is in progress,
+  // later ones see `should_stop_` and fail by themselves.
+  while (number_of_submissions_.load() > 0)
+    std::this_thread::yield();
+  PendingJob pending_job;
+  while (queue_.Pop(&pending_job)) {
+    if (pending_job.job.callback)
+      pending_job.job.callback(false);
+    pending_job.promise.set_value(false);
+    pending_job.job.filter.reset();
+  }
+
+  // Releases the objects of this context while it's still current.
+  framebuffers_.clear();
+  uploaders_.clear();
+  output_framebuffer_.Reset();
+  DeletionQueue::SetCurrent(nullptr);
+  deletion_queue.Flush();
+  ForgetCurrentContext();
+  eglMakeCurrent(display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  eglReleaseThread();
+}
+
+std::future<bool> FilterExecutor::Submit(const Job& job) {
+  PendingJob pending_job;
+  pending_job.job = job;
+  std::future<bool> result = pending_job.promise.get_future();
+  // Announces the submission before checking `should_stop_`, which
+  // `Finalize()` sets before checking the number of submissions, so either
+  // this job is refused here or `Finalize()` waits for it to be queued.
+  ++number_of_submissions_;
+  if (!is_initialized_ || should_stop_) {
+    --number_of_submissions_;
+    pending_job.promise.set_value(false);
+    return result;
+  }
+
+  queue_.Push(std::move(pending_job));
+  --number_of_submissions_;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (is_sleeping_.load(std::memory_order_relaxed)) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wake_condition_.notify_one();
+  }
+  return result;
+}
+
+}  // namespace glfc
+
+#endif  // GLFC_EGL
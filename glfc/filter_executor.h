@@ -0,0 +1,184 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_FILTER_EXECUTOR_H_
+#define GLFC_FILTER_EXECUTOR_H_
+
+#ifdef GLFC_EGL
+
+#include <EGL/egl.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/egl_context.h"
+#include "glfc/gl_handle.h"
+#include "glfc/mpsc_queue.h"
+#include "glfc/opengl_hook.h"
+
+namespace glfc {
+
+class Filter;
+class Framebuffer;
+class TextureUploader;
+
+// This class renders filter jobs on a dedicated thread owning an EGL context
+// in the share group of the context passed to the constructor, so threads
+// without a current context can request filters. Jobs are pushed to a
+// lock-free queue, which is all the work done on the submitting thread. The
+// executor thread drains the queue in batches, renders the whole batch and
+// synchronizes once before completing every job of the batch.
+class FilterExecutor {
+ public:
+  // Describes a single filter job. Exactly one input and one output should
+  // be specified.
+  struct Job {
+    Job() : height(0), input_pixels(nullptr), input_texture(0),
+            output_pixels(nullptr), output_texture(0), width(0) {}
+
+    // Called on the executor thread once the job completes. The argument
+    // indicates whether the job succeeded. Jobs still queued when the
+    // executor stops fail on the executor thread as well.
+    std::function<void(const bool succeeded)> callback;
+
+    // The filter to render. The executor uses it exclusively until the job
+    // completes, so its parameters must not change in the meantime. A filter
+    // whose last reference is held by a job is destroyed on the executor
+    // thread with its context current.
+    std::shared_ptr<Filter> filter;
+
+    // The height of the input and output in pixels.
+    int height;
+
+    // The tightly-packed `GL_RGBA` input pixels, which must stay valid until
+    // the job completes.
+    const void* input_pixels;
+
+    // The input texture, which must belong to the share group.
+    GLuint input_texture;
+
+    // The memory receiving the tightly-packed `GL_RGBA` output pixels, with
+    // the bottom row first.
+    void* output_pixels;
+
+    // The `GL_RGBA` output texture of `width` x `height`, which must belong
+    // to the share group.
+    GLuint output_texture;
+
+    // The width of the input and output in pixels.
+    int width;
+  };
+
+  // Creates an executor whose context shares objects with `share_context`
+  // on `display`. `share_context` can be `EGL_NO_CONTEXT`.
+  FilterExecutor(EGLDisplay display, EGLContext share_context);
+  ~FilterExecutor();
+
+  // Creates the context and starts the executor thread. Returns `false` on
+  // failure.
+  bool Init();
+
+  // Queues `job` and returns the future receiving whether the job succeeded.
+  // This method can be called from any thread. The future always receives a
+  // result, which is `false` if the executor isn't running or stops before
+  // rendering the job.
+  std::future<bool> Submit(const Job& job);
+
+ private:
+  // A queued job along with the promise fulfilled on completion.
+  struct PendingJob {
+    Job job;
+    std::promise<bool> promise;
+  };
+
+  // Stops the executor thread after completing all queued jobs. The jobs
+  // queued in the meantime are failed by the executor thread before it
+  // exits.
+  void Finalize();
+
+  // Renders `batch` and completes its jobs.
+  void RenderBatch(std::vector<PendingJob>* batch);
+
+  // Renders `job` using the objects reserved for `slot` in a batch. Returns
+  // `false` on failure.
+  bool RenderJob(const Job& job, const size_t slot);
+
+  // The loop of the executor thread. `started` receives whether the context
+  // has been made current.
+  void Run(std::promise<bool>* started);
+
+  // The executor context.
+  EglContext context_;
+
+  // The display of the executor context.
+  EGLDisplay display_;
+
+  // The framebuffers holding the results of each batch slot whose output is
+  // client memory.
+  std::vector<std::unique_ptr<Framebuffer>> framebuffers_;
+
+  // Indicates if the executor has been initialized. This is read by
+  // `Submit()` on any thread.
+  std::atomic<bool> is_initialized_;
+
+  // Indicates whether the executor thread is waiting for jobs.
+  std::atomic<bool> is_sleeping_;
+
+  // Guards sleeping and waking the executor thread.
+  std::mutex mutex_;
+
+  // The number of `Submit()` calls that may still push a job, which
+  // `Finalize()` waits to reach 0 before failing the remaining jobs.
+  std::atomic<int> number_of_submissions_;
+
+  // The framebuffer object used for rendering to output textures.
+  FramebufferHandle output_framebuffer_;
+
+  // The queued jobs.
+  MpscQueue<PendingJob> queue_;
+
+  // The context passed to the constructor.
+  EGLContext share_context_;
+
+  // Indicates whether the executor thread should stop once the queue is
+  // empty.
+  std::atomic<bool> should_stop_;
+
+  // The executor thread.
+  std::thread thread_;
+
+  // The uploaders of each batch slot whose input is client memory.
+  std::vector<std::unique_ptr<TextureUploader>> uploaders_;
+
+  // Signaled when a job is queued while the executor thread is sleeping.
+  std::condition_variable wake_condition_;
+
+  GLFC_DISALLOW_COPY_AND_ASSIGN(FilterExecutor);
+};
+
+}  // namespace glfc
+
+#endif  // GLFC_EGL
+
+#endif  // GLFC_FILTER_EXECUTOR_H_
@@ -17,11 +17,16 @@
 
 #include "glfc/framebuffer.h"
 
+#include <cstddef>
 #include <cstdio>
+#include <utility>
 
 #include "glfc/base.h"
+#include "glfc/capabilities.h"
+#include "glfc/memory_usage.h"
 #include "glfc/opengl_hook.h"
 #include "glfc/program.h"
+#include "glfc/stats.h"
 
 namespace {
 
@@ -44,21 +49,68 @@ void main() {
   gl_FragColor = texture2D(inputImageTexture, textureCoordinate);
 })";
 
+// Returns `true` if the color texture described by `descriptor` has a single
+// channel on the current context.
+bool IsSingleChannel(const glfc::FramebufferDescriptor& descriptor) {
+#ifdef GLFC_GL3_API
+  return descriptor.color_format == glfc::kFramebufferColorFormatR8 &&
+         glfc::GetCapabilities().supports_red_textures;
+#else
+  return false;
+#endif
+}
+
 }  // namespace
 
 namespace glfc {
 
 Framebuffer::Framebuffer(const int width, const int height)
-    : framebuffer_(0), height_(height), is_initialized_(false),
-      program_(nullptr), renderbuffer_(0), texture_(0), width_(width) {
+    : height_(height), is_initialized_(false), is_single_channel_(false),
+      width_(width) {
+}
+
+Framebuffer::Framebuffer(const int width, const int height,
+                         const FramebufferDescriptor& descriptor)
+    : descriptor_(descriptor), height_(height), is_initialized_(false),
+      is_single_channel_(false), width_(width) {
+}
+
+Framebuffer::Framebuffer(Framebuffer&& other)
+    : height_(0), is_initialized_(false), is_single_channel_(false),
+      width_(0) {
+  *this = std::move(other);
 }
 
 Framebuffer::~Framebuffer() {
   if (is_initialized_)
     Finalize();
+}
 
-  if (program_ != nullptr)
-    delete program_;
+Framebuffer& Framebuffer::operator=(Framebuffer&& other) {
+  if (this == &other)
+    return *this;
+
+  if (is_initialized_)
+    Finalize();
+  blend_dst_alpha_ = other.blend_dst_alpha_;
+  blend_dst_rgb_ = other.blend_dst_rgb_;
+  blend_is_enabled_ = other.blend_is_enabled_;
+  blend_src_alpha_ = other.blend_src_alpha_;
+  blend_src_rgb_ = other.blend_src_rgb_;
+  descriptor_ = other.descriptor_;
+  framebuffer_ = std::move(other.framebuffer_);
+  height_ = other.height_;
+  is_initialized_ = other.is_initialized_;
+  is_single_channel_ = other.is_single_channel_;
+  program_ = std::move(other.program_);
+  renderbuffer_ = std::move(other.renderbuffer_);
+  stats_ = std::move(other.stats_);
+  texture_ = std::move(other.texture_);
+  width_ = other.width_;
+  original_framebuffer_ = other.original_framebuffer_;
+  // The attachments are now released by this framebuffer.
+  other.is_initialized_ = false;
+  return *this;
 }
 
 bool Framebuffer::Init() {
@@ -66,11 +118,10 @@ bool Framebuffer::Init() {
     Finalize();
   }
 
-  if (program_ == nullptr) {
-    program_ = new Program;
+  if (!program_) {
+    program_.reset(new Program);
     if (!program_->Init(kVertexShader, kFragmentShader)) {
-      delete program_;
-      program_ = nullptr;
+      program_.reset();
   #ifdef DEBUG
       GLFC_LOG("!! Failed to initialize program for framebuffer.\n");
   #endif
@@ -86,16 +137,30 @@ bool Framebuffer::Init() {
   glGetIntegerv(GL_RENDERBUFFER_BINDING, &original_renderbuffer);
 
   // Creates the texture.
-  glGenTextures(1, &texture_);
-  glBindTexture(GL_TEXTURE_2D, texture_);
+  texture_ = TextureHandle::Create();
+  glBindTexture(GL_TEXTURE_2D, texture_.get());
   glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 #ifndef GLFC_GLES2
 	glPixelStorei(GL_UNPACK_ROW_LENGTH, width_);
 	glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
 	glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
 #endif
+  is_single_channel_ = IsSingleChannel(descriptor_);
+#ifdef GLFC_GL3_API
+  if (GetCapabilities().supports_immutable_textures) {
+    glTexStorage2D(GL_TEXTURE_2D, 1, is_single_channel_ ? GL_R8 : GL_RGBA8,
+                   width_, height_);
+  } else if (is_single_channel_) {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width_, height_, 0, GL_RED,
+                 GL_UNSIGNED_BYTE, NULL);
+  } else {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, NULL);
+  }
+#else
   glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA,
                GL_UNSIGNED_BYTE, NULL);
+#endif
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -109,23 +174,30 @@ bool Framebuffer::Init() {
   glBindTexture(GL_TEXTURE_2D, 0);
 
   // Creates the framebuffer object.
-  glGenFramebuffers(1, &framebuffer_);
-  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  framebuffer_ = FramebufferHandle::Create();
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_.get());
 
-  // Creates the renderbuffer object.
-  glGenRenderbuffers(1, &renderbuffer_);
-  glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer_);
-  glRenderbufferStorage(GL_RENDERBUFFER, GL_STENCIL_INDEX8, width_, height_);
   glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                         texture_, 0);
-  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT,
-                            GL_RENDERBUFFER, renderbuffer_);
+                         texture_.get(), 0);
+
+  // Creates the stencil renderbuffer object if requested.
+  if (descriptor_.has_stencil_attachment) {
+    renderbuffer_ = RenderbufferHandle::Create();
+    glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer_.get());
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_STENCIL_INDEX8, width_,
+                          height_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_STENCIL_ATTACHMENT,
+                              GL_RENDERBUFFER, renderbuffer_.get());
+  }
 
   // Returns the result and restores the original framebuffer and renderbuffer.
   const bool kResult = glCheckFramebufferStatus(GL_FRAMEBUFFER) == \
                        GL_FRAMEBUFFER_COMPLETE;
   if (kResult) {
     is_initialized_ = true;
+    internal::TrackFramebufferMemory(
+        static_cast<std::ptrdiff_t>(GetEstimatedMemoryUsage()));
+    stats_ = internal::CountFramebufferAllocation(GetEstimatedMemoryUsage());
   } else {
     Finalize();
   }
@@ -136,7 +208,7 @@ bool Framebuffer::Init() {
 
 void Framebuffer::Bind() {
   glGetIntegerv(GL_FRAMEBUFFER_BINDING, &original_framebuffer_);
-  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_.get());
   blend_is_enabled_ = glIsEnabled(GL_BLEND);
   if (blend_is_enabled_) {
     glGetIntegerv(GL_BLEND_SRC_RGB, &blend_src_rgb_);
@@ -152,29 +224,74 @@ void Framebuffer::Bind() {
 void Framebuffer::Clear() {
   glViewport(0, 0, width_, height_);
   glClearColor(0, 0, 0, 0);
-  glClear(GL_COLOR_BUFFER_BIT);
+  if (renderbuffer_) {
+    glClearStencil(0);
+    glClear(GL_COLOR_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+  } else {
+    glClear(GL_COLOR_BUFFER_BIT);
+  }
+}
+
+void Framebuffer::Discard() const {
+#if defined GLFC_GLES3 || (defined GLFC_IOS && defined GLFC_GLES2)
+#if defined GLFC_GLES3
+  if (!GetCapabilities().supports_invalidate_framebuffer)
+    return;
+#endif
+  GLenum attachments[2];
+  GLsizei number_of_attachments = 0;
+  attachments[number_of_attachments++] = GL_COLOR_ATTACHMENT0;
+  if (renderbuffer_)
+    attachments[number_of_attachments++] = GL_STENCIL_ATTACHMENT;
+
+  // Both functions operate on the currently binded framebuffer.
+  GLint current_framebuffer;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &current_framebuffer);
+  const bool kShouldBind = static_cast<GLuint>(current_framebuffer) != \
+                           framebuffer_.get();
+  if (kShouldBind)
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_.get());
+#if defined GLFC_GLES3
+  glInvalidateFramebuffer(GL_FRAMEBUFFER, number_of_attachments, attachments);
+#else
+  glDiscardFramebufferEXT(GL_FRAMEBUFFER, number_of_attachments, attachments);
+#endif
+  if (kShouldBind)
+    glBindFramebuffer(GL_FRAMEBUFFER, current_framebuffer);
+#endif  // GLFC_GLES3 || (GLFC_IOS && GLFC_GLES2)
 }
 
 void Framebuffer::Finalize() {
-  if (framebuffer_ > 0) {
-    glDeleteFramebuffers(1, &framebuffer_);
-    framebuffer_ = 0;
-  }
-  if (renderbuffer_ > 0) {
-    glDeleteRenderbuffers(1, &renderbuffer_);
-    renderbuffer_ = 0;
-  }
-  if (texture_ > 0) {
-    glDeleteTextures(1, &texture_);
-    texture_ = 0;
+  if (is_initialized_) {
+    internal::TrackFramebufferMemory(
+        -static_cast<std::ptrdiff_t>(GetEstimatedMemoryUsage()));
+    internal::CountFramebufferRelease(stats_.get(),
+                                      GetEstimatedMemoryUsage());
   }
+  stats_.reset();
+
+  framebuffer_.Reset();
+  renderbuffer_.Reset();
+  texture_.Reset();
   is_initialized_ = false;
 }
 
+size_t Framebuffer::GetEstimatedMemoryUsage() const {
+  if (!is_initialized_)
+    return 0;
+
+  const size_t kNumberOfPixels = static_cast<size_t>(width_) * height_;
+  // GL_R8 or GL_RGBA + GL_UNSIGNED_BYTE
+  size_t bytes = kNumberOfPixels * (is_single_channel_ ? 1 : 4);
+  if (renderbuffer_)
+    bytes += kNumberOfPixels;  // GL_STENCIL_INDEX8
+  return bytes;
+}
+
 void Framebuffer::Render() const {
   program_->Use();
   glBlendFunc(GL_ONE, GL_ZERO);
-  program_->Render(texture_);
+  program_->Render(texture_.get());
 }
 
 void Framebuffer::Unbind() const {
@@ -18,21 +18,56 @@
 #ifndef GLFC_FRAMEBUFFER_H_
 #define GLFC_FRAMEBUFFER_H_
 
+#include <cstddef>
+#include <memory>
+
 #include "glfc/base.h"
+#include "glfc/gl_handle.h"
 #include "glfc/opengl_hook.h"
+#include "glfc/stats.h"
 
 namespace glfc {
 
 // Forward declaration.
 class Program;
 
+// The formats of the color texture of a `Framebuffer`.
+enum FramebufferColorFormat {
+  // 8-bit RGBA.
+  kFramebufferColorFormatRGBA8,
+  // 8-bit red only, which takes a quarter of the memory and bandwidth for
+  // single channel results. Contexts without `GL_RED` textures fall back to
+  // RGBA8 with the same red channel.
+  kFramebufferColorFormatR8,
+};
+
+// Describes the attachments allocated by a `Framebuffer`. The color texture is
+// always allocated, all other attachments are opt-in.
+struct FramebufferDescriptor {
+  FramebufferDescriptor()
+      : color_format(kFramebufferColorFormatRGBA8),
+        has_stencil_attachment(false) {}
+
+  // The format of the color texture.
+  FramebufferColorFormat color_format;
+
+  // Indicates whether a `GL_STENCIL_INDEX8` renderbuffer should be attached.
+  bool has_stencil_attachment;
+};
+
 // This class manages the life cycle of an OpenGL framebuffer object that is
-// designed to render to a texutre.
+// designed to render to a texutre. Framebuffers can be moved but not copied,
+// so they can be held by value.
 class Framebuffer {
  public:
   Framebuffer(const int width, const int height);
+  Framebuffer(const int width, const int height,
+              const FramebufferDescriptor& descriptor);
+  Framebuffer(Framebuffer&& other);
   ~Framebuffer();
 
+  Framebuffer& operator=(Framebuffer&& other);
+
   // Initializes the framebuffer object and corresponded renderbuffer and
   // texture objects. Returns `false` on failure.
   bool Init();
@@ -40,9 +75,16 @@ class Framebuffer {
   // Binds the framebuffer object.
   void Bind();
 
-  // Clears the color buffer.
+  // Clears the color buffer, and the stencil buffer if attached.
   void Clear();
 
+  // Tells the driver that the contents of all attachments are no longer
+  // needed so it doesn't have to preserve them. This should be called on
+  // transient intermediates once their contents have been consumed. It is a
+  // no-op on platforms supporting neither `glInvalidateFramebuffer()` nor
+  // `glDiscardFramebufferEXT()`.
+  void Discard() const;
+
   // Renders the internal texture to the framebuffer that is currently binded
   // to OpenGL. This method should be called when the framebuffer instance
   // itself is not binded.
@@ -51,9 +93,14 @@ class Framebuffer {
   // Unbinds the framebuffer object and resotres the original one.
   void Unbind() const;
 
+  // Returns the estimated number of bytes of GPU memory held by the
+  // attachments. Returns 0 if the framebuffer is not initialized.
+  size_t GetEstimatedMemoryUsage() const;
+
   // Accessors.
+  const FramebufferDescriptor& descriptor() const { return descriptor_; }
   const int height() const { return height_; }
-  GLuint texture() const { return texture_; }
+  GLuint texture() const { return texture_.get(); }
   const int width() const { return width_; }
 
  private:
@@ -79,26 +126,38 @@ class Framebuffer {
   // framebuffer so it can be restored when unbinding.
   GLint blend_src_rgb_;
 
-  // The framebuffer object name.
-  GLuint framebuffer_;
+  // The attachments to allocate in `Init()`.
+  FramebufferDescriptor descriptor_;
+
+  // The framebuffer object.
+  FramebufferHandle framebuffer_;
 
   // The height of the framebuffer.
-  const int height_;
+  int height_;
 
   // Indicates if the framebuffer has been initialized.
   bool is_initialized_;
 
-  // The strong reference to the corresponded program object.
-  Program* program_;
+  // Indicates whether the color texture was allocated with a single channel,
+  // which depends on the descriptor and the capabilities of the context.
+  bool is_single_channel_;
+
+  // The program rendering the texture in `Render()`.
+  std::unique_ptr<Program> program_;
+
+  // The stencil renderbuffer object. This is empty if the descriptor doesn't
+  // ask for a stencil attachment.
+  RenderbufferHandle renderbuffer_;
 
-  // The renderbuffer object name.
-  GLuint renderbuffer_;
+  // The statistics the framebuffer was counted against when initialized,
+  // which are updated when it's finalized.
+  std::shared_ptr<internal::ContextStats> stats_;
 
-  // The texture name.
-  GLuint texture_;
+  // The color texture.
+  TextureHandle texture_;
 
   // The width of the framebuffer.
-  const int width_;
+  int width_;
 
   // The name of the original framebuffer before binding.
   GLint original_framebuffer_;
@@ -17,66 +17,46 @@
 
 #include "glfc/gaussian_blur_filter.h"
 
-#include <algorithm>
 #include <cmath>
-#include <cstdlib>
-#include <string>
+#include <vector>
 
-#include "glfc/framebuffer.h"
-#include "glfc/opengl_hook.h"
-#include "glfc/program.h"
+#include "glfc/base.h"
 
-namespace glfc {
+namespace {
 
-GaussianBlurFilter::GaussianBlurFilter() : blur_radius_(2),
-                                           sigma_(2),
-                                           texel_height_offset_(0),
-                                           texel_spacing_multiplier_(1),
-                                           texel_width_offset_(0),
-                                           should_update_shaders_(false) {
-}
+// The maximum radius in pixels returned by `GetRadiusForTruncationError()`.
+// Tiny errors or huge sigmas would otherwise produce kernels with millions
+// of taps.
+const int kMaxRadiusForTruncationError = 1024;
 
-GaussianBlurFilter::~GaussianBlurFilter() {
-}
+}  // namespace
 
-void GaussianBlurFilter::ApplyFilterToFramebuffer(const GLuint input_texture,
-                                                  Program* program,
-                                                  Framebuffer* framebuffer) {
-  should_update_shaders_ = false;
+namespace glfc {
 
-  // First pass. Applies Gaussian blur to the input texture for horizontal
-  // direction.
-  framebuffer->Bind();
-  framebuffer->Clear();
-  texel_width_offset_ = texel_spacing_multiplier_ / framebuffer->width();
-  texel_height_offset_ = 0;
-  program->Use();
-  SetUniforms(program);
-  program->Render(input_texture);
-  framebuffer->Unbind();
+GaussianBlurFilter::GaussianBlurFilter()
+    : blur_radius_(2), max_truncation_error_(0), sigma_(2) {
+}
 
-  // Second pass. Applies Gaussian blur to the `framebuffer`'s internal texture
-  // for vertical direction.
-  texel_width_offset_ = 0;
-  texel_height_offset_ = texel_spacing_multiplier_ / framebuffer->height();
-  program->Use();
-  glBlendFunc(GL_ONE, GL_ZERO);
-  SetUniforms(program);
-  program->Render(framebuffer->texture());
+GaussianBlurFilter::~GaussianBlurFilter() {
 }
 
-std::string GaussianBlurFilter::GetFragmentShader() const {
-  const int kBlurRadius = std::round(blur_radius_ * device_pixel_ratio());
-  if (kBlurRadius <= 0) return "";
-  const float kSigma = sigma_ * device_pixel_ratio();
+std::vector<float> GaussianBlurFilter::GetKernel(
+    const float device_pixel_ratio) const {
+  const float kSigma = sigma_ * device_pixel_ratio;
+  int blur_radius;
+  if (max_truncation_error_ > 0) {
+    blur_radius = GetRadiusForTruncationError(kSigma, max_truncation_error_);
+    // A sigma too small to spread beyond the center keeps the input as is.
+    if (blur_radius <= 0) return std::vector<float>(1, 1);
+  } else {
+    blur_radius = std::round(blur_radius_ * device_pixel_ratio);
+    if (blur_radius <= 0) return std::vector<float>();
+  }
 
   // First, generate the normal Gaussian weights for a given sigma.
-  const int kNumberOfWeights = kBlurRadius + 2;
-  float* standard_gaussian_weights = reinterpret_cast<float*>(
-      std::calloc(kNumberOfWeights, sizeof(float)));
-  standard_gaussian_weights[kNumberOfWeights - 1] = 0;
+  std::vector<float> standard_gaussian_weights(blur_radius + 1);
   float sum_of_weights = 0.0;
-  for (int index = 0; index < kNumberOfWeights - 1; index++) {
+  for (int index = 0; index <= blur_radius; index++) {
     standard_gaussian_weights[index] = \
         (1.0 / std::sqrt(2.0 * M_PI * std::pow(kSigma, 2.0)))
         * std::exp(-std::pow(index, 2.0) / (2.0 * std::pow(kSigma, 2.0)));
@@ -89,228 +69,31 @@ std::string GaussianBlurFilter::GetFragmentShader() const {
 
   // Next, normalize these weights to prevent the clipping of the Gaussian
   // curve at the end of the discrete samples from reducing luminance.
-  for (int index = 0; index < kNumberOfWeights - 1; index++) {
-    standard_gaussian_weights[index] = \
-        standard_gaussian_weights[index] / sum_of_weights;
-  }
-
-  // From these weights we calculate the offsets to read interpolated values
-  // from.
-  const int kNumberOfOptimizedOffsets = \
-      std::min(kBlurRadius / 2 + (kBlurRadius % 2), 7);
-  const int kTruekNumberOfOptimizedOffsets = \
-      kBlurRadius / 2 + (kBlurRadius % 2);
-
-  std::string shader_string;
-  // Header
-  const char* kHeaderFormat = R"(
-precision mediump float;
-uniform sampler2D inputImageTexture;
-uniform float texelWidthOffset;
-uniform float texelHeightOffset;
-
-varying vec2 blurCoordinates[%lu];
-
-void main() {
-  vec4 sum = vec4(0.0);)";
-
-  const int kNumberOfBlurCoordinates = 1 + (kNumberOfOptimizedOffsets * 2);
-  const int kHeaderLength = snprintf(NULL, 0, kHeaderFormat,
-                                     kNumberOfBlurCoordinates) + 1;
-  char header[kHeaderLength];
-  snprintf(header, kHeaderLength, kHeaderFormat, kNumberOfBlurCoordinates);
-  shader_string.append(header);
-
-  // Inner texture loop.
-  const char* kInnerTextureLoopFirstLineFormat = R"(
-  sum += texture2D(inputImageTexture, blurCoordinates[0]) * %f;)";
-  const int kInnerTextureLoopFirstLineLength = \
-      snprintf(NULL, 0, kInnerTextureLoopFirstLineFormat,
-      standard_gaussian_weights[0]) + 1;
-  char inner_texture_loop_first_line[kInnerTextureLoopFirstLineLength];
-  snprintf(inner_texture_loop_first_line, kInnerTextureLoopFirstLineLength,
-           kInnerTextureLoopFirstLineFormat, standard_gaussian_weights[0]);
-  shader_string.append(inner_texture_loop_first_line);
-
-  const char* kInnerTextureLoopFormat = R"(
-  sum += texture2D(inputImageTexture, blurCoordinates[%d]) * %f;
-  sum += texture2D(inputImageTexture, blurCoordinates[%d]) * %f;)";
-  for (int current_blur_coordinate_index = 0;
-       current_blur_coordinate_index < kNumberOfOptimizedOffsets;
-       current_blur_coordinate_index++) {
-    const float kFirstWeight = \
-        standard_gaussian_weights[current_blur_coordinate_index * 2 + 1];
-    const float kSecondWeight = \
-        standard_gaussian_weights[current_blur_coordinate_index * 2 + 2];
-    const float kOptimizedWeight = kFirstWeight + kSecondWeight;
-
-    const int kFirstIndex = current_blur_coordinate_index * 2 + 1;
-    const int kSecondIndex = current_blur_coordinate_index * 2 + 2;
-
-    const int kStringLength = snprintf(NULL, 0, kInnerTextureLoopFormat,
-                                       kFirstIndex, kOptimizedWeight,
-                                       kSecondIndex, kOptimizedWeight) + 1;
-    char string[kStringLength];
-    snprintf(string, kStringLength, kInnerTextureLoopFormat, kFirstIndex,
-             kOptimizedWeight, kSecondIndex, kOptimizedWeight);
-    shader_string.append(string);
-  }
-
-  // If the number of required samples exceeds the amount we can pass in via
-  // varyings, we have to do dependent texture reads in the fragment shader.
-  if (kTruekNumberOfOptimizedOffsets > kNumberOfOptimizedOffsets) {
-    shader_string.append(R"(
-  vec2 singleStepOffset = vec2(texelWidthOffset, texelHeightOffset);)");
-
-    const char* kInnerTextureLoopFormat = R"(
-  sum += texture2D(inputImageTexture, blurCoordinates[0] + singleStepOffset * %f) * %f;
-  sum += texture2D(inputImageTexture, blurCoordinates[0] - singleStepOffset * %f) * %f;)";
-    for (int current_overlow_texture_read = kNumberOfOptimizedOffsets;
-         current_overlow_texture_read < kTruekNumberOfOptimizedOffsets;
-         current_overlow_texture_read++) {
-      const float kFirstWeight = \
-          standard_gaussian_weights[current_overlow_texture_read * 2 + 1];
-      const float kSecondWeight = \
-          standard_gaussian_weights[current_overlow_texture_read * 2 + 2];
-      const float kOptimizedWeight = kFirstWeight + kSecondWeight;
-      if (kOptimizedWeight != 0) {
-        const float kOptimizedOffset = \
-            (kFirstWeight * (current_overlow_texture_read * 2 + 1) +
-                kSecondWeight * (current_overlow_texture_read * 2 + 2))
-            / kOptimizedWeight;
-
-        const int kStringLength = \
-            snprintf(NULL, 0, kInnerTextureLoopFormat, kOptimizedOffset,
-                     kOptimizedWeight, kOptimizedOffset, kOptimizedWeight) + 1;
-        char string[kStringLength];
-        snprintf(string, kStringLength, kInnerTextureLoopFormat,
-                 kOptimizedOffset, kOptimizedWeight, kOptimizedOffset,
-                 kOptimizedWeight);
-        shader_string.append(string);
-      }
-    }
-  }
-
-  // Footer
-  shader_string.append(R"(
-  gl_FragColor = sum;
-})");
-
-  std::free(standard_gaussian_weights);
-  return shader_string;
+  for (float& weight : standard_gaussian_weights)
+    weight /= sum_of_weights;
+  return standard_gaussian_weights;
 }
 
-std::string GaussianBlurFilter::GetVertexShader() const {
-  const int kBlurRadius = std::round(blur_radius_ * device_pixel_ratio());
-  if (kBlurRadius <= 0) return "";
-  const float kSigma = sigma_ * device_pixel_ratio();
-
-  // First, generate the normal Gaussian weights for a given `sigma_`.
-  const int kNumberOfStandardGaussianWeights = kBlurRadius + 2;
-  float* standard_gaussian_weights = reinterpret_cast<float*>(
-      std::calloc(kNumberOfStandardGaussianWeights, sizeof(float)));
-  standard_gaussian_weights[kNumberOfStandardGaussianWeights - 1] = 0;
-  float sum_of_weights = 0.0;
-  for (int index = 0; index < kNumberOfStandardGaussianWeights - 1; index++) {
-    standard_gaussian_weights[index] = \
-        (1.0 / std::sqrt(2.0 * M_PI * std::pow(kSigma, 2.0)))
-        * std::exp(-std::pow(index, 2.0) / (2.0 * std::pow(kSigma, 2.0)));
-
-    if (index == 0)
-      sum_of_weights += standard_gaussian_weights[index];
-    else
-      sum_of_weights += 2.0 * standard_gaussian_weights[index];
-  }
-
-  // Next, normalize these weights to prevent the clipping of the Gaussian
-  // curve at the end of the discrete samples from reducing luminance.
-  for (int index = 0; index < kNumberOfStandardGaussianWeights - 1; index++) {
-    standard_gaussian_weights[index] = \
-        standard_gaussian_weights[index] / sum_of_weights;
-  }
-
-  // From these weights we calculate the offsets to read interpolated values
-  // from.
-  const int kNumberOfOptimizedOffsets = \
-      std::min(kBlurRadius / 2 + (kBlurRadius % 2), 7);
-  float* optimized_gaussian_offsets = reinterpret_cast<float*>(
-      std::calloc(kNumberOfOptimizedOffsets, sizeof(float)));
-
-  for (int index = 0; index < kNumberOfOptimizedOffsets; index++) {
-    const float kFirstWeight = standard_gaussian_weights[index * 2 + 1];
-    const float kSecondWeight = standard_gaussian_weights[index * 2 + 2];
-    const float kOptimizedWeight = kFirstWeight + kSecondWeight;
-
-    optimized_gaussian_offsets[index] = \
-        (kFirstWeight * (index * 2 + 1) + kSecondWeight * (index * 2 + 2))
-        / kOptimizedWeight;
-  }
-
-  std::string shader_string;
-  // Header
-  const char* kHeaderFormat = R"(
-precision mediump float;
-attribute vec4 position;
-attribute vec2 inputTextureCoordinate;
-
-uniform float texelWidthOffset;
-uniform float texelHeightOffset;
-
-varying vec2 blurCoordinates[%d];
-
-void main() {
-  gl_Position = position;
-
-  vec2 singleStepOffset = vec2(texelWidthOffset, texelHeightOffset);)";
-  const int kNumberOfBlurCoordinates = 1 + (kNumberOfOptimizedOffsets * 2);
-  const int kHeaderLength = snprintf(NULL, 0, kHeaderFormat,
-                                     kNumberOfBlurCoordinates) + 1;
-  char header[kHeaderLength];
-  snprintf(header, kHeaderLength, kHeaderFormat, kNumberOfBlurCoordinates);
-  shader_string.append(header);
-
-  // Inner offset loop.
-  shader_string.append(R"(
-  blurCoordinates[0] = inputTextureCoordinate.xy;)");
-  const char* kInnerOffsetLoopFormat = R"(
-  blurCoordinates[%d] = inputTextureCoordinate.xy + singleStepOffset * %f;
-  blurCoordinates[%d] = inputTextureCoordinate.xy - singleStepOffset * %f;)";
-  for (int index = 0; index < kNumberOfOptimizedOffsets; index++) {
-    const int kFirstIndex = (index * 2) + 1;
-    const int kSecondIndex = (index * 2) + 2;
-    const float kOptimizedGaussianOffset = optimized_gaussian_offsets[index];
-
-    const int kStringLength = \
-        snprintf(NULL, 0, kInnerOffsetLoopFormat, kFirstIndex,
-                 kOptimizedGaussianOffset, kSecondIndex,
-                 kOptimizedGaussianOffset) + 1;
-    char string[kStringLength];
-    snprintf(string, kStringLength, kInnerOffsetLoopFormat, kFirstIndex,
-             kOptimizedGaussianOffset, kSecondIndex, kOptimizedGaussianOffset);
-    shader_string.append(string);
+int GaussianBlurFilter::GetRadiusForTruncationError(
+    const float sigma, const float max_truncation_error) {
+  if (sigma <= 0 || max_truncation_error <= 0)
+    return 0;
+
+  // The weight beyond `radius` on both sides is the one of the continuous
+  // Gaussian beyond the edge of the last texel.
+  const float kScale = 1 / (sigma * std::sqrt(2.0f));
+  int radius = 0;
+  while (std::erfc((radius + 0.5f) * kScale) > max_truncation_error) {
+    if (radius == kMaxRadiusForTruncationError) {
+#ifdef DEBUG
+      GLFC_LOG("!! Clamped the radius for sigma %f and truncation error %g "
+               "to %d.\n", sigma, max_truncation_error, radius);
+#endif
+      break;
+    }
+    ++radius;
   }
-
-  // Footer
-  shader_string.append(R"(
-})");
-
-  std::free(optimized_gaussian_offsets);
-  std::free(standard_gaussian_weights);
-  return shader_string;
-}
-
-void GaussianBlurFilter::SetUniforms(Program* program) const {
-  GLint texel_width_offset_uniform = \
-      glGetUniformLocation(program->program(), "texelWidthOffset");
-  glUniform1f(texel_width_offset_uniform, texel_width_offset_);
-
-  GLint texel_height_offset_uniform = \
-      glGetUniformLocation(program->program(), "texelHeightOffset");
-  glUniform1f(texel_height_offset_uniform, texel_height_offset_);
-}
-
-bool GaussianBlurFilter::ShouldUpdateShaders() const {
-  return should_update_shaders_;
+  return radius;
 }
 
 }  // namespace glfc
@@ -18,92 +18,70 @@
 #ifndef GLFC_GAUSSIAN_BLUR_FILTER_H_
 #define GLFC_GAUSSIAN_BLUR_FILTER_H_
 
-#include <algorithm>
-#include <string>
+#include <vector>
 
 #include "glfc/base.h"
-#include "glfc/filter.h"
-#include "glfc/opengl_hook.h"
+#include "glfc/separable_convolution_filter.h"
 
 namespace glfc {
 
 // This class implements the Gaussian blur effect. The shaders used in this
 // class are ported from GPUImage's `GPUImageiOSBlurFilter` class with some
 // modifications. The original source code can be found at http://git.io/vmKcw.
-class GaussianBlurFilter : public Filter {
+// The shader generation is shared with other kernels in the
+// `SeparableConvolutionFilter` class.
+class GaussianBlurFilter : public SeparableConvolutionFilter {
  public:
   GaussianBlurFilter();
   ~GaussianBlurFilter();
 
+  // Returns the smallest radius in pixels of a kernel with `sigma` in pixels
+  // whose truncated tails hold at most `max_truncation_error` of the weight
+  // of the continuous Gaussian. The radius is clamped to 1024 pixels.
+  static int GetRadiusForTruncationError(const float sigma,
+                                         const float max_truncation_error);
+
+  // Inherited from `SeparableConvolutionFilter` class.
+  std::vector<float> GetKernel(const float device_pixel_ratio) const override;
+
   // Setters and accessors.
   float blur_radius() const { return blur_radius_; }
   void set_blur_radius(const float blur_radius) {
     if (blur_radius != blur_radius_) {
       blur_radius_ = blur_radius;
-      should_update_shaders_ = true;
+      InvalidateShaders();
+    }
+  }
+  float max_truncation_error() const { return max_truncation_error_; }
+  void set_max_truncation_error(const float max_truncation_error) {
+    if (max_truncation_error != max_truncation_error_) {
+      max_truncation_error_ = max_truncation_error;
+      InvalidateShaders();
     }
   }
   float sigma() const { return sigma_; }
   void set_sigma(const float sigma) {
     if (sigma != sigma_) {
       sigma_ = sigma;
-      should_update_shaders_ = true;
-    }
-  }
-  float texel_spacing_multiplier() const { return texel_spacing_multiplier_; }
-  void set_texel_spacing_multiplier(const float texel_spacing_multiplier) {
-    if (texel_spacing_multiplier != texel_spacing_multiplier_) {
-      texel_spacing_multiplier_ = texel_spacing_multiplier;
-      should_update_shaders_ = true;
+      InvalidateShaders();
     }
   }
 
  private:
-  virtual void set_device_pixel_ratio(const float ratio) final {
-    if (ratio != device_pixel_ratio()) {
-      Filter::set_device_pixel_ratio(ratio);
-      should_update_shaders_ = true;
-    }
-  }
-
-  // Inherited from `Filter` class.
-  virtual void ApplyFilterToFramebuffer(const GLuint input_texture,
-                                        Program* program,
-                                        Framebuffer* framebuffer) final;
-
-  // Inherited from `Filter` class.
-  std::string GetFragmentShader() const final;
-
-  // Inherited from `Filter` class.
-  std::string GetVertexShader() const final;
-
-  // Inherited from `Filter` class.
-  virtual void SetUniforms(Program* program) const final;
-
-  // Inherited from `Filter` class.
-  virtual bool ShouldUpdateShaders() const final;
-
   // The radius in points to use for the blur effect, with a default of 2.
   float blur_radius_;
 
+  // The maximum fraction of the Gaussian's weight that the kernel may drop
+  // at its tails. When positive, the kernel radius is derived from the sigma
+  // as the smallest one meeting this bound and `blur_radius_` is ignored, so
+  // small sigmas don't spend taps on negligible weights and large sigmas
+  // aren't truncated. The default value is 0, which uses `blur_radius_`.
+  float max_truncation_error_;
+
   // The sigma variable related to points used in Gaussian distribution
   // function for calculating the Gaussian weights.
   float sigma_;
 
-  // Indicates the vertical offset of a single step used in the vertex shader.
-  float texel_height_offset_;
-
-  // A multiplier for the spacing between texels, ranging from 0.0 on up, with
-  // a default of 1.0. Adjusting this value may slightly increase the blur
-  // strength but will introduce artifacs in the result.
-  float texel_spacing_multiplier_;
-
-  // Indicates the horizontal offset of a single step used in the vertex shader.
-  float texel_width_offset_;
-
-  // Indicates whether the shaders should update.
-  bool should_update_shaders_;
-
   GLFC_DISALLOW_COPY_AND_ASSIGN(GaussianBlurFilter);
 };
 
@@ -0,0 +1,157 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/gaussian_blur_pyramid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/framebuffer.h"
+#include "glfc/gaussian_blur_filter.h"
+#include "glfc/opengl_hook.h"
+#include "glfc/trace.h"
+
+namespace {
+
+// The number of sigmas covered by the radius of each blur.
+const float kRadiusInSigmas = 3;
+
+// The sigma in pixels that the input of a level must have been blurred with
+// per downsampled pixel to be sampled at the lower resolution without
+// aliasing.
+const float kMinSigmaPerDownsampledPixel = 2;
+
+// The maximum factor by which a level is rendered at a lower resolution.
+const int kMaxDownsampleFactor = 8;
+
+}  // namespace
+
+namespace glfc {
+
+GaussianBlurPyramid::GaussianBlurPyramid() : downsampling_enabled_(true) {
+}
+
+GaussianBlurPyramid::~GaussianBlurPyramid() {
+}
+
+int GaussianBlurPyramid::GetLevelDownsampleFactor(const int index) const {
+  if (index < 0 || index >= static_cast<int>(downsample_factors_.size()))
+    return 1;
+  return downsample_factors_[index];
+}
+
+GLuint GaussianBlurPyramid::GetLevelTexture(const int index) const {
+  if (index < 0 || index >= static_cast<int>(framebuffers_.size()) ||
+      !framebuffers_[index])
+    return 0;
+  return framebuffers_[index]->texture();
+}
+
+bool GaussianBlurPyramid::Render(const GLuint input_texture,
+                                 const float width, const float height,
+                                 const float device_pixel_ratio) {
+  GLFC_TRACE_SCOPE("GaussianBlurPyramid::Render");
+  for (size_t index = 0; index < sigmas_.size(); ++index) {
+    if (sigmas_[index] <= (index == 0 ? 0 : sigmas_[index - 1])) {
+#ifdef DEBUG
+      GLFC_LOG("!! Blur pyramid sigmas must be positive and increasing.\n");
+#endif
+      return false;
+    }
+  }
+
+  const int kNumberOfLevels = number_of_levels();
+  ResizeLevels(kNumberOfLevels);
+  downsample_factors_.assign(kNumberOfLevels, 1);
+
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+  bool result = true;
+  GLuint level_input_texture = input_texture;
+  float previous_sigma = 0;
+  for (int index = 0; result && index < kNumberOfLevels; ++index) {
+    // The input of the level has already been blurred with the previous
+    // sigma, which bounds how far it can be downsampled.
+    int downsample_factor = 1;
+    while (downsampling_enabled_ &&
+           downsample_factor * 2 <= kMaxDownsampleFactor &&
+           previous_sigma * device_pixel_ratio >= \
+               downsample_factor * 2 * kMinSigmaPerDownsampledPixel) {
+      downsample_factor *= 2;
+    }
+    downsample_factors_[index] = downsample_factor;
+
+    const float kSigma = sigmas_[index];
+    const float kIncrementalSigma = std::sqrt(
+        kSigma * kSigma - previous_sigma * previous_sigma);
+    previous_sigma = kSigma;
+    if (!filters_[index])
+      filters_[index].reset(new GaussianBlurFilter);
+    GaussianBlurFilter* filter = filters_[index].get();
+    filter->set_blur_radius(std::ceil(kIncrementalSigma * kRadiusInSigmas));
+    filter->set_sigma(kIncrementalSigma);
+
+    const float kDevicePixelRatio = device_pixel_ratio / downsample_factor;
+    const int kWidth = std::max(
+        1, static_cast<int>(std::round(width * kDevicePixelRatio)));
+    const int kHeight = std::max(
+        1, static_cast<int>(std::round(height * kDevicePixelRatio)));
+    std::unique_ptr<Framebuffer>& framebuffer = framebuffers_[index];
+    if (framebuffer &&
+        (framebuffer->width() != kWidth || framebuffer->height() != kHeight)) {
+      framebuffer.reset();
+    }
+    if (!framebuffer) {
+      framebuffer.reset(new Framebuffer(kWidth, kHeight));
+      if (!framebuffer->Init()) {
+        framebuffer.reset();
+#ifdef DEBUG
+        GLFC_LOG("!! Failed to initialize blur pyramid framebuffer.\n");
+#endif
+        result = false;
+        break;
+      }
+    }
+
+    framebuffer->Bind();
+    framebuffer->Clear();
+    result = filter->Render(level_input_texture, width, height,
+                            kDevicePixelRatio);
+    framebuffer->Unbind();
+    level_input_texture = framebuffer->texture();
+  }
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  return result;
+}
+
+void GaussianBlurPyramid::RenderLevel(const int index) const {
+  if (index < 0 || index >= static_cast<int>(framebuffers_.size()) ||
+      !framebuffers_[index])
+    return;
+  framebuffers_[index]->Render();
+}
+
+void GaussianBlurPyramid::ResizeLevels(const int count) {
+  filters_.resize(count);
+  framebuffers_.resize(count);
+}
+
+}  // namespace glfc
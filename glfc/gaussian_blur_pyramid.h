@@ -0,0 +1,110 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_GAUSSIAN_BLUR_PYRAMID_H_
+#define GLFC_GAUSSIAN_BLUR_PYRAMID_H_
+
+#include <memory>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/opengl_hook.h"
+
+namespace glfc {
+
+// Forward declarations.
+class Framebuffer;
+class GaussianBlurFilter;
+
+// This class renders several Gaussian blurs of increasing sigma of the same
+// input in one run, such as for layered frosted surfaces.
+//
+// Blurring with sigma `a` and then with sigma `b` is the same as blurring
+// once with sigma `sqrt(a^2 + b^2)`, so each level is rendered from the
+// previous one with only the missing sigma, which takes fewer taps than
+// blurring the input from scratch. Since the previous level has already
+// removed the fine details, a level may also be rendered at a lower
+// resolution without aliasing, which keeps the number of taps and pixels of
+// the wide blurs small. The total cost is therefore well below the one of
+// rendering each blur independently.
+//
+// The levels are kept in internal framebuffers after `Render()` and can be
+// drawn with `RenderLevel()` or sampled through `GetLevelTexture()` until the
+// next call to `Render()`.
+class GaussianBlurPyramid {
+ public:
+  GaussianBlurPyramid();
+  ~GaussianBlurPyramid();
+
+  // Renders all levels of `input_texture`, whose size is `width` x `height`
+  // in points. Returns `false` on failure or if the sigmas are not strictly
+  // increasing.
+  bool Render(const GLuint input_texture, const float width,
+              const float height, const float device_pixel_ratio);
+
+  // Renders the blur of the level at `index` to the framebuffer that is
+  // currently binded to OpenGL, scaling it up if it was rendered at a lower
+  // resolution.
+  void RenderLevel(const int index) const;
+
+  // Returns the factor by which the level at `index` was rendered at a lower
+  // resolution than the input.
+  int GetLevelDownsampleFactor(const int index) const;
+
+  // Returns the texture holding the blur of the level at `index`. Its
+  // dimensions are the ones of the input divided by
+  // `GetLevelDownsampleFactor()`.
+  GLuint GetLevelTexture(const int index) const;
+
+  // Returns the number of levels.
+  int number_of_levels() const { return static_cast<int>(sigmas_.size()); }
+
+  // Setters and accessors.
+  bool downsampling_enabled() const { return downsampling_enabled_; }
+  void set_downsampling_enabled(const bool downsampling_enabled) {
+    downsampling_enabled_ = downsampling_enabled;
+  }
+  const std::vector<float>& sigmas() const { return sigmas_; }
+  void set_sigmas(const std::vector<float>& sigmas) { sigmas_ = sigmas; }
+
+ private:
+  // Resizes the filters and framebuffers to `count` levels. The ones beyond
+  // `count` are deleted and new ones are left empty.
+  void ResizeLevels(const int count);
+
+  // The downsample factor of each level.
+  std::vector<int> downsample_factors_;
+
+  // Indicates whether wide levels may be rendered at a lower resolution. The
+  // default value is `true`.
+  bool downsampling_enabled_;
+
+  // The blur filter of each level.
+  std::vector<std::unique_ptr<GaussianBlurFilter>> filters_;
+
+  // The framebuffer holding each level.
+  std::vector<std::unique_ptr<Framebuffer>> framebuffers_;
+
+  // The sigma in points of each level in increasing order.
+  std::vector<float> sigmas_;
+
+  GLFC_DISALLOW_COPY_AND_ASSIGN(GaussianBlurPyramid);
+};
+
+}  // namespace glfc
+
+#endif  // GLFC_GAUSSIAN_BLUR_PYRAMID_H_
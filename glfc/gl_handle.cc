@@ -0,0 +1,180 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/gl_handle.h"
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "glfc/context_state.h"
+#include "glfc/opengl_hook.h"
+
+namespace {
+
+// Deletes `count` objects of `type` whose names are stored at `names`.
+void DeleteGlObjects(const glfc::GlObjectType type, const GLsizei count,
+                     const GLuint* names) {
+  switch (type) {
+    case glfc::kGlObjectTypeBuffer:
+      glDeleteBuffers(count, names);
+      break;
+    case glfc::kGlObjectTypeFramebuffer:
+      glDeleteFramebuffers(count, names);
+      break;
+    case glfc::kGlObjectTypeProgram:
+      for (GLsizei index = 0; index < count; ++index)
+        glDeleteProgram(names[index]);
+      break;
+#ifdef GLFC_GL3_API
+    case glfc::kGlObjectTypeQuery:
+      glDeleteQueries(count, names);
+      break;
+#endif
+    case glfc::kGlObjectTypeRenderbuffer:
+      glDeleteRenderbuffers(count, names);
+      break;
+    case glfc::kGlObjectTypeShader:
+      for (GLsizei index = 0; index < count; ++index)
+        glDeleteShader(names[index]);
+      break;
+    case glfc::kGlObjectTypeTexture:
+      glDeleteTextures(count, names);
+      break;
+#ifdef GLFC_GL3_API
+    case glfc::kGlObjectTypeVertexArray:
+      glDeleteVertexArrays(count, names);
+      break;
+#endif
+    default:
+      break;
+  }
+}
+
+}  // namespace
+
+namespace glfc {
+
+namespace internal {
+
+GLuint CreateGlObject(const GlObjectType type) {
+  GLuint name = 0;
+  switch (type) {
+    case kGlObjectTypeBuffer:
+      glGenBuffers(1, &name);
+      break;
+    case kGlObjectTypeFramebuffer:
+      glGenFramebuffers(1, &name);
+      break;
+    case kGlObjectTypeProgram:
+      name = glCreateProgram();
+      break;
+#ifdef GLFC_GL3_API
+    case kGlObjectTypeQuery:
+      glGenQueries(1, &name);
+      break;
+#endif
+    case kGlObjectTypeRenderbuffer:
+      glGenRenderbuffers(1, &name);
+      break;
+    case kGlObjectTypeTexture:
+      glGenTextures(1, &name);
+      break;
+#ifdef GLFC_GL3_API
+    case kGlObjectTypeVertexArray:
+      glGenVertexArrays(1, &name);
+      break;
+#endif
+    default:
+#ifdef DEBUG
+      GLFC_LOG("!! Unsupported type for creating GL object: %d\n", type);
+#endif
+      break;
+  }
+  return name;
+}
+
+void DeleteGlObject(const GlObjectType type, const GLuint name) {
+  if (name == 0)
+    return;
+
+  DeletionQueue* queue = DeletionQueue::GetCurrent();
+  if (queue != nullptr)
+    queue->Enqueue(type, name);
+  else
+    DeleteGlObjects(type, 1, &name);
+}
+
+}  // namespace internal
+
+DeletionQueue::DeletionQueue() {
+}
+
+DeletionQueue::~DeletionQueue() {
+  internal::UnbindDeletionQueue(this);
+  Flush();
+}
+
+DeletionQueue* DeletionQueue::GetCurrent() {
+  internal::ContextState* state = internal::GetCurrentContextState();
+  if (state == nullptr)
+    return nullptr;
+  if (state->bound_deletion_queue != nullptr)
+    return state->bound_deletion_queue;
+  return &state->default_deletion_queue;
+}
+
+void DeletionQueue::SetCurrent(DeletionQueue* queue) {
+  internal::ContextState* state = internal::GetCurrentContextState();
+  if (state == nullptr) {
+#ifdef DEBUG
+    GLFC_LOG("!! No current context to bind the deletion queue to.\n");
+#endif
+    return;
+  }
+  state->bound_deletion_queue = queue;
+}
+
+void DeletionQueue::Enqueue(const GlObjectType type, const GLuint name) {
+  if (name == 0)
+    return;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  names_[type].push_back(name);
+}
+
+void DeletionQueue::Flush() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (int type = 0; type < kNumberOfGlObjectTypes; ++type) {
+    std::vector<GLuint>& names = names_[type];
+    if (names.empty())
+      continue;
+    DeleteGlObjects(static_cast<GlObjectType>(type),
+                    static_cast<GLsizei>(names.size()), names.data());
+    names.clear();  // keeps the capacity for the next frame
+  }
+}
+
+size_t DeletionQueue::size() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t size = 0;
+  for (const std::vector<GLuint>& names : names_)
+    size += names.size();
+  return size;
+}
+
+}  // namespace glfc
@@ -0,0 +1,179 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+//
+// Move-only owners of OpenGL object names and a deletion queue that defers
+// their deletion.
+//
+// A handle releases its object when it is destroyed or reset, which enqueues
+// the name to the deletion queue of the context current on the calling
+// thread. The names are deleted with others of the same type by the next
+// `Flush()` of the queue. Each context has a default queue that is flushed
+// when the outermost `Filter::Render()` starts, which is the frame boundary
+// of glfc, and by `ForgetCurrentContext()`. A queue bound with
+// `DeletionQueue::SetCurrent()` replaces the default one and is flushed by
+// its owner. Objects are only deleted immediately if no context is current,
+// so the context that owns an object, or one in its share group, must be
+// current wherever its handle is destroyed.
+
+#ifndef GLFC_GL_HANDLE_H_
+#define GLFC_GL_HANDLE_H_
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/opengl_hook.h"
+
+namespace glfc {
+
+// The types of OpenGL objects owned by a `GlHandle`.
+enum GlObjectType {
+  kGlObjectTypeBuffer,
+  kGlObjectTypeFramebuffer,
+  kGlObjectTypeProgram,
+  // Only supported if `GLFC_GL3_API` is defined.
+  kGlObjectTypeQuery,
+  kGlObjectTypeRenderbuffer,
+  kGlObjectTypeShader,
+  kGlObjectTypeTexture,
+  // Only supported if `GLFC_GL3_API` is defined.
+  kGlObjectTypeVertexArray,
+  // The number of object types.
+  kNumberOfGlObjectTypes,
+};
+
+namespace internal {
+
+// Generates an object of `type`. Returns 0 on failure or for shaders, which
+// must be created with `glCreateShader()` and adopted by a handle.
+GLuint CreateGlObject(const GlObjectType type);
+
+// Deletes the object `name` of `type` through the deletion queue of the
+// current context, or immediately if no context is current.
+void DeleteGlObject(const GlObjectType type, const GLuint name);
+
+}  // namespace internal
+
+// Owns the name of an OpenGL object of `Type`. Handles can be moved but not
+// copied, so they can be stored by value in containers and pools.
+template <GlObjectType Type>
+class GlHandle {
+ public:
+  GlHandle() : name_(0) {}
+
+  // Adopts the object `name`.
+  explicit GlHandle(const GLuint name) : name_(name) {}
+
+  GlHandle(GlHandle&& other) : name_(other.Release()) {}
+
+  ~GlHandle() { Reset(); }
+
+  GlHandle& operator=(GlHandle&& other) {
+    if (this != &other)
+      Reset(other.Release());
+    return *this;
+  }
+
+  // Returns a handle owning a newly generated object. The handle is empty on
+  // failure.
+  static GlHandle Create() {
+    return GlHandle(internal::CreateGlObject(Type));
+  }
+
+  // Returns the owned name without giving up ownership.
+  GLuint get() const { return name_; }
+
+  // Gives up ownership of the name and returns it.
+  GLuint Release() {
+    const GLuint kName = name_;
+    name_ = 0;
+    return kName;
+  }
+
+  // Deletes the owned object, if any, and adopts `name`.
+  void Reset(const GLuint name = 0) {
+    if (name_ > 0 && name_ != name)
+      internal::DeleteGlObject(Type, name_);
+    name_ = name;
+  }
+
+  // Indicates whether the handle owns an object.
+  explicit operator bool() const { return name_ > 0; }
+
+ private:
+  // The owned object name, or 0 if the handle is empty.
+  GLuint name_;
+
+  GlHandle(const GlHandle&) = delete;
+  GlHandle& operator=(const GlHandle&) = delete;
+};
+
+typedef GlHandle<kGlObjectTypeBuffer> BufferHandle;
+typedef GlHandle<kGlObjectTypeFramebuffer> FramebufferHandle;
+typedef GlHandle<kGlObjectTypeProgram> ProgramHandle;
+typedef GlHandle<kGlObjectTypeQuery> QueryHandle;
+typedef GlHandle<kGlObjectTypeRenderbuffer> RenderbufferHandle;
+typedef GlHandle<kGlObjectTypeShader> ShaderHandle;
+typedef GlHandle<kGlObjectTypeTexture> TextureHandle;
+typedef GlHandle<kGlObjectTypeVertexArray> VertexArrayHandle;
+
+// Collects object names released by handles and deletes them in batches, one
+// `glDelete*()` call per type, so deletion stays off the hot path. A queue
+// belongs to one context, or one share group, and must only be flushed with
+// it current. Names can be enqueued from any thread.
+class DeletionQueue {
+ public:
+  DeletionQueue();
+
+  // Flushes the remaining names, so the context must be current.
+  ~DeletionQueue();
+
+  // Returns the queue of the context current on the calling thread, which
+  // is the default queue of the context unless another one is bound.
+  // Returns `nullptr` if no context is current.
+  static DeletionQueue* GetCurrent();
+
+  // Binds `queue` to the context current on the calling thread, so handles
+  // released with the context current on any thread enqueue their names to
+  // it. Passing `nullptr` restores the default queue of the context. A
+  // queue is unbound from its context when destroyed.
+  static void SetCurrent(DeletionQueue* queue);
+
+  // Enqueues the object `name` of `type` for deletion.
+  void Enqueue(const GlObjectType type, const GLuint name);
+
+  // Deletes all enqueued objects. This should be called at a safe frame
+  // boundary with the context of the queue current.
+  void Flush();
+
+  // Returns the number of enqueued names.
+  size_t size();
+
+ private:
+  // Guards `names_`.
+  std::mutex mutex_;
+
+  // The enqueued names indexed by `GlObjectType`.
+  std::vector<GLuint> names_[kNumberOfGlObjectTypes];
+
+  GLFC_DISALLOW_COPY_AND_ASSIGN(DeletionQueue);
+};
+
+}  // namespace glfc
+
+#endif  // GLFC_GL_HANDLE_H_
@@ -18,7 +18,28 @@
 #ifndef GLFC_GLFC_H_
 #define GLFC_GLFC_H_
 
+#include "glfc/adaptive_blur_controller.h"
+#include "glfc/capabilities.h"
+#include "glfc/color_stage.h"
+#include "glfc/context_group.h"
+#include "glfc/context_state.h"
+#include "glfc/cpu_renderer.h"
 #include "glfc/filter.h"
+#include "glfc/filter_executor.h"
 #include "glfc/gaussian_blur_filter.h"
+#include "glfc/gaussian_blur_pyramid.h"
+#include "glfc/gl_handle.h"
+#include "glfc/lut_filter.h"
+#include "glfc/memory_usage.h"
+#include "glfc/null_gl.h"
+#include "glfc/pixel_reader.h"
+#include "glfc/separable_convolution_filter.h"
+#include "glfc/shadow_filter.h"
+#include "glfc/stats.h"
+#include "glfc/texture_uploader.h"
+#include "glfc/tiled_renderer.h"
+#include "glfc/trace.h"
+#include "glfc/variable_blur_filter.h"
+#include "glfc/yuv.h"
 
 #endif  // GLFC_GLFC_H_
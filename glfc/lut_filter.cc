@@ -0,0 +1,392 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/lut_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/capabilities.h"
+#include "glfc/color_stage.h"
+#include "glfc/gl_handle.h"
+#include "glfc/memory_usage.h"
+#include "glfc/opengl_hook.h"
+#include "glfc/program.h"
+
+namespace {
+
+// The range of supported table sizes.
+const int kMaxSize = 256;
+const int kMinSize = 2;
+
+// The texture unit the table is bound to while rendering.
+const int kTextureUnit = 1;
+
+// Returns the number of columns of the grid the blue slices of a table with
+// `size` entries per axis are laid out in when stored in a 2D texture. The
+// grid is about square so neither side of the texture grows much beyond
+// `size` * sqrt(`size`) texels.
+int GetNumberOfGridColumns(const int size) {
+  return static_cast<int>(std::ceil(std::sqrt(static_cast<double>(size))));
+}
+
+// Returns the number of rows of the grid described by
+// `GetNumberOfGridColumns()`.
+int GetNumberOfGridRows(const int size) {
+  const int kNumberOfColumns = GetNumberOfGridColumns(size);
+  return (size + kNumberOfColumns - 1) / kNumberOfColumns;
+}
+
+// Returns the number of texels of the texture storing a table with `size`
+// entries per axis for `target`.
+size_t GetNumberOfTexels(const int size, const GLenum target) {
+  const size_t kNumberOfSliceTexels = static_cast<size_t>(size) * size;
+  if (target == GL_TEXTURE_2D) {
+    return kNumberOfSliceTexels * GetNumberOfGridColumns(size) *
+           GetNumberOfGridRows(size);
+  }
+  return kNumberOfSliceTexels * size;
+}
+
+}  // namespace
+
+namespace glfc {
+
+LutFilter::LutFilter()
+    : should_upload_table_(false), size_(0), texture_target_(GL_TEXTURE_2D) {
+}
+
+LutFilter::~LutFilter() {
+  ReleaseTexture();
+}
+
+bool LutFilter::ApplyFilterToFramebuffer(const GLuint input_texture,
+                                         Program* program,
+                                         Framebuffer* framebuffer) {
+  if (should_upload_table_ && !UploadTable())
+    return false;
+  // Renders nothing until a table is set.
+  if (!texture_)
+    return true;
+
+  glActiveTexture(GL_TEXTURE0 + kTextureUnit);
+  glBindTexture(texture_target_, texture_.get());
+  glActiveTexture(GL_TEXTURE0);
+  const bool kResult = Filter::ApplyFilterToFramebuffer(input_texture,
+                                                       program, framebuffer);
+  glActiveTexture(GL_TEXTURE0 + kTextureUnit);
+  glBindTexture(texture_target_, 0);
+  glActiveTexture(GL_TEXTURE0);
+  return kResult;
+}
+
+std::vector<float> LutFilter::BakeColorStages(
+    const std::vector<ColorStage>& color_stages, const int size) {
+  if (size < kMinSize || size > kMaxSize)
+    return std::vector<float>();
+
+  std::vector<float> table(static_cast<size_t>(size) * size * size * 3);
+  float* entry = table.data();
+  for (int blue = 0; blue < size; ++blue) {
+    for (int green = 0; green < size; ++green) {
+      for (int red = 0; red < size; ++red) {
+        float rgba[4] = {static_cast<float>(red) / (size - 1),
+                         static_cast<float>(green) / (size - 1),
+                         static_cast<float>(blue) / (size - 1), 1};
+        for (const ColorStage& stage : color_stages)
+          stage.Apply(rgba);
+        for (int channel = 0; channel < 3; ++channel)
+          *entry++ = std::min(std::max(rgba[channel], 0.0f), 1.0f);
+      }
+    }
+  }
+  return table;
+}
+
+std::string LutFilter::GetFragmentShader() const {
+  if (size_ == 0) return "";
+
+  if (GetCapabilities().supports_3d_textures) {
+    return R"(#version 300 es
+precision mediump float;
+precision mediump sampler3D;
+uniform sampler2D inputImageTexture;
+uniform sampler3D lutTexture;
+uniform float lutSize;
+in vec2 textureCoordinate;
+out vec4 fragColor;
+
+void main() {
+  vec4 color = texture(inputImageTexture, textureCoordinate);
+  vec3 coordinate = (color.rgb * (lutSize - 1.0) + 0.5) / lutSize;
+  fragColor = vec4(texture(lutTexture, coordinate).rgb, color.a);
+})";
+  }
+
+  // The coordinates within the 2D layout need more precision than mediump
+  // guarantees for larger tables. The `lutGrid` uniform holds the number of
+  // columns and rows of the grid of slices.
+  return R"(
+#ifdef GL_FRAGMENT_PRECISION_HIGH
+precision highp float;
+#else
+precision mediump float;
+#endif
+uniform sampler2D inputImageTexture;
+uniform sampler2D lutTexture;
+uniform vec2 lutGrid;
+uniform float lutSize;
+varying vec2 textureCoordinate;
+
+vec2 getSliceOrigin(float slice) {
+  float row = floor((slice + 0.5) / lutGrid.x);
+  return vec2(slice - row * lutGrid.x, row) / lutGrid;
+}
+
+void main() {
+  vec4 color = texture2D(inputImageTexture, textureCoordinate);
+  float blue = color.b * (lutSize - 1.0);
+  float slice = floor(blue);
+  float nextSlice = min(slice + 1.0, lutSize - 1.0);
+  vec2 coordinate = (color.rg * (lutSize - 1.0) + 0.5) / (lutSize * lutGrid);
+  vec3 first = texture2D(lutTexture, coordinate + getSliceOrigin(slice)).rgb;
+  vec3 second = texture2D(lutTexture,
+                          coordinate + getSliceOrigin(nextSlice)).rgb;
+  gl_FragColor = vec4(mix(first, second, blue - slice), color.a);
+})";
+}
+
+std::string LutFilter::GetVertexShader() const {
+  if (size_ == 0) return "";
+
+  if (GetCapabilities().supports_3d_textures) {
+    return R"(#version 300 es
+in vec4 position;
+in vec2 inputTextureCoordinate;
+out vec2 textureCoordinate;
+
+void main() {
+  gl_Position = position;
+  textureCoordinate = inputTextureCoordinate;
+})";
+  }
+
+  return R"(
+attribute vec4 position;
+attribute vec2 inputTextureCoordinate;
+varying vec2 textureCoordinate;
+
+void main() {
+  gl_Position = position;
+  textureCoordinate = inputTextureCoordinate;
+})";
+}
+
+bool LutFilter::LoadCubeFile(const std::string& path,
+                             std::vector<float>* table, int* size) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+#ifdef DEBUG
+    GLFC_LOG("!! Failed to open cube file: %s\n", path.c_str());
+#endif
+    return false;
+  }
+
+  int cube_size = 0;
+  std::vector<float> values;
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream stream(line);
+    std::string keyword;
+    if (!(stream >> keyword) || keyword[0] == '#' || keyword == "TITLE")
+      continue;
+
+    if (keyword == "LUT_3D_SIZE") {
+      stream >> cube_size;
+      if (cube_size < kMinSize || cube_size > kMaxSize)
+        return false;
+      values.reserve(static_cast<size_t>(cube_size) * cube_size * cube_size *
+                     3);
+    } else if (keyword == "DOMAIN_MIN" || keyword == "DOMAIN_MAX") {
+      const float kExpectedValue = keyword == "DOMAIN_MIN" ? 0 : 1;
+      float value;
+      for (int channel = 0; channel < 3; ++channel) {
+        if (!(stream >> value) || value != kExpectedValue) {
+#ifdef DEBUG
+          GLFC_LOG("!! Only the [0, 1] domain is supported for cube files.\n");
+#endif
+          return false;
+        }
+      }
+    } else if (keyword == "LUT_1D_SIZE") {
+#ifdef DEBUG
+      GLFC_LOG("!! 1D cube files are not supported.\n");
+#endif
+      return false;
+    } else {
+      // Each remaining line is an RGB triplet.
+      float green;
+      float blue;
+      if (!(stream >> green >> blue))
+        return false;
+      values.push_back(std::strtof(keyword.c_str(), nullptr));
+      values.push_back(green);
+      values.push_back(blue);
+    }
+  }
+
+  if (cube_size == 0 ||
+      values.size() != static_cast<size_t>(cube_size) * cube_size *
+                       cube_size * 3) {
+#ifdef DEBUG
+    GLFC_LOG("!! Malformed cube file: %s\n", path.c_str());
+#endif
+    return false;
+  }
+  table->swap(values);
+  *size = cube_size;
+  return true;
+}
+
+void LutFilter::ReleaseTexture() {
+  if (!texture_)
+    return;
+
+  texture_.Reset();
+  internal::TrackTextureMemory(-static_cast<std::ptrdiff_t>(
+      GetNumberOfTexels(size_, texture_target_) * 4));
+}
+
+void LutFilter::SetUniforms(Program* program) const {
+  glUniform1i(glGetUniformLocation(program->program(), "lutTexture"),
+              kTextureUnit);
+  glUniform1f(glGetUniformLocation(program->program(), "lutSize"), size_);
+  if (texture_target_ == GL_TEXTURE_2D) {
+    glUniform2f(glGetUniformLocation(program->program(), "lutGrid"),
+                GetNumberOfGridColumns(size_), GetNumberOfGridRows(size_));
+  }
+}
+
+bool LutFilter::SetTable(const std::vector<float>& table, const int size) {
+  if (size < kMinSize || size > kMaxSize ||
+      table.size() != static_cast<size_t>(size) * size * size * 3) {
+#ifdef DEBUG
+    GLFC_LOG("!! Invalid lookup table.\n");
+#endif
+    return false;
+  }
+
+  // The texture is released with the old size before it changes.
+  ReleaseTexture();
+  table_ = table;
+  size_ = size;
+  should_upload_table_ = true;
+  InvalidateCache();
+  return true;
+}
+
+bool LutFilter::UploadTable() {
+  // Converts the table to 8-bit RGBA texels. The order matches the 3D
+  // texture if the context supports one. Otherwise the blue slices are
+  // placed in a grid filled row by row, which keeps the 2D texture within
+  // the maximum texture size of OpenGL ES 2 devices for common tables, e.g.
+  // 585 x 520 texels for 65^3 entries. The shaders are generated with the
+  // same context, so they agree on the layout.
+  const bool kUses3dTexture = GetCapabilities().supports_3d_textures;
+  const int kNumberOfColumns = GetNumberOfGridColumns(size_);
+  const int kWidth = kNumberOfColumns * size_;
+  const int kHeight = GetNumberOfGridRows(size_) * size_;
+  if (!kUses3dTexture) {
+    GLint max_texture_size;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    if (kWidth > max_texture_size || kHeight > max_texture_size) {
+#ifdef DEBUG
+      GLFC_LOG("!! Lookup table of size %d exceeds the maximum texture "
+               "size.\n", size_);
+#endif
+      return false;
+    }
+  }
+  std::vector<unsigned char> texels(
+      GetNumberOfTexels(size_, kUses3dTexture ? GL_TEXTURE_3D :
+                                                GL_TEXTURE_2D) * 4);
+  for (int blue = 0; blue < size_; ++blue) {
+    const int kColumn = blue % kNumberOfColumns;
+    const int kRow = blue / kNumberOfColumns;
+    for (int green = 0; green < size_; ++green) {
+      for (int red = 0; red < size_; ++red) {
+        const size_t kIndex = (static_cast<size_t>(blue) * size_ + green) *
+                              size_ + red;
+        const size_t kTexelIndex = kUses3dTexture ? kIndex : \
+            (static_cast<size_t>(kRow) * size_ + green) * kWidth +
+            kColumn * size_ + red;
+        for (int channel = 0; channel < 3; ++channel) {
+          texels[kTexelIndex * 4 + channel] = static_cast<unsigned char>(
+              table_[kIndex * 3 + channel] * 255 + 0.5f);
+        }
+        texels[kTexelIndex * 4 + 3] = 255;
+      }
+    }
+  }
+
+  ReleaseTexture();
+  texture_ = TextureHandle::Create();
+  texture_target_ = GL_TEXTURE_2D;
+#ifdef GLFC_GL3_API
+  if (kUses3dTexture)
+    texture_target_ = GL_TEXTURE_3D;
+#endif
+  const GLenum kTarget = texture_target_;
+  glBindTexture(kTarget, texture_.get());
+  if (kTarget == GL_TEXTURE_2D) {
+    glTexImage2D(kTarget, 0, GL_RGBA, kWidth, kHeight, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, texels.data());
+  } else {
+#ifdef GLFC_GL3_API
+    glTexImage3D(kTarget, 0, GL_RGBA8, size_, size_, size_, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, texels.data());
+    glTexParameteri(kTarget, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+#endif
+  }
+  glTexParameteri(kTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(kTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(kTarget, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(kTarget, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(kTarget, 0);
+  if (glGetError() != GL_NO_ERROR) {
+    texture_.Reset();
+#ifdef DEBUG
+    GLFC_LOG("!! Failed to upload lookup table.\n");
+#endif
+    return false;
+  }
+  internal::TrackTextureMemory(static_cast<std::ptrdiff_t>(texels.size()));
+
+  // The table is no longer needed once uploaded.
+  should_upload_table_ = false;
+  std::vector<float>().swap(table_);
+  return true;
+}
+
+}  // namespace glfc
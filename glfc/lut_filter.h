@@ -0,0 +1,111 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_LUT_FILTER_H_
+#define GLFC_LUT_FILTER_H_
+
+#include <string>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/color_stage.h"
+#include "glfc/filter.h"
+#include "glfc/gl_handle.h"
+#include "glfc/opengl_hook.h"
+
+namespace glfc {
+
+// This class grades colors through a 3D lookup table in a single pass with
+// trilinear interpolation. The table is stored in a 3D texture if
+// `GetCapabilities()` reports support for one on the context it's rendered
+// with. Otherwise the blue slices are laid out in a grid of about
+// sqrt(`size`) columns in a 2D texture, which is interpolated bilinearly
+// within the slices and mixed between them in the fragment shader. The grid
+// must fit the maximum texture size, e.g. 4096 texels for 256^3 tables.
+//
+// A table has `size`^3 entries of RGB triplets in the [0, 1] range. The red
+// index changes fastest, then green, then blue, which is the order used by
+// .cube files. The table is applied to the stored color channels, so
+// premultiplied inputs should be unpremultiplied first if the grade isn't
+// linear. The alpha channel is kept.
+class LutFilter : public Filter {
+ public:
+  LutFilter();
+  ~LutFilter();
+
+  // Returns the table of `size`^3 entries approximating `color_stages`
+  // applied in order. Only the color channels are baked with an opaque
+  // alpha, stages depending on or modifying alpha can't be represented.
+  static std::vector<float> BakeColorStages(
+      const std::vector<ColorStage>& color_stages, const int size);
+
+  // Loads the 3D table of the .cube file at `path` into `table` and `size`.
+  // Returns `false` if the file can't be read, is malformed, or describes a
+  // 1D table or a domain other than [0, 1].
+  static bool LoadCubeFile(const std::string& path, std::vector<float>* table,
+                           int* size);
+
+  // Inherited from `Filter` class.
+  std::string GetFragmentShader() const final;
+
+  // Inherited from `Filter` class.
+  std::string GetVertexShader() const final;
+
+  // Sets the `table` of `size`^3 RGB triplets. Returns `false` if the size
+  // doesn't match or is out of the range [2, 256].
+  bool SetTable(const std::vector<float>& table, const int size);
+
+  // Accessors.
+  int size() const { return size_; }
+
+ private:
+  // Inherited from `Filter` class.
+  bool ApplyFilterToFramebuffer(const GLuint input_texture, Program* program,
+                                Framebuffer* framebuffer) final;
+
+  // Inherited from `Filter` class.
+  void SetUniforms(Program* program) const final;
+
+  // Deletes the texture of the table if any.
+  void ReleaseTexture();
+
+  // Uploads `table_` to `texture_`. Returns `false` on failure.
+  bool UploadTable();
+
+  // Indicates whether `table_` changed since it was uploaded.
+  bool should_upload_table_;
+
+  // The number of entries along each axis of the table. The default value is
+  // 0, which renders nothing until a table is set.
+  int size_;
+
+  // The table set by `SetTable()`, kept until it's uploaded.
+  std::vector<float> table_;
+
+  // The texture holding the table.
+  TextureHandle texture_;
+
+  // The target `texture_` was created for, either `GL_TEXTURE_2D` or
+  // `GL_TEXTURE_3D`.
+  GLenum texture_target_;
+
+  GLFC_DISALLOW_COPY_AND_ASSIGN(LutFilter);
+};
+
+}  // namespace glfc
+
+#endif  // GLFC_LUT_FILTER_H_
@@ -0,0 +1,65 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/memory_usage.h"
+
+#include <atomic>
+#include <cstddef>
+
+namespace {
+
+// The tracked bytes. Objects may live on different threads when each thread
+// owns its own context so the counters are atomic.
+std::atomic<std::ptrdiff_t> buffer_bytes(0);
+std::atomic<std::ptrdiff_t> framebuffer_bytes(0);
+std::atomic<std::ptrdiff_t> program_bytes(0);
+std::atomic<std::ptrdiff_t> texture_bytes(0);
+
+}  // namespace
+
+namespace glfc {
+
+MemoryUsage GetMemoryUsage() {
+  MemoryUsage usage;
+  usage.buffer_bytes = buffer_bytes.load(std::memory_order_relaxed);
+  usage.framebuffer_bytes = framebuffer_bytes.load(std::memory_order_relaxed);
+  usage.program_bytes = program_bytes.load(std::memory_order_relaxed);
+  usage.texture_bytes = texture_bytes.load(std::memory_order_relaxed);
+  return usage;
+}
+
+namespace internal {
+
+void TrackBufferMemory(const std::ptrdiff_t bytes) {
+  buffer_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void TrackFramebufferMemory(const std::ptrdiff_t bytes) {
+  framebuffer_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void TrackProgramMemory(const std::ptrdiff_t bytes) {
+  program_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void TrackTextureMemory(const std::ptrdiff_t bytes) {
+  texture_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+}  // namespace internal
+
+}  // namespace glfc
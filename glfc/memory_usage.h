@@ -0,0 +1,76 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_MEMORY_USAGE_H_
+#define GLFC_MEMORY_USAGE_H_
+
+#include <cstddef>
+
+namespace glfc {
+
+// The estimated GPU memory held by all live glfc objects. The numbers are
+// derived from the dimensions and formats of the allocated objects so they
+// don't include driver overhead such as alignment padding.
+struct MemoryUsage {
+  // The bytes held by pixel buffer objects used for asynchronous transfers.
+  size_t buffer_bytes;
+
+  // The bytes held by the attachments of initialized `Framebuffer` objects.
+  size_t framebuffer_bytes;
+
+  // The bytes held by initialized `Program` objects, including their vertex
+  // buffers. The size of a compiled program isn't queryable in OpenGL ES 2.0
+  // so the length of the shader sources is used as an approximation.
+  size_t program_bytes;
+
+  // The bytes held by standalone textures, such as the ones streamed by
+  // `TextureUploader`.
+  size_t texture_bytes;
+
+  // Returns the sum of all the above.
+  size_t total_bytes() const {
+    return buffer_bytes + framebuffer_bytes + program_bytes + texture_bytes;
+  }
+};
+
+// Returns the estimated GPU memory held by all live glfc framebuffers,
+// programs, pixel buffers and textures. This function is thread-safe.
+MemoryUsage GetMemoryUsage();
+
+namespace internal {
+
+// Adds `bytes` to the tracked pixel buffer memory. Pass a negative value when
+// releasing memory.
+void TrackBufferMemory(const std::ptrdiff_t bytes);
+
+// Adds `bytes` to the tracked framebuffer memory. Pass a negative value when
+// releasing memory.
+void TrackFramebufferMemory(const std::ptrdiff_t bytes);
+
+// Adds `bytes` to the tracked program memory. Pass a negative value when
+// releasing memory.
+void TrackProgramMemory(const std::ptrdiff_t bytes);
+
+// Adds `bytes` to the tracked texture memory. Pass a negative value when
+// releasing memory.
+void TrackTextureMemory(const std::ptrdiff_t bytes);
+
+}  // namespace internal
+
+}  // namespace glfc
+
+#endif  // GLFC_MEMORY_USAGE_H_
@@ -0,0 +1,95 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_MPSC_QUEUE_H_
+#define GLFC_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <utility>
+
+#include "glfc/base.h"
+
+namespace glfc {
+
+// A lock-free unbounded queue for multiple producers and a single consumer,
+// based on Dmitry Vyukov's node-based MPSC queue. `Push()` can be
+// called from any thread and never blocks. `Pop()` and `IsEmpty()` must only
+// be called from the consumer thread.
+//
+// A push that is still in progress may not be visible to the consumer yet,
+// so `Pop()` can transiently return `false` while a producer is pushing.
+// Callers that put the consumer to sleep must re-check after waking.
+template <typename T>
+class MpscQueue {
+ public:
+  MpscQueue() : head_(new Node), tail_(head_.load()) {}
+
+  ~MpscQueue() {
+    T value;
+    while (Pop(&value)) {}
+    delete tail_;
+  }
+
+  // Appends `value` to the queue.
+  void Push(T value) {
+    Node* node = new Node(std::move(value));
+    Node* previous = head_.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+  }
+
+  // Removes the oldest value and moves it to `value`. Returns `false` if the
+  // queue is empty.
+  bool Pop(T* value) {
+    Node* tail = tail_;
+    Node* next = tail->next.load(std::memory_order_acquire);
+    if (next == nullptr)
+      return false;
+
+    // `next` becomes the new stub node, its value has been moved out.
+    *value = std::move(next->value);
+    tail_ = next;
+    delete tail;
+    return true;
+  }
+
+  // Returns `true` if there's no value to pop.
+  bool IsEmpty() const {
+    return tail_->next.load(std::memory_order_acquire) == nullptr;
+  }
+
+ private:
+  struct Node {
+    Node() : next(nullptr) {}
+    explicit Node(T value) : next(nullptr), value(std::move(value)) {}
+
+    std::atomic<Node*> next;
+    T value;
+  };
+
+  // The most recently pushed node, which is shared by all producers.
+  std::atomic<Node*> head_;
+
+  // The stub node preceding the oldest value, which is only accessed by the
+  // consumer.
+  Node* tail_;
+
+  GLFC_DISALLOW_COPY_AND_ASSIGN(MpscQueue);
+};
+
+}  // namespace glfc
+
+#endif  // GLFC_MPSC_QUEUE_H_
@@ -0,0 +1,645 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/null_gl.h"
+
+#ifdef GLFC_NULL_GL
+
+// The OpenGL header is included directly instead of `opengl_hook.h` so the
+// tracing macros don't rename the definitions below.
+#include <GLES3/gl3.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The maximum texture size reported to glfc.
+const GLint kMaxTextureSize = 4096;
+
+// The number of varying vectors reported to glfc, which is the minimum
+// guaranteed by OpenGL ES 3.
+const GLint kMaxVaryingVectors = 15;
+
+// The version reported to glfc.
+const char* kVersion = "OpenGL ES 3.0 glfc null";
+
+// The emulated OpenGL state.
+struct State {
+  State() : active_texture(GL_TEXTURE0), blend_destination_alpha(GL_ZERO),
+            blend_destination_rgb(GL_ZERO), blend_is_enabled(false),
+            blend_source_alpha(GL_ONE), blend_source_rgb(GL_ONE),
+            framebuffer(0), next_name(1), program(0), renderbuffer(0) {
+    std::memset(viewport, 0, sizeof(viewport));
+  }
+
+  // The active texture unit.
+  GLenum active_texture;
+
+  // The blending factors.
+  GLenum blend_destination_alpha;
+  GLenum blend_destination_rgb;
+
+  // Indicates whether `GL_BLEND` is enabled.
+  bool blend_is_enabled;
+
+  // The blending factors.
+  GLenum blend_source_alpha;
+  GLenum blend_source_rgb;
+
+  // The buffer bound to each target.
+  std::map<GLenum, GLuint> buffer_bindings;
+
+  // The storage of each buffer allocated by `glBufferData()`.
+  std::map<GLuint, std::vector<unsigned char>> buffer_storage;
+
+  // The bound framebuffer.
+  GLuint framebuffer;
+
+  // The name returned by the next `glGen*()` or `glCreate*()` call.
+  GLuint next_name;
+
+  // The program in use.
+  GLuint program;
+
+  // The bound renderbuffer.
+  GLuint renderbuffer;
+
+  // The viewport.
+  GLint viewport[4];
+};
+
+State& GetState() {
+  static State state;
+  return state;
+}
+
+// Returns the registry of call counters keyed by function name.
+std::map<std::string, std::atomic<uint64_t>*>& GetCounters() {
+  static std::map<std::string, std::atomic<uint64_t>*> counters;
+  return counters;
+}
+
+// Guards the map returned by `GetCounters()`. The counters themselves are
+// atomic.
+std::mutex& GetCountersMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+// Returns the counter of the function named `name`, creating it if needed.
+std::atomic<uint64_t>* GetCounter(const char* name) {
+  std::lock_guard<std::mutex> lock(GetCountersMutex());
+  std::atomic<uint64_t>*& counter = GetCounters()[name];
+  if (counter == nullptr)
+    counter = new std::atomic<uint64_t>(0);
+  return counter;
+}
+
+// Generates `count` object names.
+void GenerateNames(const GLsizei count, GLuint* names) {
+  for (GLsizei index = 0; index < count; ++index)
+    names[index] = GetState().next_name++;
+}
+
+}  // namespace
+
+// Records a call of the enclosing function. The counter is looked up once
+// per function.
+#define GLFC_RECORD_CALL() \
+  static std::atomic<uint64_t>* const kCounter = GetCounter(__func__); \
+  kCounter->fetch_add(1, std::memory_order_relaxed)
+
+namespace glfc {
+
+uint64_t GetNullGlCallCount(const std::string& name) {
+  std::lock_guard<std::mutex> lock(GetCountersMutex());
+  auto iterator = GetCounters().find(name);
+  return iterator == GetCounters().end() ? 0 : iterator->second->load();
+}
+
+std::map<std::string, uint64_t> GetNullGlCallCounts() {
+  std::lock_guard<std::mutex> lock(GetCountersMutex());
+  std::map<std::string, uint64_t> counts;
+  for (const auto& counter : GetCounters()) {
+    const uint64_t kCount = counter.second->load();
+    if (kCount > 0)
+      counts[counter.first] = kCount;
+  }
+  return counts;
+}
+
+void ResetNullGlCallCounts() {
+  std::lock_guard<std::mutex> lock(GetCountersMutex());
+  for (const auto& counter : GetCounters())
+    counter.second->store(0);
+}
+
+}  // namespace glfc
+
+extern "C" {
+
+void glActiveTexture(GLenum texture) {
+  GLFC_RECORD_CALL();
+  GetState().active_texture = texture;
+}
+
+void glAttachShader(GLuint program, GLuint shader) {
+  GLFC_RECORD_CALL();
+}
+
+void glBeginQuery(GLenum target, GLuint id) {
+  GLFC_RECORD_CALL();
+}
+
+void glBindBuffer(GLenum target, GLuint buffer) {
+  GLFC_RECORD_CALL();
+  GetState().buffer_bindings[target] = buffer;
+}
+
+void glBindFramebuffer(GLenum target, GLuint framebuffer) {
+  GLFC_RECORD_CALL();
+  GetState().framebuffer = framebuffer;
+}
+
+void glBindRenderbuffer(GLenum target, GLuint renderbuffer) {
+  GLFC_RECORD_CALL();
+  GetState().renderbuffer = renderbuffer;
+}
+
+void glBindTexture(GLenum target, GLuint texture) {
+  GLFC_RECORD_CALL();
+}
+
+void glBindVertexArray(GLuint array) {
+  GLFC_RECORD_CALL();
+}
+
+void glBlendFunc(GLenum sfactor, GLenum dfactor) {
+  GLFC_RECORD_CALL();
+  State& state = GetState();
+  state.blend_source_rgb = state.blend_source_alpha = sfactor;
+  state.blend_destination_rgb = state.blend_destination_alpha = dfactor;
+}
+
+void glBlendFuncSeparate(GLenum sfactorRGB, GLenum dfactorRGB,
+                         GLenum sfactorAlpha, GLenum dfactorAlpha) {
+  GLFC_RECORD_CALL();
+  State& state = GetState();
+  state.blend_source_rgb = sfactorRGB;
+  state.blend_destination_rgb = dfactorRGB;
+  state.blend_source_alpha = sfactorAlpha;
+  state.blend_destination_alpha = dfactorAlpha;
+}
+
+void glBufferData(GLenum target, GLsizeiptr size, const void* data,
+                  GLenum usage) {
+  GLFC_RECORD_CALL();
+  State& state = GetState();
+  std::vector<unsigned char>& storage = \
+      state.buffer_storage[state.buffer_bindings[target]];
+  storage.resize(size);
+  if (data != nullptr)
+    std::memcpy(storage.data(), data, size);
+}
+
+void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size,
+                     const void* data) {
+  GLFC_RECORD_CALL();
+  State& state = GetState();
+  std::vector<unsigned char>& storage = \
+      state.buffer_storage[state.buffer_bindings[target]];
+  if (offset + size <= static_cast<GLsizeiptr>(storage.size()))
+    std::memcpy(storage.data() + offset, data, size);
+}
+
+GLenum glCheckFramebufferStatus(GLenum target) {
+  GLFC_RECORD_CALL();
+  return GL_FRAMEBUFFER_COMPLETE;
+}
+
+void glClear(GLbitfield mask) {
+  GLFC_RECORD_CALL();
+}
+
+void glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+  GLFC_RECORD_CALL();
+}
+
+void glClearStencil(GLint s) {
+  GLFC_RECORD_CALL();
+}
+
+GLenum glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout) {
+  GLFC_RECORD_CALL();
+  return GL_ALREADY_SIGNALED;
+}
+
+void glColorMask(GLboolean red, GLboolean green, GLboolean blue,
+                 GLboolean alpha) {
+  GLFC_RECORD_CALL();
+}
+
+void glCompileShader(GLuint shader) {
+  GLFC_RECORD_CALL();
+}
+
+GLuint glCreateProgram(void) {
+  GLFC_RECORD_CALL();
+  return GetState().next_name++;
+}
+
+GLuint glCreateShader(GLenum type) {
+  GLFC_RECORD_CALL();
+  return GetState().next_name++;
+}
+
+void glDeleteBuffers(GLsizei n, const GLuint* buffers) {
+  GLFC_RECORD_CALL();
+  for (GLsizei index = 0; index < n; ++index)
+    GetState().buffer_storage.erase(buffers[index]);
+}
+
+void glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+  GLFC_RECORD_CALL();
+}
+
+void glDeleteProgram(GLuint program) {
+  GLFC_RECORD_CALL();
+}
+
+void glDeleteQueries(GLsizei n, const GLuint* ids) {
+  GLFC_RECORD_CALL();
+}
+
+void glDeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers) {
+  GLFC_RECORD_CALL();
+}
+
+void glDeleteShader(GLuint shader) {
+  GLFC_RECORD_CALL();
+}
+
+void glDeleteSync(GLsync sync) {
+  GLFC_RECORD_CALL();
+}
+
+void glDeleteTextures(GLsizei n, const GLuint* textures) {
+  GLFC_RECORD_CALL();
+}
+
+void glDeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+  GLFC_RECORD_CALL();
+}
+
+void glDisable(GLenum cap) {
+  GLFC_RECORD_CALL();
+  if (cap == GL_BLEND)
+    GetState().blend_is_enabled = false;
+}
+
+void glDisableVertexAttribArray(GLuint index) {
+  GLFC_RECORD_CALL();
+}
+
+void glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+  GLFC_RECORD_CALL();
+}
+
+void glDrawElements(GLenum mode, GLsizei count, GLenum type,
+                    const void* indices) {
+  GLFC_RECORD_CALL();
+}
+
+void glEnable(GLenum cap) {
+  GLFC_RECORD_CALL();
+  if (cap == GL_BLEND)
+    GetState().blend_is_enabled = true;
+}
+
+void glEnableVertexAttribArray(GLuint index) {
+  GLFC_RECORD_CALL();
+}
+
+void glEndQuery(GLenum target) {
+  GLFC_RECORD_CALL();
+}
+
+GLsync glFenceSync(GLenum condition, GLbitfield flags) {
+  GLFC_RECORD_CALL();
+  return reinterpret_cast<GLsync>(static_cast<uintptr_t>(
+      GetState().next_name++));
+}
+
+void glFinish(void) {
+  GLFC_RECORD_CALL();
+}
+
+void glFlush(void) {
+  GLFC_RECORD_CALL();
+}
+
+void glFramebufferRenderbuffer(GLenum target, GLenum attachment,
+                               GLenum renderbuffertarget,
+                               GLuint renderbuffer) {
+  GLFC_RECORD_CALL();
+}
+
+void glFramebufferTexture2D(GLenum target, GLenum attachment,
+                            GLenum textarget, GLuint texture, GLint level) {
+  GLFC_RECORD_CALL();
+}
+
+void glGenBuffers(GLsizei n, GLuint* buffers) {
+  GLFC_RECORD_CALL();
+  GenerateNames(n, buffers);
+}
+
+void glGenFramebuffers(GLsizei n, GLuint* framebuffers) {
+  GLFC_RECORD_CALL();
+  GenerateNames(n, framebuffers);
+}
+
+void glGenQueries(GLsizei n, GLuint* ids) {
+  GLFC_RECORD_CALL();
+  GenerateNames(n, ids);
+}
+
+void glGenRenderbuffers(GLsizei n, GLuint* renderbuffers) {
+  GLFC_RECORD_CALL();
+  GenerateNames(n, renderbuffers);
+}
+
+void glGenTextures(GLsizei n, GLuint* textures) {
+  GLFC_RECORD_CALL();
+  GenerateNames(n, textures);
+}
+
+void glGenVertexArrays(GLsizei n, GLuint* arrays) {
+  GLFC_RECORD_CALL();
+  GenerateNames(n, arrays);
+}
+
+GLint glGetAttribLocation(GLuint program, const GLchar* name) {
+  GLFC_RECORD_CALL();
+  return std::strcmp(name, "position") == 0 ? 0 : 1;
+}
+
+GLenum glGetError(void) {
+  GLFC_RECORD_CALL();
+  return GL_NO_ERROR;
+}
+
+void glGetIntegerv(GLenum pname, GLint* data) {
+  GLFC_RECORD_CALL();
+  const State& kState = GetState();
+  switch (pname) {
+    case GL_ACTIVE_TEXTURE:
+      *data = kState.active_texture;
+      break;
+    case GL_ARRAY_BUFFER_BINDING:
+    case GL_ELEMENT_ARRAY_BUFFER_BINDING:
+    case GL_PIXEL_PACK_BUFFER_BINDING:
+    case GL_PIXEL_UNPACK_BUFFER_BINDING: {
+      const GLenum kTarget = \
+          pname == GL_ARRAY_BUFFER_BINDING ? GL_ARRAY_BUFFER : \
+          pname == GL_ELEMENT_ARRAY_BUFFER_BINDING ? \
+              GL_ELEMENT_ARRAY_BUFFER : \
+          pname == GL_PIXEL_PACK_BUFFER_BINDING ? GL_PIXEL_PACK_BUFFER : \
+          GL_PIXEL_UNPACK_BUFFER;
+      auto iterator = kState.buffer_bindings.find(kTarget);
+      *data = iterator == kState.buffer_bindings.end() ? 0 : iterator->second;
+      break;
+    }
+    case GL_BLEND_DST_ALPHA:
+      *data = kState.blend_destination_alpha;
+      break;
+    case GL_BLEND_DST_RGB:
+      *data = kState.blend_destination_rgb;
+      break;
+    case GL_BLEND_SRC_ALPHA:
+      *data = kState.blend_source_alpha;
+      break;
+    case GL_BLEND_SRC_RGB:
+      *data = kState.blend_source_rgb;
+      break;
+    case GL_CURRENT_PROGRAM:
+      *data = kState.program;
+      break;
+    case GL_FRAMEBUFFER_BINDING:
+      *data = kState.framebuffer;
+      break;
+    case GL_MAX_TEXTURE_SIZE:
+      *data = kMaxTextureSize;
+      break;
+    case GL_MAX_VARYING_VECTORS:
+      *data = kMaxVaryingVectors;
+      break;
+    case GL_RENDERBUFFER_BINDING:
+      *data = kState.renderbuffer;
+      break;
+    case GL_VIEWPORT:
+      std::memcpy(data, kState.viewport, sizeof(kState.viewport));
+      break;
+    default:
+      *data = 0;
+  }
+}
+
+void glGetProgramiv(GLuint program, GLenum pname, GLint* params) {
+  GLFC_RECORD_CALL();
+  *params = pname == GL_LINK_STATUS ? GL_TRUE : 0;
+}
+
+void glGetQueryObjectuiv(GLuint id, GLenum pname, GLuint* params) {
+  GLFC_RECORD_CALL();
+  // Results are always available and take no time.
+  *params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+void glGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length,
+                        GLchar* infoLog) {
+  GLFC_RECORD_CALL();
+  if (length != nullptr)
+    *length = 0;
+  if (bufSize > 0)
+    infoLog[0] = '\0';
+}
+
+void glGetShaderiv(GLuint shader, GLenum pname, GLint* params) {
+  GLFC_RECORD_CALL();
+  *params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+}
+
+const GLubyte* glGetString(GLenum name) {
+  GLFC_RECORD_CALL();
+  return name == GL_VERSION ? reinterpret_cast<const GLubyte*>(kVersion) : \
+                              nullptr;
+}
+
+const GLubyte* glGetStringi(GLenum name, GLuint index) {
+  GLFC_RECORD_CALL();
+  return nullptr;
+}
+
+GLint glGetUniformLocation(GLuint program, const GLchar* name) {
+  GLFC_RECORD_CALL();
+  return 0;
+}
+
+void glInvalidateFramebuffer(GLenum target, GLsizei numAttachments,
+                             const GLenum* attachments) {
+  GLFC_RECORD_CALL();
+}
+
+GLboolean glIsEnabled(GLenum cap) {
+  GLFC_RECORD_CALL();
+  return cap == GL_BLEND && GetState().blend_is_enabled;
+}
+
+void glLinkProgram(GLuint program) {
+  GLFC_RECORD_CALL();
+}
+
+void* glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length,
+                       GLbitfield access) {
+  GLFC_RECORD_CALL();
+  State& state = GetState();
+  std::vector<unsigned char>& storage = \
+      state.buffer_storage[state.buffer_bindings[target]];
+  if (offset + length > static_cast<GLsizeiptr>(storage.size()))
+    return nullptr;
+  return storage.data() + offset;
+}
+
+void glPixelStorei(GLenum pname, GLint param) {
+  GLFC_RECORD_CALL();
+}
+
+void glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height,
+                  GLenum format, GLenum type, void* pixels) {
+  GLFC_RECORD_CALL();
+}
+
+void glRenderbufferStorage(GLenum target, GLenum internalformat,
+                           GLsizei width, GLsizei height) {
+  GLFC_RECORD_CALL();
+}
+
+void glShaderSource(GLuint shader, GLsizei count, const GLchar* const* string,
+                    const GLint* length) {
+  GLFC_RECORD_CALL();
+}
+
+void glStencilFunc(GLenum func, GLint ref, GLuint mask) {
+  GLFC_RECORD_CALL();
+}
+
+void glStencilOp(GLenum fail, GLenum zfail, GLenum zpass) {
+  GLFC_RECORD_CALL();
+}
+
+void glTexImage2D(GLenum target, GLint level, GLint internalformat,
+                  GLsizei width, GLsizei height, GLint border, GLenum format,
+                  GLenum type, const void* pixels) {
+  GLFC_RECORD_CALL();
+}
+
+void glTexImage3D(GLenum target, GLint level, GLint internalformat,
+                  GLsizei width, GLsizei height, GLsizei depth, GLint border,
+                  GLenum format, GLenum type, const void* pixels) {
+  GLFC_RECORD_CALL();
+}
+
+void glTexParameteri(GLenum target, GLenum pname, GLint param) {
+  GLFC_RECORD_CALL();
+}
+
+void glTexStorage2D(GLenum target, GLsizei levels, GLenum internalformat,
+                    GLsizei width, GLsizei height) {
+  GLFC_RECORD_CALL();
+}
+
+void glTexSubImage2D(GLenum target, GLint level, GLint xoffset,
+                     GLint yoffset, GLsizei width, GLsizei height,
+                     GLenum format, GLenum type, const void* pixels) {
+  GLFC_RECORD_CALL();
+}
+
+void glUniform1f(GLint location, GLfloat v0) {
+  GLFC_RECORD_CALL();
+}
+
+void glUniform1i(GLint location, GLint v0) {
+  GLFC_RECORD_CALL();
+}
+
+void glUniform2f(GLint location, GLfloat v0, GLfloat v1) {
+  GLFC_RECORD_CALL();
+}
+
+void glUniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+  GLFC_RECORD_CALL();
+}
+
+void glUniform4fv(GLint location, GLsizei count, const GLfloat* value) {
+  GLFC_RECORD_CALL();
+}
+
+void glUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose,
+                        const GLfloat* value) {
+  GLFC_RECORD_CALL();
+}
+
+void glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose,
+                        const GLfloat* value) {
+  GLFC_RECORD_CALL();
+}
+
+GLboolean glUnmapBuffer(GLenum target) {
+  GLFC_RECORD_CALL();
+  return GL_TRUE;
+}
+
+void glUseProgram(GLuint program) {
+  GLFC_RECORD_CALL();
+  GetState().program = program;
+}
+
+void glVertexAttribPointer(GLuint index, GLint size, GLenum type,
+                           GLboolean normalized, GLsizei stride,
+                           const void* pointer) {
+  GLFC_RECORD_CALL();
+}
+
+void glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+  GLFC_RECORD_CALL();
+  GLint* viewport = GetState().viewport;
+  viewport[0] = x;
+  viewport[1] = y;
+  viewport[2] = width;
+  viewport[3] = height;
+}
+
+}  // extern "C"
+
+#endif  // GLFC_NULL_GL
@@ -0,0 +1,56 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+//
+// The null OpenGL backend is selected by defining `GLFC_NULL_GL`, e.g. with
+// the CMake option of the same name. glfc is then built against the OpenGL
+// ES 3 headers but links to the implementation in `null_gl.cc`, which
+// renders nothing and only records the calls. This isolates the CPU cost of
+// glfc itself, such as shader generation, state queries and uniform lookups,
+// from the driver, and works without a GPU or a context.
+//
+// The backend emulates just enough state for glfc to run: object names,
+// bindings, the viewport, blending, buffer storage for mapping, and
+// successful compilation, linking and framebuffer completeness. Pixels are
+// never written. The state is global and not thread-safe, so the backend
+// should be driven from a single thread.
+
+#ifndef GLFC_NULL_GL_H_
+#define GLFC_NULL_GL_H_
+
+#ifdef GLFC_NULL_GL
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace glfc {
+
+// Returns the number of calls to the OpenGL function named `name`, such as
+// "glDrawElements", since the counts were last reset.
+uint64_t GetNullGlCallCount(const std::string& name);
+
+// Returns the non-zero call counts of all OpenGL functions keyed by name.
+std::map<std::string, uint64_t> GetNullGlCallCounts();
+
+// Resets the call counts of all OpenGL functions to zero.
+void ResetNullGlCallCounts();
+
+}  // namespace glfc
+
+#endif  // GLFC_NULL_GL
+
+#endif  // GLFC_NULL_GL_H_
@@ -18,16 +18,44 @@
 #ifndef GLFC_OPENGL_HOOK_H_
 #define GLFC_OPENGL_HOOK_H_
 
-#if defined GLFC_ANDROID
+// The null backend only needs the declarations, see `null_gl.h`.
+#if defined GLFC_NULL_GL
+#include <GLES3/gl3.h>
+// Android
+#elif defined GLFC_ANDROID
 #include <GLES2/gl2.h>
 // iOS
 #elif defined GLFC_IOS && defined GLFC_GLES2
 #include <OpenGLES/ES2/gl.h>
+#include <OpenGLES/ES2/glext.h>
 #elif defined GLFC_IOS && defined GLFC_GLES3
 #include <OpenGLES/ES3/gl.h>
 // Mac
 #elif defined GLFC_MAC && defined GLFC_GL2
 #include <OpenGL/gl.h>
+#elif defined GLFC_MAC && defined GLFC_GL3
+#include <OpenGL/gl3.h>
+// Linux
+#elif defined GLFC_LINUX && defined GLFC_GLES2
+#include <GLES2/gl2.h>
+#elif defined GLFC_LINUX && defined GLFC_GLES3
+#include <GLES3/gl3.h>
+#endif
+
+// Defined if the headers provide the API shared by OpenGL ES 3 and OpenGL 3.3
+// core, such as pixel buffer objects, fences, 3D textures and vertex array
+// objects. Whether the current context supports it is a runtime decision,
+// see `capabilities.h`.
+#if defined GLFC_GLES3 || defined GLFC_GL3
+#define GLFC_GL3_API
+#endif
+
+// Counts the OpenGL calls made by glfc itself when tracing is enabled. The
+// build only defines `GLFC_TRACE_GL_CALLS` for glfc's own sources, so client
+// code including glfc headers keeps calling the OpenGL functions unwrapped.
+// See `trace.h` for details.
+#if defined GLFC_ENABLE_TRACING && defined GLFC_TRACE_GL_CALLS
+#include "glfc/opengl_trace_hook.h"
 #endif
 
 #endif  // GLFC_OPENGL_HOOK_H_
@@ -0,0 +1,256 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+//
+// Wraps the OpenGL entry points used by glfc to count them for tracing. This
+// file is only included by `opengl_hook.h` after the OpenGL headers when
+// compiling glfc with `GLFC_ENABLE_TRACING` defined. Each macro counts the
+// call and then calls the real function, whose name isn't expanded again by
+// the preprocessor. Arguments used to compute transferred bytes are evaluated
+// twice, so they must not have side effects.
+
+#ifndef GLFC_OPENGL_TRACE_HOOK_H_
+#define GLFC_OPENGL_TRACE_HOOK_H_
+
+#include "glfc/trace.h"
+
+#define GLFC_TRACE_GL(type, call) \
+  (::glfc::internal::TraceGlCall(::glfc::type, 0, 0), call)
+
+// Draws.
+#define glClear(...) \
+  GLFC_TRACE_GL(kTraceCallTypeDraw, glClear(__VA_ARGS__))
+#define glDrawArrays(...) \
+  GLFC_TRACE_GL(kTraceCallTypeDraw, glDrawArrays(__VA_ARGS__))
+#define glDrawElements(...) \
+  GLFC_TRACE_GL(kTraceCallTypeDraw, glDrawElements(__VA_ARGS__))
+
+// Queries.
+#define glCheckFramebufferStatus(...) \
+  GLFC_TRACE_GL(kTraceCallTypeQuery, glCheckFramebufferStatus(__VA_ARGS__))
+#define glGetAttribLocation(...) \
+  GLFC_TRACE_GL(kTraceCallTypeQuery, glGetAttribLocation(__VA_ARGS__))
+#define glGetError(...) \
+  GLFC_TRACE_GL(kTraceCallTypeQuery, glGetError(__VA_ARGS__))
+#define glGetIntegerv(...) \
+  GLFC_TRACE_GL(kTraceCallTypeQuery, glGetIntegerv(__VA_ARGS__))
+#define glGetProgramiv(...) \
+  GLFC_TRACE_GL(kTraceCallTypeQuery, glGetProgramiv(__VA_ARGS__))
+#define glGetShaderInfoLog(...) \
+  GLFC_TRACE_GL(kTraceCallTypeQuery, glGetShaderInfoLog(__VA_ARGS__))
+#define glGetShaderiv(...) \
+  GLFC_TRACE_GL(kTraceCallTypeQuery, glGetShaderiv(__VA_ARGS__))
+#define glGetString(...) \
+  GLFC_TRACE_GL(kTraceCallTypeQuery, glGetString(__VA_ARGS__))
+#define glGetUniformLocation(...) \
+  GLFC_TRACE_GL(kTraceCallTypeQuery, glGetUniformLocation(__VA_ARGS__))
+#define glIsEnabled(...) \
+  GLFC_TRACE_GL(kTraceCallTypeQuery, glIsEnabled(__VA_ARGS__))
+
+// Readbacks.
+#define glReadPixels(x, y, width, height, format, type, pixels) \
+  (::glfc::internal::TraceGlCall( \
+       ::glfc::kTraceCallTypeReadback, 0, \
+       ::glfc::internal::GetPixelDataSize(width, height, 1, format, type)), \
+   glReadPixels(x, y, width, height, format, type, pixels))
+
+// Resources.
+#define glAttachShader(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glAttachShader(__VA_ARGS__))
+#define glCompileShader(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glCompileShader(__VA_ARGS__))
+#define glCreateProgram(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glCreateProgram(__VA_ARGS__))
+#define glCreateShader(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glCreateShader(__VA_ARGS__))
+#define glDeleteBuffers(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glDeleteBuffers(__VA_ARGS__))
+#define glDeleteFramebuffers(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glDeleteFramebuffers(__VA_ARGS__))
+#define glDeleteProgram(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glDeleteProgram(__VA_ARGS__))
+#define glDeleteRenderbuffers(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glDeleteRenderbuffers(__VA_ARGS__))
+#define glDeleteShader(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glDeleteShader(__VA_ARGS__))
+#define glDeleteTextures(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glDeleteTextures(__VA_ARGS__))
+#define glGenBuffers(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glGenBuffers(__VA_ARGS__))
+#define glGenFramebuffers(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glGenFramebuffers(__VA_ARGS__))
+#define glGenRenderbuffers(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glGenRenderbuffers(__VA_ARGS__))
+#define glGenTextures(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glGenTextures(__VA_ARGS__))
+#define glLinkProgram(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glLinkProgram(__VA_ARGS__))
+#define glRenderbufferStorage(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glRenderbufferStorage(__VA_ARGS__))
+#define glShaderSource(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glShaderSource(__VA_ARGS__))
+
+// State changes.
+#define glActiveTexture(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glActiveTexture(__VA_ARGS__))
+#define glBindBuffer(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glBindBuffer(__VA_ARGS__))
+#define glBindFramebuffer(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glBindFramebuffer(__VA_ARGS__))
+#define glBindRenderbuffer(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glBindRenderbuffer(__VA_ARGS__))
+#define glBindTexture(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glBindTexture(__VA_ARGS__))
+#define glBlendFunc(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glBlendFunc(__VA_ARGS__))
+#define glBlendFuncSeparate(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glBlendFuncSeparate(__VA_ARGS__))
+#define glClearColor(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glClearColor(__VA_ARGS__))
+#define glClearStencil(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glClearStencil(__VA_ARGS__))
+#define glColorMask(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glColorMask(__VA_ARGS__))
+#define glDisable(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glDisable(__VA_ARGS__))
+#define glDisableVertexAttribArray(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glDisableVertexAttribArray(__VA_ARGS__))
+#define glEnable(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glEnable(__VA_ARGS__))
+#define glEnableVertexAttribArray(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glEnableVertexAttribArray(__VA_ARGS__))
+#define glFramebufferRenderbuffer(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glFramebufferRenderbuffer(__VA_ARGS__))
+#define glFramebufferTexture2D(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glFramebufferTexture2D(__VA_ARGS__))
+#define glPixelStorei(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glPixelStorei(__VA_ARGS__))
+#define glStencilFunc(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glStencilFunc(__VA_ARGS__))
+#define glStencilOp(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glStencilOp(__VA_ARGS__))
+#define glTexParameteri(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glTexParameteri(__VA_ARGS__))
+#define glUseProgram(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glUseProgram(__VA_ARGS__))
+#define glVertexAttribPointer(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glVertexAttribPointer(__VA_ARGS__))
+#define glViewport(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glViewport(__VA_ARGS__))
+
+// Synchronization.
+#define glFinish(...) \
+  GLFC_TRACE_GL(kTraceCallTypeSync, glFinish(__VA_ARGS__))
+#define glFlush(...) \
+  GLFC_TRACE_GL(kTraceCallTypeSync, glFlush(__VA_ARGS__))
+
+// Uniforms.
+#define glUniform1f(...) \
+  GLFC_TRACE_GL(kTraceCallTypeUniform, glUniform1f(__VA_ARGS__))
+#define glUniform1i(...) \
+  GLFC_TRACE_GL(kTraceCallTypeUniform, glUniform1i(__VA_ARGS__))
+#define glUniform2f(...) \
+  GLFC_TRACE_GL(kTraceCallTypeUniform, glUniform2f(__VA_ARGS__))
+#define glUniform3fv(...) \
+  GLFC_TRACE_GL(kTraceCallTypeUniform, glUniform3fv(__VA_ARGS__))
+#define glUniform4fv(...) \
+  GLFC_TRACE_GL(kTraceCallTypeUniform, glUniform4fv(__VA_ARGS__))
+#define glUniformMatrix3fv(...) \
+  GLFC_TRACE_GL(kTraceCallTypeUniform, glUniformMatrix3fv(__VA_ARGS__))
+#define glUniformMatrix4fv(...) \
+  GLFC_TRACE_GL(kTraceCallTypeUniform, glUniformMatrix4fv(__VA_ARGS__))
+
+// Uploads. Texture pixels are only counted when passed from client memory,
+// a null pointer only allocates storage and an offset into a bound pixel
+// buffer object was counted when the buffer was mapped.
+#define glBufferData(target, size, data, usage) \
+  (::glfc::internal::TraceGlCall(::glfc::kTraceCallTypeUpload, \
+                                 (data) != 0 ? (size) : 0, 0), \
+   glBufferData(target, size, data, usage))
+#define glBufferSubData(target, offset, size, data) \
+  (::glfc::internal::TraceGlCall(::glfc::kTraceCallTypeUpload, size, 0), \
+   glBufferSubData(target, offset, size, data))
+#define glTexImage2D(target, level, internal_format, width, height, border, \
+                     format, type, pixels) \
+  (::glfc::internal::TraceGlCall( \
+       ::glfc::kTraceCallTypeUpload, \
+       (pixels) != 0 ? ::glfc::internal::GetPixelDataSize( \
+                           width, height, 1, format, type) : 0, 0), \
+   glTexImage2D(target, level, internal_format, width, height, border, \
+                format, type, pixels))
+#define glTexSubImage2D(target, level, x, y, width, height, format, type, \
+                        pixels) \
+  (::glfc::internal::TraceGlCall( \
+       ::glfc::kTraceCallTypeUpload, \
+       (pixels) != 0 ? ::glfc::internal::GetPixelDataSize( \
+                           width, height, 1, format, type) : 0, 0), \
+   glTexSubImage2D(target, level, x, y, width, height, format, type, pixels))
+
+#ifdef GLFC_GL3_API
+#define glBeginQuery(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glBeginQuery(__VA_ARGS__))
+#define glBindVertexArray(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glBindVertexArray(__VA_ARGS__))
+#define glClientWaitSync(...) \
+  GLFC_TRACE_GL(kTraceCallTypeSync, glClientWaitSync(__VA_ARGS__))
+#define glDeleteQueries(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glDeleteQueries(__VA_ARGS__))
+#define glDeleteSync(...) \
+  GLFC_TRACE_GL(kTraceCallTypeSync, glDeleteSync(__VA_ARGS__))
+#define glDeleteVertexArrays(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glDeleteVertexArrays(__VA_ARGS__))
+#define glEndQuery(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glEndQuery(__VA_ARGS__))
+#define glFenceSync(...) \
+  GLFC_TRACE_GL(kTraceCallTypeSync, glFenceSync(__VA_ARGS__))
+#define glGenQueries(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glGenQueries(__VA_ARGS__))
+#define glGenVertexArrays(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glGenVertexArrays(__VA_ARGS__))
+#define glGetQueryObjectuiv(...) \
+  GLFC_TRACE_GL(kTraceCallTypeQuery, glGetQueryObjectuiv(__VA_ARGS__))
+#define glGetStringi(...) \
+  GLFC_TRACE_GL(kTraceCallTypeQuery, glGetStringi(__VA_ARGS__))
+#define glMapBufferRange(target, offset, length, access) \
+  (::glfc::internal::TraceGlCall( \
+       ::glfc::kTraceCallTypeUpload, \
+       ((access) & GL_MAP_WRITE_BIT) != 0 ? (length) : 0, 0), \
+   glMapBufferRange(target, offset, length, access))
+#define glTexImage3D(target, level, internal_format, width, height, depth, \
+                     border, format, type, pixels) \
+  (::glfc::internal::TraceGlCall( \
+       ::glfc::kTraceCallTypeUpload, \
+       (pixels) != 0 ? ::glfc::internal::GetPixelDataSize( \
+                           width, height, depth, format, type) : 0, 0), \
+   glTexImage3D(target, level, internal_format, width, height, depth, \
+                border, format, type, pixels))
+#define glTexStorage2D(...) \
+  GLFC_TRACE_GL(kTraceCallTypeResource, glTexStorage2D(__VA_ARGS__))
+#define glUnmapBuffer(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glUnmapBuffer(__VA_ARGS__))
+#endif  // GLFC_GL3_API
+
+#ifdef GLFC_GLES3
+#define glInvalidateFramebuffer(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glInvalidateFramebuffer(__VA_ARGS__))
+#endif
+
+#if defined GLFC_IOS && defined GLFC_GLES2
+#define glDiscardFramebufferEXT(...) \
+  GLFC_TRACE_GL(kTraceCallTypeState, glDiscardFramebufferEXT(__VA_ARGS__))
+#endif
+
+#endif  // GLFC_OPENGL_TRACE_HOOK_H_
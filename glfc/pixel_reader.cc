@@ -0,0 +1,267 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/pixel_reader.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/capabilities.h"
+#include "glfc/gl_handle.h"
+#include "glfc/memory_usage.h"
+#include "glfc/opengl_hook.h"
+
+namespace {
+
+// The number of bytes of a `GL_RGBA` and `GL_UNSIGNED_BYTE` pixel.
+const int kBytesPerPixel = 4;
+
+#ifdef GLFC_GL3_API
+// The timeout in nanoseconds of a single `glClientWaitSync()` call when
+// waiting for a read to complete.
+const uint64_t kWaitTimeout = 1000000000;
+#endif
+
+}  // namespace
+
+namespace glfc {
+
+PixelReader::PixelReader(const int width, const int height)
+    : first_pending_index_(0), height_(height), is_initialized_(false),
+      is_mapped_(false), number_of_buffers_(2), number_of_pending_reads_(0),
+      row_stride_(width * kBytesPerPixel), uses_pixel_buffers_(false),
+      width_(width) {
+}
+
+PixelReader::PixelReader(const int width, const int height,
+                         const int number_of_buffers, const size_t row_stride)
+    : first_pending_index_(0), height_(height), is_initialized_(false),
+      is_mapped_(false), number_of_buffers_(number_of_buffers),
+      number_of_pending_reads_(0),
+      row_stride_(row_stride > 0 ? row_stride : width * kBytesPerPixel),
+      uses_pixel_buffers_(false), width_(width) {
+}
+
+PixelReader::~PixelReader() {
+  if (is_initialized_)
+    Finalize();
+}
+
+bool PixelReader::Init() {
+  if (is_initialized_)
+    Finalize();
+
+  if (number_of_buffers_ <= 0 || width_ <= 0 || height_ <= 0 ||
+      row_stride_ % kBytesPerPixel != 0 ||
+      row_stride_ < static_cast<size_t>(width_) * kBytesPerPixel) {
+#ifdef DEBUG
+    GLFC_LOG("!! Invalid pixel reader configuration.\n");
+#endif
+    return false;
+  }
+
+#ifdef GLFC_GL3_API
+  const Capabilities& kCapabilities = GetCapabilities();
+  uses_pixel_buffers_ = kCapabilities.supports_fence_sync &&
+                        kCapabilities.supports_pixel_buffer_objects;
+  if (uses_pixel_buffers_) {
+    GLint original_buffer;
+    glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &original_buffer);
+    std::vector<GLuint> buffers(number_of_buffers_);
+    glGenBuffers(number_of_buffers_, buffers.data());
+    fences_.assign(number_of_buffers_, nullptr);
+    for (const GLuint buffer : buffers) {
+      buffers_.push_back(BufferHandle(buffer));
+      glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+      glBufferData(GL_PIXEL_PACK_BUFFER, buffer_size(), NULL,
+                   GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, original_buffer);
+    internal::TrackBufferMemory(
+        static_cast<std::ptrdiff_t>(buffer_size() * number_of_buffers_));
+  }
+#endif
+  if (!uses_pixel_buffers_)
+    client_buffer_.resize(buffer_size() * number_of_buffers_);
+  is_initialized_ = true;
+  return true;
+}
+
+bool PixelReader::Read() {
+  if (!is_initialized_ || is_mapped_ ||
+      number_of_pending_reads_ == number_of_buffers_) {
+    return false;
+  }
+
+  const int kIndex = (first_pending_index_ + number_of_pending_reads_) % \
+                     number_of_buffers_;
+  // The pack state is shared with the caller, restores it after reading.
+  GLint original_alignment;
+  glGetIntegerv(GL_PACK_ALIGNMENT, &original_alignment);
+  glPixelStorei(GL_PACK_ALIGNMENT, kBytesPerPixel);
+#ifdef GLFC_GL3_API
+  if (uses_pixel_buffers_) {
+    // Pads rows by specifying the row length in pixels, the copy then lands
+    // in the buffer with the final layout.
+    GLint original_buffer;
+    glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &original_buffer);
+    GLint original_row_length;
+    glGetIntegerv(GL_PACK_ROW_LENGTH, &original_row_length);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers_[kIndex].get());
+    glPixelStorei(GL_PACK_ROW_LENGTH, row_stride_ / kBytesPerPixel);
+    glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE,
+                 reinterpret_cast<GLvoid*>(0));
+    glPixelStorei(GL_PACK_ROW_LENGTH, original_row_length);
+    glPixelStorei(GL_PACK_ALIGNMENT, original_alignment);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, original_buffer);
+    fences_[kIndex] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ++number_of_pending_reads_;
+    return true;
+  }
+#endif
+  // `GL_PACK_ROW_LENGTH` is not available, reads tightly-packed rows and
+  // spreads them from the last row so no row is overwritten before moved.
+  unsigned char* pixels = client_buffer_.data() + buffer_size() * kIndex;
+  glReadPixels(0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+  glPixelStorei(GL_PACK_ALIGNMENT, original_alignment);
+  const size_t kPackedRowSize = static_cast<size_t>(width_) * kBytesPerPixel;
+  if (row_stride_ != kPackedRowSize) {
+    for (int row = height_ - 1; row > 0; --row) {
+      std::memmove(pixels + row_stride_ * row, pixels + kPackedRowSize * row,
+                   kPackedRowSize);
+    }
+  }
+  ++number_of_pending_reads_;
+  return true;
+}
+
+bool PixelReader::IsReady(const bool wait) {
+  if (number_of_pending_reads_ == 0)
+    return false;
+
+#ifdef GLFC_GL3_API
+  if (!uses_pixel_buffers_)
+    return true;
+
+  GLsync& fence = fences_[first_pending_index_];
+  if (fence == nullptr)
+    return true;
+
+  // The flush bit guarantees the fence is eventually signaled even if the
+  // commands haven't been submitted yet.
+  GLenum result;
+  do {
+    result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                              wait ? kWaitTimeout : 0);
+  } while (wait && result == GL_TIMEOUT_EXPIRED);
+  if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+    return false;
+
+  glDeleteSync(fence);
+  fence = nullptr;
+#endif
+  return true;
+}
+
+const void* PixelReader::Map(const bool wait) {
+  if (is_mapped_ || !IsReady(wait))
+    return nullptr;
+
+  const void* pixels = nullptr;
+#ifdef GLFC_GL3_API
+  if (uses_pixel_buffers_) {
+    GLint original_buffer;
+    glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &original_buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers_[first_pending_index_].get());
+    pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, buffer_size(),
+                              GL_MAP_READ_BIT);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, original_buffer);
+  }
+#endif
+  if (!uses_pixel_buffers_)
+    pixels = client_buffer_.data() + buffer_size() * first_pending_index_;
+  is_mapped_ = pixels != nullptr;
+  return pixels;
+}
+
+void PixelReader::Unmap() {
+  if (!is_mapped_)
+    return;
+
+#ifdef GLFC_GL3_API
+  if (uses_pixel_buffers_) {
+    GLint original_buffer;
+    glGetIntegerv(GL_PIXEL_PACK_BUFFER_BINDING, &original_buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers_[first_pending_index_].get());
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, original_buffer);
+  }
+#endif
+  is_mapped_ = false;
+  first_pending_index_ = (first_pending_index_ + 1) % number_of_buffers_;
+  --number_of_pending_reads_;
+}
+
+bool PixelReader::CopyPixels(void* pixels, const size_t row_stride,
+                             const bool wait) {
+  const unsigned char* source = \
+      reinterpret_cast<const unsigned char*>(Map(wait));
+  if (source == nullptr)
+    return false;
+
+  const size_t kPackedRowSize = static_cast<size_t>(width_) * kBytesPerPixel;
+  const size_t kRowStride = row_stride > 0 ? row_stride : kPackedRowSize;
+  unsigned char* destination = reinterpret_cast<unsigned char*>(pixels);
+  if (kRowStride == row_stride_) {
+    std::memcpy(destination, source, buffer_size());
+  } else {
+    for (int row = 0; row < height_; ++row) {
+      std::memcpy(destination + kRowStride * row, source + row_stride_ * row,
+                  kPackedRowSize);
+    }
+  }
+  Unmap();
+  return true;
+}
+
+void PixelReader::Finalize() {
+  Unmap();
+#ifdef GLFC_GL3_API
+  for (GLsync& fence : fences_) {
+    if (fence != nullptr) {
+      glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+  fences_.clear();
+  if (!buffers_.empty()) {
+    internal::TrackBufferMemory(
+        -static_cast<std::ptrdiff_t>(buffer_size() * number_of_buffers_));
+  }
+#endif
+  buffers_.clear();
+  client_buffer_.clear();
+  first_pending_index_ = 0;
+  number_of_pending_reads_ = 0;
+  is_initialized_ = false;
+  uses_pixel_buffers_ = false;
+}
+
+}  // namespace glfc
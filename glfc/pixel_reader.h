@@ -0,0 +1,141 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_PIXEL_READER_H_
+#define GLFC_PIXEL_READER_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/gl_handle.h"
+#include "glfc/opengl_hook.h"
+
+namespace glfc {
+
+// This class reads back the `GL_RGBA` pixels of the currently binded
+// framebuffer without stalling the pipeline. Each `Read()` copies the pixels
+// into the next pixel buffer object of a ring and inserts a fence, the result
+// can then be mapped or copied one or more frames later once the fence is
+// signaled. A ring of two buffers gives classic double-buffered readback.
+//
+// Pixel buffer objects and fences require OpenGL ES 3.0. On contexts without
+// them the pixels are read synchronously with `glReadPixels()` into client
+// memory so the same calling pattern still works.
+//
+// The rows are stored in OpenGL order, i.e. the bottom row comes first.
+class PixelReader {
+ public:
+  // Creates a double-buffered reader with tightly-packed rows.
+  PixelReader(const int width, const int height);
+
+  // Creates a reader using a ring of `number_of_buffers` buffers. Each row
+  // occupies `row_stride` bytes, which must be a multiple of 4 and at least
+  // `width * 4`. Passing 0 to `row_stride` means tightly-packed rows.
+  PixelReader(const int width, const int height, const int number_of_buffers,
+              const size_t row_stride);
+  ~PixelReader();
+
+  // Allocates the buffers. Returns `false` on failure.
+  bool Init();
+
+  // Starts reading the pixels in the bottom-left `width` x `height` region of
+  // the currently binded framebuffer. Returns `false` if every buffer holds
+  // a result that hasn't been consumed yet.
+  bool Read();
+
+  // Returns `true` if the oldest pending read has completed. If `wait` is
+  // `true`, blocks until the read completes. Returns `false` if there's no
+  // pending read.
+  bool IsReady(const bool wait);
+
+  // Maps the result of the oldest pending read and returns the pixels laid
+  // out with `row_stride()` bytes per row. Returns `nullptr` if the read
+  // hasn't completed and `wait` is `false`. The returned memory stays valid
+  // until `Unmap()` is called, which must happen before the next `Read()`.
+  const void* Map(const bool wait);
+
+  // Unmaps the memory returned by `Map()` and recycles its buffer.
+  void Unmap();
+
+  // Copies the result of the oldest pending read to `pixels`, with
+  // `row_stride` bytes per row, and recycles its buffer. Passing 0 to
+  // `row_stride` means tightly-packed rows. Returns `false` if the read
+  // hasn't completed and `wait` is `false`.
+  bool CopyPixels(void* pixels, const size_t row_stride, const bool wait);
+
+  // Accessors.
+  int height() const { return height_; }
+  int number_of_pending_reads() const { return number_of_pending_reads_; }
+  size_t row_stride() const { return row_stride_; }
+  int width() const { return width_; }
+
+ private:
+  // Releases all buffers and fences.
+  void Finalize();
+
+  // Returns the number of bytes of a single result.
+  size_t buffer_size() const { return row_stride_ * height_; }
+
+  // The pixel buffer objects.
+  std::vector<BufferHandle> buffers_;
+
+  // The client memory holding results when pixel buffer objects are not
+  // supported.
+  std::vector<unsigned char> client_buffer_;
+
+#ifdef GLFC_GL3_API
+  // The fence inserted after each read. A `nullptr` fence indicates the read
+  // is known to be complete.
+  std::vector<GLsync> fences_;
+#endif
+
+  // The index of the buffer holding the oldest pending read.
+  int first_pending_index_;
+
+  // The height of the region to read.
+  const int height_;
+
+  // Indicates if the reader has been initialized.
+  bool is_initialized_;
+
+  // Indicates whether the oldest pending read is currently mapped.
+  bool is_mapped_;
+
+  // The number of buffers in the ring.
+  const int number_of_buffers_;
+
+  // The number of reads whose results haven't been consumed.
+  int number_of_pending_reads_;
+
+  // The number of bytes per row.
+  const size_t row_stride_;
+
+  // Indicates whether the results are read into `buffers_` rather than
+  // `client_buffer_`. This is decided in `Init()` from the capabilities of
+  // the current context.
+  bool uses_pixel_buffers_;
+
+  // The width of the region to read.
+  const int width_;
+
+  GLFC_DISALLOW_COPY_AND_ASSIGN(PixelReader);
+};
+
+}  // namespace glfc
+
+#endif  // GLFC_PIXEL_READER_H_
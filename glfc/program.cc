@@ -17,11 +17,22 @@
 
 #include "glfc/program.h"
 
+#include <cctype>
+#include <chrono>
+#include <cstddef>
 #include <cstdlib>
 #include <cstdio>
+#include <map>
+#include <string>
+#include <utility>
 
 #include "glfc/base.h"
+#include "glfc/capabilities.h"
+#include "glfc/gl_handle.h"
+#include "glfc/memory_usage.h"
 #include "glfc/opengl_hook.h"
+#include "glfc/stats.h"
+#include "glfc/trace.h"
 
 namespace {
 
@@ -48,6 +59,90 @@ const Vertex kArrayBuffer[4] = {{{-1.0, 1.0}, {0.0, 1.0}},  // top-left
 const int kIndexBufferCount = 6;
 const int kIndexBuffer[kIndexBufferCount] = {0, 1, 2, 0, 2, 3};
 
+// The extensions of GLSL ES 1.00 that are part of the translated dialects.
+const char* kCoreExtensions[] = {"GL_EXT_shader_texture_lod",
+                                 "GL_OES_standard_derivatives"};
+
+// The name of the fragment shader output replacing `gl_FragColor`.
+const char* kFragmentColorName = "fragColor";
+
+// Counts a program compilation taking the lifetime of the object.
+class ScopedCompileTimer {
+ public:
+  ScopedCompileTimer() : start_time_(std::chrono::steady_clock::now()) {}
+
+  ~ScopedCompileTimer() {
+    const std::chrono::duration<double, std::milli> kElapsedTime = \
+        std::chrono::steady_clock::now() - start_time_;
+    glfc::internal::CountProgramCompile(kElapsedTime.count());
+  }
+
+ private:
+  // The time when the object was created.
+  const std::chrono::steady_clock::time_point start_time_;
+
+  GLFC_DISALLOW_COPY_AND_ASSIGN(ScopedCompileTimer);
+};
+
+// Returns `true` if `line` enables one of `kCoreExtensions`.
+bool IsCoreExtensionDirective(const std::string& line) {
+  if (line.compare(line.find_first_not_of(" \t"), 10, "#extension") != 0)
+    return false;
+  for (const char* extension : kCoreExtensions) {
+    if (line.find(extension) != std::string::npos)
+      return true;
+  }
+  return false;
+}
+
+// Returns `source` with each identifier found in `replacements` replaced.
+// Comments are copied as is.
+std::string ReplaceIdentifiers(
+    const std::string& source,
+    const std::map<std::string, std::string>& replacements) {
+  std::string result;
+  result.reserve(source.size() + 64);
+  size_t index = 0;
+  while (index < source.size()) {
+    const char kCharacter = source[index];
+    if (source.compare(index, 2, "//") == 0 ||
+        source.compare(index, 2, "/*") == 0) {
+      const bool kIsLineComment = source[index + 1] == '/';
+      const size_t kEnd = source.find(kIsLineComment ? "\n" : "*/", index);
+      const size_t kLength = kEnd == std::string::npos ? \
+          std::string::npos : kEnd - index + (kIsLineComment ? 0 : 2);
+      result.append(source, index, kLength);
+      if (kEnd == std::string::npos)
+        break;
+      index += kLength;
+    } else if (std::isalpha(kCharacter) || kCharacter == '_') {
+      size_t end = index + 1;
+      while (end < source.size() &&
+             (std::isalnum(source[end]) || source[end] == '_')) {
+        ++end;
+      }
+      const std::string kIdentifier = source.substr(index, end - index);
+      auto iterator = replacements.find(kIdentifier);
+      result.append(iterator == replacements.end() ? kIdentifier : \
+                    iterator->second);
+      index = end;
+    } else if (std::isdigit(kCharacter)) {
+      // Skips numbers so suffixes aren't taken as identifiers.
+      size_t end = index + 1;
+      while (end < source.size() &&
+             (std::isalnum(source[end]) || source[end] == '.')) {
+        ++end;
+      }
+      result.append(source, index, end - index);
+      index = end;
+    } else {
+      result.push_back(kCharacter);
+      ++index;
+    }
+  }
+  return result;
+}
+
 GLuint CompileShader(const GLenum shader_type, std::string source) {
   GLuint shader_handle = glCreateShader(shader_type);
   if (shader_handle == 0)
@@ -78,8 +173,12 @@ GLuint CompileShader(const GLenum shader_type, std::string source) {
 
 namespace glfc {
 
-Program::Program() : array_buffer_(0), fragment_shader_(0), index_buffer_(0),
-                     is_initialized_(false), program_(0), vertex_shader_(0) {
+Program::Program() : estimated_memory_usage_(0), is_initialized_(false) {
+}
+
+Program::Program(Program&& other)
+    : estimated_memory_usage_(0), is_initialized_(false) {
+  *this = std::move(other);
 }
 
 Program::~Program() {
@@ -87,20 +186,62 @@ Program::~Program() {
     Finalize();
 }
 
+Program& Program::operator=(Program&& other) {
+  if (this == &other)
+    return *this;
+
+  if (is_initialized_)
+    Finalize();
+  array_buffer_ = std::move(other.array_buffer_);
+  estimated_memory_usage_ = other.estimated_memory_usage_;
+  fragment_shader_ = std::move(other.fragment_shader_);
+  index_buffer_ = std::move(other.index_buffer_);
+  is_initialized_ = other.is_initialized_;
+  position_attribute_ = other.position_attribute_;
+  program_ = std::move(other.program_);
+  texture_coordinate_attribute_ = other.texture_coordinate_attribute_;
+  texture_uniform_ = other.texture_uniform_;
+  vertex_array_ = std::move(other.vertex_array_);
+  vertex_shader_ = std::move(other.vertex_shader_);
+  // The memory is now tracked by this program.
+  other.estimated_memory_usage_ = 0;
+  other.is_initialized_ = false;
+  return *this;
+}
+
+void Program::BindAttributes() const {
+  // Binds the `position` attribute.
+  glEnableVertexAttribArray(position_attribute_);
+  glVertexAttribPointer(position_attribute_, 2, GL_FLOAT, GL_FALSE,
+                        sizeof(Vertex), reinterpret_cast<GLvoid*>(0));
+
+  // Binds the `inputTextureCoordinate` attribute.
+  glEnableVertexAttribArray(texture_coordinate_attribute_);
+  glVertexAttribPointer(
+      texture_coordinate_attribute_, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+      reinterpret_cast<GLvoid*>(sizeof(FramebufferCoordinate)));
+}
+
 bool Program::Init(const std::string vertex_shader_source,
                    const std::string fragment_shader_source) {
+  GLFC_TRACE_SCOPE("Program::Init");
+  ScopedCompileTimer compile_timer;
   if (is_initialized_) {
     Finalize();
   }
 
-  program_ = glCreateProgram();
-  if (program_ == 0) {
+  program_ = ProgramHandle::Create();
+  if (!program_) {
     Finalize();
     return false;
   }
 
-  vertex_shader_ = CompileShader(GL_VERTEX_SHADER, vertex_shader_source);
-  if (vertex_shader_ == 0) {
+  const Capabilities& kCapabilities = GetCapabilities();
+  vertex_shader_.Reset(CompileShader(
+      GL_VERTEX_SHADER,
+      TranslateShader(vertex_shader_source, GL_VERTEX_SHADER,
+                      kCapabilities.shading_language_version)));
+  if (!vertex_shader_) {
     Finalize();
 #ifdef DEBUG
     GLFC_LOG("--- Vertex Shader Source ---\n%s\n--- END ---\n",
@@ -108,8 +249,11 @@ bool Program::Init(const std::string vertex_shader_source,
 #endif
     return false;
   }
-  fragment_shader_ = CompileShader(GL_FRAGMENT_SHADER, fragment_shader_source);
-  if (fragment_shader_ == 0) {
+  fragment_shader_.Reset(CompileShader(
+      GL_FRAGMENT_SHADER,
+      TranslateShader(fragment_shader_source, GL_FRAGMENT_SHADER,
+                      kCapabilities.shading_language_version)));
+  if (!fragment_shader_) {
     Finalize();
 #ifdef DEBUG
     GLFC_LOG("--- Fragment Shader Source ---\n%s\n--- END ---\n",
@@ -118,11 +262,11 @@ bool Program::Init(const std::string vertex_shader_source,
     return false;
   }
 
-  glAttachShader(program_, vertex_shader_);
-  glAttachShader(program_, fragment_shader_);
-  glLinkProgram(program_);
+  glAttachShader(program_.get(), vertex_shader_.get());
+  glAttachShader(program_.get(), fragment_shader_.get());
+  glLinkProgram(program_.get());
   GLint status;
-  glGetProgramiv(program_, GL_LINK_STATUS, &status);
+  glGetProgramiv(program_.get(), GL_LINK_STATUS, &status);
   if (status != GL_TRUE) {
     Finalize();
 #ifdef DEBUG
@@ -132,37 +276,61 @@ bool Program::Init(const std::string vertex_shader_source,
   }
   GLint current_program;
   glGetIntegerv(GL_CURRENT_PROGRAM, &current_program);
-  glUseProgram(program_);
-  position_attribute_ = glGetAttribLocation(program_, "position");
+  glUseProgram(program_.get());
+  position_attribute_ = glGetAttribLocation(program_.get(), "position");
   texture_coordinate_attribute_ = glGetAttribLocation(
-      program_, "inputTextureCoordinate");
-  texture_uniform_ = glGetUniformLocation(program_, "inputImageTexture");
-  glGenBuffers(1, &array_buffer_);
-  glGenBuffers(1, &index_buffer_);
+      program_.get(), "inputTextureCoordinate");
+  texture_uniform_ = glGetUniformLocation(program_.get(),
+                                          "inputImageTexture");
   glUseProgram(current_program);
+
+  // Uploads the quad once. With vertex array objects, the attribute and
+  // index buffer bindings are recorded as well so `Use()` is a single bind.
+  if (kCapabilities.supports_vertex_array_objects) {
+    vertex_array_ = VertexArrayHandle::Create();
+#ifdef GLFC_GL3_API
+    glBindVertexArray(vertex_array_.get());
+#endif
+  }
+  array_buffer_ = BufferHandle::Create();
+  glBindBuffer(GL_ARRAY_BUFFER, array_buffer_.get());
+  glBufferData(GL_ARRAY_BUFFER, sizeof(kArrayBuffer), kArrayBuffer,
+               GL_STATIC_DRAW);
+  index_buffer_ = BufferHandle::Create();
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_.get());
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * kIndexBufferCount,
+               kIndexBuffer, GL_STATIC_DRAW);
+  if (vertex_array_) {
+    BindAttributes();
+#ifdef GLFC_GL3_API
+    glBindVertexArray(0);
+#endif
+  } else {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
   is_initialized_ = true;
+
+  estimated_memory_usage_ = sizeof(kArrayBuffer) + sizeof(kIndexBuffer) + \
+                            vertex_shader_source.size() + \
+                            fragment_shader_source.size();
+  internal::TrackProgramMemory(
+      static_cast<std::ptrdiff_t>(estimated_memory_usage_));
   return true;
 }
 
 void Program::Finalize() {
-  if (array_buffer_ > 0) {
-    glDeleteBuffers(1, &array_buffer_);
-  }
-  if (index_buffer_ > 0) {
-    glDeleteBuffers(1, &index_buffer_);
-  }
-  if (vertex_shader_ > 0) {
-    glDeleteShader(vertex_shader_);
-    vertex_shader_ = 0;
-  }
-  if (fragment_shader_ > 0) {
-    glDeleteShader(fragment_shader_);
-    fragment_shader_ = 0;
-  }
-  if (program_ > 0) {
-    glDeleteProgram(program_);
-    program_ = 0;
+  if (estimated_memory_usage_ > 0) {
+    internal::TrackProgramMemory(
+        -static_cast<std::ptrdiff_t>(estimated_memory_usage_));
+    estimated_memory_usage_ = 0;
   }
+  vertex_array_.Reset();
+  array_buffer_.Reset();
+  index_buffer_.Reset();
+  vertex_shader_.Reset();
+  fragment_shader_.Reset();
+  program_.Reset();
   is_initialized_ = false;
 }
 
@@ -174,41 +342,106 @@ void Program::Render(const GLuint input_texture) {
 
   glDrawElements(GL_TRIANGLES, static_cast<GLsizeiptr>(kIndexBufferCount),
                  GL_UNSIGNED_INT, reinterpret_cast<GLvoid*>(0));
+  internal::CountPass();
 
-  glDisableVertexAttribArray(position_attribute_);
-  glDisableVertexAttribArray(texture_coordinate_attribute_);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  if (vertex_array_) {
+#ifdef GLFC_GL3_API
+    glBindVertexArray(0);
+#endif
+  } else {
+    glDisableVertexAttribArray(position_attribute_);
+    glDisableVertexAttribArray(texture_coordinate_attribute_);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  }
   glUseProgram(0);
   glBindTexture(GL_TEXTURE_2D, 0);
   glFlush();
 }
 
-void Program::Use() {
-  glUseProgram(program_);
-  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-  glEnable(GL_BLEND);
+std::string Program::TranslateShader(const std::string& source,
+                                     const GLenum shader_type,
+                                     const std::string& version) {
+  if (version.empty())
+    return source;
 
-  // Binds the array buffer object.
-  glBindBuffer(GL_ARRAY_BUFFER, array_buffer_);
-  glBufferData(GL_ARRAY_BUFFER, sizeof(kArrayBuffer), kArrayBuffer,
-               GL_STATIC_DRAW);
+  // Splits the source into the `#version` directive, if any, and the body.
+  std::string source_version;
+  std::string body = source;
+  const size_t kStart = source.find_first_not_of(" \t\r\n");
+  if (kStart != std::string::npos &&
+      source.compare(kStart, 8, "#version") == 0) {
+    const size_t kEnd = source.find('\n', kStart);
+    const std::string kDirective = source.substr(
+        kStart + 8, kEnd == std::string::npos ? kEnd : kEnd - kStart - 8);
+    const size_t kFirst = kDirective.find_first_not_of(" \t");
+    const size_t kLast = kDirective.find_last_not_of(" \t\r");
+    if (kFirst != std::string::npos)
+      source_version = kDirective.substr(kFirst, kLast - kFirst + 1);
+    body = kEnd == std::string::npos ? "" : source.substr(kEnd + 1);
+  }
+  if (source_version == version)
+    return source;
 
-  // Binds the `position` attribute.
-  glEnableVertexAttribArray(position_attribute_);
-  glVertexAttribPointer(position_attribute_, 2, GL_FLOAT, GL_FALSE,
-                        sizeof(Vertex), reinterpret_cast<GLvoid*>(0));
+  std::string result = "#version " + version + "\n";
+  // GLSL ES 3.00 and GLSL 3.30 only differ in the directive as far as the
+  // shaders of glfc are concerned.
+  if (!source_version.empty() && source_version != "100") {
+    result.append(body);
+    return result;
+  }
 
-  // Binds the `inputTextureCoordinate` attribute.
-  glEnableVertexAttribArray(texture_coordinate_attribute_);
-  glVertexAttribPointer(
-      texture_coordinate_attribute_, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
-      reinterpret_cast<GLvoid*>(sizeof(FramebufferCoordinate)));
+  // Translates GLSL ES 1.00. Extension directives have to precede any
+  // declaration, so the fragment output is declared after the leading
+  // directives.
+  std::map<std::string, std::string> replacements = {
+      {"texture2D", "texture"}, {"texture2DLodEXT", "textureLod"},
+      {"texture2DProj", "textureProj"}, {"textureCube", "texture"}};
+  if (shader_type == GL_VERTEX_SHADER) {
+    replacements["attribute"] = "in";
+    replacements["varying"] = "out";
+  } else {
+    replacements["gl_FragColor"] = kFragmentColorName;
+    replacements["varying"] = "in";
+  }
+  const std::string kTranslatedBody = ReplaceIdentifiers(body, replacements);
+  bool has_declared_output = shader_type != GL_FRAGMENT_SHADER;
+  size_t line_start = 0;
+  while (line_start < kTranslatedBody.size()) {
+    size_t line_end = kTranslatedBody.find('\n', line_start);
+    if (line_end == std::string::npos)
+      line_end = kTranslatedBody.size();
+    const std::string kLine = kTranslatedBody.substr(
+        line_start, line_end - line_start);
+    const size_t kFirst = kLine.find_first_not_of(" \t\r");
+    if (!has_declared_output && kFirst != std::string::npos &&
+        kLine[kFirst] != '#') {
+      result.append("out mediump vec4 ");
+      result.append(kFragmentColorName);
+      result.append(";\n");
+      has_declared_output = true;
+    }
+    if (kFirst == std::string::npos || !IsCoreExtensionDirective(kLine))
+      result.append(kLine).append("\n");
+    line_start = line_end + 1;
+  }
+  return result;
+}
 
-  // Binds the index buffer object.
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(int) * kIndexBufferCount,
-               kIndexBuffer, GL_STATIC_DRAW);
+void Program::Use() {
+  glUseProgram(program_.get());
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  glEnable(GL_BLEND);
+  if (vertex_array_) {
+#ifdef GLFC_GL3_API
+    glBindVertexArray(vertex_array_.get());
+#endif
+    return;
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, array_buffer_.get());
+  BindAttributes();
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_.get());
 }
 
 }  // namespace glfc
@@ -18,9 +18,11 @@
 #ifndef GLFC_PROGRAM_H_
 #define GLFC_PROGRAM_H_
 
+#include <cstddef>
 #include <string>
 
 #include "glfc/base.h"
+#include "glfc/gl_handle.h"
 #include "glfc/opengl_hook.h"
 
 namespace glfc {
@@ -35,11 +37,22 @@ namespace glfc {
 // `sampler2D inputImageTexture` uniform is required. If you declare other
 // attributes or uniforms, you must set the values for them between the
 // `Init()` and `Render()` calls.
+//
+// Shaders can be written in GLSL ES 1.00 without a `#version` directive, or
+// in GLSL ES 3.00 writing to an `out vec4 fragColor`. Both are translated to
+// `Capabilities::shading_language_version` of the current context before
+// compiling, so the same shaders run on OpenGL ES 2, OpenGL ES 3 and
+// OpenGL 3.3 core contexts.
+//
+// Programs can be moved but not copied, so they can be held by value.
 class Program {
  public:
   Program();
+  Program(Program&& other);
   ~Program();
 
+  Program& operator=(Program&& other);
+
   // Initializes the program. The `Finalize()` method must be called before
   // another `Init()` call.
   bool Init(const std::string vertex_shader, const std::string fragment_shader);
@@ -50,22 +63,39 @@ class Program {
   // Renders the `input_texture` to the currently binded framebuffer.
   void Render(const GLuint input_texture);
 
+  // Returns the GLSL ES 1.00 or 3.00 `source` of a `shader_type` shader
+  // translated to the `#version` directive argument `version`, such as
+  // "300 es" or "330". Returns `source` as is if `version` is empty or the
+  // source already declares it.
+  static std::string TranslateShader(const std::string& source,
+                                     const GLenum shader_type,
+                                     const std::string& version);
+
   // Uses the program.
   void Use();
 
   // Accessors.
+  size_t estimated_memory_usage() const { return estimated_memory_usage_; }
   bool is_initialized() const { return is_initialized_; }
-  GLuint program() const { return program_; }
+  GLuint program() const { return program_.get(); }
 
  private:
-  // The array buffer object name.
-  GLuint array_buffer_;
+  // Binds the attributes to the quad in the array buffer, which must be
+  // bound.
+  void BindAttributes() const;
 
-  // The fragment shader name.
-  GLuint fragment_shader_;
+  // The array buffer object.
+  BufferHandle array_buffer_;
 
-  // The index buffer object name.
-  GLuint index_buffer_;
+  // The estimated number of bytes of GPU memory held by the program and its
+  // buffers. See `MemoryUsage::program_bytes` for details.
+  size_t estimated_memory_usage_;
+
+  // The fragment shader object.
+  ShaderHandle fragment_shader_;
+
+  // The index buffer object.
+  BufferHandle index_buffer_;
 
   // Indicates if the program has been initialized.
   bool is_initialized_;
@@ -73,8 +103,8 @@ class Program {
   // The location of the `position` attribute defined in the vertex shader.
   GLint position_attribute_;
 
-  // The program name.
-  GLuint program_;
+  // The program object.
+  ProgramHandle program_;
 
   // The location of the `inputTextureCoordinate` attribute defined in the
   // vertex shader.
@@ -83,8 +113,12 @@ class Program {
   // Keeps the uniform location of the input texture.
   GLint texture_uniform_;
 
-  // The vertex shader name.
-  GLuint vertex_shader_;
+  // The vertex array object recording the attribute bindings. This is empty
+  // if the context doesn't support vertex array objects.
+  VertexArrayHandle vertex_array_;
+
+  // The vertex shader object.
+  ShaderHandle vertex_shader_;
 
   GLFC_DISALLOW_COPY_AND_ASSIGN(Program);
 };
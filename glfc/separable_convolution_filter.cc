@@ -0,0 +1,655 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/separable_convolution_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glfc/capabilities.h"
+#include "glfc/framebuffer.h"
+#include "glfc/opengl_hook.h"
+#include "glfc/program.h"
+#include "glfc/trace.h"
+
+namespace {
+
+// The vertex shader of the program writing masks to stencil.
+const char* kMaskVertexShader = R"(
+attribute vec4 position;
+attribute vec2 inputTextureCoordinate;
+
+varying vec2 textureCoordinate;
+
+void main() {
+  gl_Position = position;
+  textureCoordinate = inputTextureCoordinate;
+})";
+
+// The fragment shader of the program writing masks to stencil. Fragments
+// outside the rounded rectangle grown by `dilation` pixels, or below half
+// alpha in the mask texture, are discarded so they don't write stencil.
+const char* kMaskFragmentShader = R"(
+#ifdef GL_FRAGMENT_PRECISION_HIGH
+precision highp float;
+#else
+precision mediump float;
+#endif
+uniform sampler2D inputImageTexture;
+uniform float cornerRadius;
+uniform float dilation;
+uniform vec4 maskRect;
+uniform bool maskTextureEnabled;
+
+varying vec2 textureCoordinate;
+
+void main() {
+  vec2 corner = abs(gl_FragCoord.xy - maskRect.xy) - maskRect.zw +
+                cornerRadius;
+  float distance = length(max(corner, 0.0)) +
+                   min(max(corner.x, corner.y), 0.0) - cornerRadius;
+  if (distance > dilation)
+    discard;
+  if (maskTextureEnabled &&
+      texture2D(inputImageTexture, textureCoordinate).a < 0.5)
+    discard;
+  gl_FragColor = vec4(0.0);
+})";
+
+// The output of the passes of the default shaders.
+const char* kDefaultOutputExpression = "sum";
+
+// A texture read on each side of the center.
+struct Tap {
+  // The distance in texels from the center, which is fractional for folded
+  // taps.
+  float offset;
+  // The weight applied to the read.
+  float weight;
+};
+
+// Appends the string formatted from `format` to `string`.
+void AppendFormat(std::string* string, const char* format, ...) {
+  va_list arguments;
+  va_start(arguments, format);
+  va_list arguments_copy;
+  va_copy(arguments_copy, arguments);
+  const int kLength = std::vsnprintf(NULL, 0, format, arguments) + 1;
+  va_end(arguments);
+  std::vector<char> buffer(kLength);
+  std::vsnprintf(buffer.data(), kLength, format, arguments_copy);
+  va_end(arguments_copy);
+  string->append(buffer.data());
+}
+
+// Folds the weights of `kernel` except the center into taps. Two adjacent
+// weights of the same sign are read with one bilinear fetch placed between
+// the texels so that the interpolation reproduces both weights. Weights of
+// opposite signs can't be expressed by interpolation and are read separately.
+std::vector<Tap> FoldKernel(const std::vector<float>& kernel) {
+  std::vector<Tap> taps;
+  for (size_t index = 1; index < kernel.size(); index += 2) {
+    const float kFirstWeight = kernel[index];
+    const float kSecondWeight = \
+        index + 1 < kernel.size() ? kernel[index + 1] : 0;
+    const float kOptimizedWeight = kFirstWeight + kSecondWeight;
+    if (kFirstWeight * kSecondWeight >= 0) {
+      if (kOptimizedWeight != 0) {
+        const float kOptimizedOffset = \
+            (kFirstWeight * index + kSecondWeight * (index + 1)) /
+            kOptimizedWeight;
+        taps.push_back({kOptimizedOffset, kOptimizedWeight});
+      }
+      continue;
+    }
+    taps.push_back({static_cast<float>(index), kFirstWeight});
+    taps.push_back({static_cast<float>(index + 1), kSecondWeight});
+  }
+  return taps;
+}
+
+// Returns the number of taps whose coordinates are passed from the vertex
+// shader as varyings. Both coordinates of a tap share one vector and the
+// center takes another, so the minimum of 8 vectors guaranteed by OpenGL ES 2
+// allows 7 taps while OpenGL ES 3 allows at least 14. Farther taps are
+// dependent reads.
+int GetNumberOfVaryingTaps(const std::vector<Tap>& taps) {
+  return std::min<int>(taps.size(),
+                       glfc::GetCapabilities().max_varying_vectors - 1);
+}
+
+// Returns `true` if the framebuffer currently binded to OpenGL has a stencil
+// buffer.
+bool HasStencilBuffer() {
+#ifdef GLFC_GL3
+  // The stencil size isn't a state of the core profile.
+  GLint framebuffer;
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &framebuffer);
+  GLint type = GL_NONE;
+  glGetFramebufferAttachmentParameteriv(
+      GL_FRAMEBUFFER, framebuffer == 0 ? GL_STENCIL : GL_STENCIL_ATTACHMENT,
+      GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &type);
+  return type != GL_NONE;
+#else
+  GLint stencil_bits = 0;
+  glGetIntegerv(GL_STENCIL_BITS, &stencil_bits);
+  return stencil_bits > 0;
+#endif
+}
+
+// The stencil state of the caller, which masked renders change.
+struct StencilState {
+  // The `GL_STENCIL_CLEAR_VALUE` parameter.
+  GLint clear_value;
+
+  // The `GL_STENCIL_FAIL` parameter.
+  GLint fail;
+
+  // The `GL_STENCIL_FUNC` parameter.
+  GLint function;
+
+  // The `GL_STENCIL_PASS_DEPTH_FAIL` parameter.
+  GLint pass_depth_fail;
+
+  // The `GL_STENCIL_PASS_DEPTH_PASS` parameter.
+  GLint pass_depth_pass;
+
+  // The `GL_STENCIL_REF` parameter.
+  GLint reference;
+
+  // Indicates whether `GL_STENCIL_TEST` is enabled.
+  GLboolean test_is_enabled;
+
+  // The `GL_STENCIL_VALUE_MASK` parameter.
+  GLint value_mask;
+};
+
+// Returns the stencil state currently set in OpenGL.
+StencilState GetStencilState() {
+  StencilState state;
+  glGetIntegerv(GL_STENCIL_CLEAR_VALUE, &state.clear_value);
+  glGetIntegerv(GL_STENCIL_FAIL, &state.fail);
+  glGetIntegerv(GL_STENCIL_FUNC, &state.function);
+  glGetIntegerv(GL_STENCIL_PASS_DEPTH_FAIL, &state.pass_depth_fail);
+  glGetIntegerv(GL_STENCIL_PASS_DEPTH_PASS, &state.pass_depth_pass);
+  glGetIntegerv(GL_STENCIL_REF, &state.reference);
+  state.test_is_enabled = glIsEnabled(GL_STENCIL_TEST);
+  glGetIntegerv(GL_STENCIL_VALUE_MASK, &state.value_mask);
+  return state;
+}
+
+// Sets the stencil state returned by `GetStencilState()` back to OpenGL.
+void RestoreStencilState(const StencilState& state) {
+  glClearStencil(state.clear_value);
+  glStencilFunc(state.function, state.reference, state.value_mask);
+  glStencilOp(state.fail, state.pass_depth_fail, state.pass_depth_pass);
+  if (state.test_is_enabled)
+    glEnable(GL_STENCIL_TEST);
+  else
+    glDisable(GL_STENCIL_TEST);
+}
+
+}  // namespace
+
+namespace glfc {
+
+SeparableConvolutionFilter::SeparableConvolutionFilter()
+    : has_mask_(false), horizontal_program_(new Program), kernel_(1, 1),
+      mask_program_(new Program),
+      should_update_shaders_(true),
+      texel_height_offset_(0),
+      texel_spacing_multiplier_(1), texel_width_offset_(0),
+      yuv_input_(nullptr), yuv_program_(new Program),
+      yuv_program_format_(kYuvFormatNV12) {
+}
+
+SeparableConvolutionFilter::~SeparableConvolutionFilter() {
+}
+
+bool SeparableConvolutionFilter::ApplyFilterToFramebuffer(
+    const GLuint input_texture, Program* program, Framebuffer* framebuffer) {
+  if (should_update_shaders_) {
+    if (horizontal_program_->is_initialized())
+      horizontal_program_->Finalize();
+    if (yuv_program_->is_initialized())
+      yuv_program_->Finalize();
+
+    // The horizontal pass of RGBA inputs shares the program of the vertical
+    // pass unless a subclass customizes either of them.
+    const std::string kSamplingShader = GetSamplingShader(true);
+    if ((kSamplingShader != GetSamplingShader(false) ||
+         GetOutputExpression() != kDefaultOutputExpression) &&
+        !horizontal_program_->Init(
+            GetVertexShader(),
+            GenerateFragmentShader(kSamplingShader,
+                                   kDefaultOutputExpression))) {
+#ifdef DEBUG
+      GLFC_LOG("!! Failed to initialize program for horizontal pass.\n");
+#endif
+      return false;
+    }
+  }
+  should_update_shaders_ = false;
+
+  // YUV inputs are converted by a dedicated program in the first pass.
+  Program* first_pass_program = horizontal_program_->is_initialized() ? \
+                                horizontal_program_.get() : program;
+  if (yuv_input_ != nullptr) {
+    if (!yuv_program_->is_initialized() ||
+        yuv_program_format_ != yuv_input_->format) {
+      yuv_program_format_ = yuv_input_->format;
+      if (!yuv_program_->Init(
+              GetVertexShader(),
+              GenerateFragmentShader(
+                  GetYuvSamplingShader(yuv_program_format_),
+                  kDefaultOutputExpression))) {
+#ifdef DEBUG
+        GLFC_LOG("!! Failed to initialize program for YUV input.\n");
+#endif
+        return false;
+      }
+    }
+    first_pass_program = yuv_program_.get();
+  }
+
+  // A scaled intermediate has a viewport of its own, so the original one is
+  // restored for the vertical pass. Masked renders also restore it since the
+  // mask is placed relative to its origin.
+  const float kFramebufferScale = GetFramebufferScale();
+  const bool kShouldRestoreViewport = kFramebufferScale != 1 || has_mask_;
+  GLint viewport[4] = {0, 0, framebuffer->width(), framebuffer->height()};
+  if (kShouldRestoreViewport)
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+  // Masked renders apply the vertical pass directly to the current
+  // framebuffer if it has a stencil buffer. Otherwise they need a
+  // framebuffer of their own.
+  const bool kRendersToMaskFramebuffer = has_mask_ && !HasStencilBuffer();
+
+  // Masks are written to stencil, the caller's stencil state is restored
+  // afterwards. Its stencil contents are overwritten when rendering
+  // directly to the current framebuffer though.
+  StencilState stencil_state;
+  if (has_mask_)
+    stencil_state = GetStencilState();
+
+  // First pass. Applies the kernel to the input texture for horizontal
+  // direction.
+  {
+    GLFC_TRACE_SCOPE("SeparableConvolutionFilter::HorizontalPass");
+    framebuffer->Bind();
+    framebuffer->Clear();
+    // The vertical pass reads the horizontal result up to the kernel radius
+    // away from each masked pixel.
+    if (has_mask_ &&
+        !WriteMaskToStencil(
+            device_pixel_ratio() * kFramebufferScale,
+            std::ceil(GetKernelRadius(device_pixel_ratio()) *
+                      kFramebufferScale), 0, 0)) {
+      framebuffer->Unbind();
+      glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+      return false;
+    }
+    texel_width_offset_ = texel_spacing_multiplier_ / framebuffer->width();
+    texel_height_offset_ = 0;
+    first_pass_program->Use();
+    SetUniforms(first_pass_program);
+    SetColorStageUniforms(first_pass_program, false);
+    if (yuv_input_ != nullptr)
+      SetYuvUniforms(*yuv_input_, first_pass_program);
+    else
+      SetPassUniforms(first_pass_program, *framebuffer, true);
+    first_pass_program->Render(input_texture);
+    if (yuv_input_ != nullptr)
+      UnbindYuvTextures(*yuv_input_);
+    if (has_mask_)
+      RestoreStencilState(stencil_state);
+    framebuffer->Unbind();
+  }
+  if (kShouldRestoreViewport)
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+  Framebuffer* output_framebuffer = nullptr;
+  if (kRendersToMaskFramebuffer) {
+    if (mask_framebuffer_ &&
+        (mask_framebuffer_->width() != viewport[2] ||
+         mask_framebuffer_->height() != viewport[3])) {
+      mask_framebuffer_.reset();
+    }
+    if (!mask_framebuffer_) {
+      FramebufferDescriptor descriptor;
+      descriptor.has_stencil_attachment = true;
+      mask_framebuffer_.reset(new Framebuffer(viewport[2], viewport[3],
+                                              descriptor));
+      if (!mask_framebuffer_->Init()) {
+        mask_framebuffer_.reset();
+#ifdef DEBUG
+        GLFC_LOG("!! Failed to initialize framebuffer for mask.\n");
+#endif
+        return false;
+      }
+    }
+    output_framebuffer = mask_framebuffer_.get();
+    output_framebuffer->Bind();
+    output_framebuffer->Clear();
+    if (!WriteMaskToStencil(device_pixel_ratio(), 0, 0, 0)) {
+      output_framebuffer->Unbind();
+      glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+      return false;
+    }
+  } else if (has_mask_) {
+    // The intermediate framebuffer isn't needed while rendering directly.
+    mask_framebuffer_.reset();
+    glClearStencil(0);
+    glClear(GL_STENCIL_BUFFER_BIT);
+    if (!WriteMaskToStencil(device_pixel_ratio(), 0, viewport[0],
+                            viewport[1])) {
+      RestoreStencilState(stencil_state);
+      return false;
+    }
+  }
+
+  // Second pass. Applies the kernel to the `framebuffer`'s internal texture
+  // for vertical direction.
+  {
+    GLFC_TRACE_SCOPE("SeparableConvolutionFilter::VerticalPass");
+    texel_width_offset_ = 0;
+    texel_height_offset_ = \
+        texel_spacing_multiplier_ / framebuffer->height();
+    program->Use();
+    glBlendFunc(GL_ONE, GL_ZERO);
+    SetUniforms(program);
+    SetColorStageUniforms(program, true);
+    SetPassUniforms(program, *framebuffer, false);
+    program->Render(framebuffer->texture());
+  }
+
+  if (has_mask_)
+    RestoreStencilState(stencil_state);
+  if (output_framebuffer != nullptr) {
+    output_framebuffer->Unbind();
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    output_framebuffer->Render();
+    output_framebuffer->Discard();
+  }
+
+  // The intermediate result has been consumed and will be cleared before the
+  // next use, there's no need for the driver to preserve it.
+  framebuffer->Discard();
+  return true;
+}
+
+void SeparableConvolutionFilter::ClearMask() {
+  if (!has_mask_)
+    return;
+
+  has_mask_ = false;
+  mask_framebuffer_.reset();
+  InvalidateCache();
+}
+
+std::string SeparableConvolutionFilter::GenerateFragmentShader(
+    const std::string& sampling_shader,
+    const std::string& output_expression) const {
+  const std::vector<float> kKernel = GetKernel(device_pixel_ratio());
+  if (kKernel.empty()) return "";
+  const std::vector<Tap> kTaps = FoldKernel(kKernel);
+  const int kNumberOfVaryingTaps = GetNumberOfVaryingTaps(kTaps);
+
+  std::string shader_string;
+  // Header
+  shader_string.append(R"(
+precision mediump float;
+uniform sampler2D inputImageTexture;
+uniform float texelWidthOffset;
+uniform float texelHeightOffset;
+)");
+  shader_string.append(sampling_shader);
+  shader_string.append(R"(
+
+varying vec2 centerCoordinate;)");
+  if (kNumberOfVaryingTaps > 0) {
+    AppendFormat(&shader_string, R"(
+varying vec4 sampleCoordinates[%d];)", kNumberOfVaryingTaps);
+  }
+  shader_string.append(R"(
+
+void main() {
+  vec4 sum = vec4(0.0);)");
+
+  // Inner texture loop.
+  AppendFormat(&shader_string, R"(
+  sum += sampleInput(centerCoordinate) * %f;)", kKernel[0]);
+  for (int index = 0; index < kNumberOfVaryingTaps; ++index) {
+    AppendFormat(&shader_string, R"(
+  sum += sampleInput(sampleCoordinates[%d].xy) * %f;
+  sum += sampleInput(sampleCoordinates[%d].zw) * %f;)",
+                 index, kTaps[index].weight, index, kTaps[index].weight);
+  }
+
+  // If the number of required samples exceeds the amount we can pass in via
+  // varyings, we have to do dependent texture reads in the fragment shader.
+  if (static_cast<int>(kTaps.size()) > kNumberOfVaryingTaps) {
+    shader_string.append(R"(
+  vec2 singleStepOffset = vec2(texelWidthOffset, texelHeightOffset);)");
+    for (size_t index = kNumberOfVaryingTaps; index < kTaps.size(); ++index) {
+      const Tap& kTap = kTaps[index];
+      AppendFormat(&shader_string, R"(
+  sum += sampleInput(centerCoordinate + singleStepOffset * %f) * %f;
+  sum += sampleInput(centerCoordinate - singleStepOffset * %f) * %f;)",
+                   kTap.offset, kTap.weight, kTap.offset, kTap.weight);
+    }
+  }
+
+  // Footer
+  AppendFormat(&shader_string, R"(
+  gl_FragColor = %s;
+})", output_expression.c_str());
+  return shader_string;
+}
+
+std::vector<float> SeparableConvolutionFilter::GetKernel(
+    const float device_pixel_ratio) const {
+  return kernel_;
+}
+
+int SeparableConvolutionFilter::GetKernelRadius(
+    const float device_pixel_ratio) const {
+  // Bilinear fetches of the farthest folded tap may touch the texel beyond
+  // the last weight. The kernel is in texels of the intermediate, which may
+  // have a lower resolution than the output.
+  const int kRadius = \
+      static_cast<int>(GetKernel(device_pixel_ratio).size()) - 1;
+  if (kRadius <= 0) return 0;
+  return std::ceil((kRadius + 1) * texel_spacing_multiplier_ /
+                   GetFramebufferScale());
+}
+
+FramebufferDescriptor
+SeparableConvolutionFilter::GetFramebufferDescriptor() const {
+  FramebufferDescriptor descriptor;
+  descriptor.has_stencil_attachment = has_mask_;
+  return descriptor;
+}
+
+std::string SeparableConvolutionFilter::GetFragmentShader() const {
+  return GenerateFragmentShader(GetSamplingShader(false),
+                                GetOutputExpression());
+}
+
+std::string SeparableConvolutionFilter::GetOutputExpression() const {
+  return kDefaultOutputExpression;
+}
+
+std::string SeparableConvolutionFilter::GetSamplingShader(
+    const bool is_horizontal_pass) const {
+  return R"(
+#define sampleInput(coordinate) texture2D(inputImageTexture, coordinate))";
+}
+
+std::string SeparableConvolutionFilter::GetVertexShader() const {
+  const std::vector<float> kKernel = GetKernel(device_pixel_ratio());
+  if (kKernel.empty()) return "";
+  const std::vector<Tap> kTaps = FoldKernel(kKernel);
+  const int kNumberOfVaryingTaps = GetNumberOfVaryingTaps(kTaps);
+
+  std::string shader_string;
+  // Header
+  shader_string.append(R"(
+precision mediump float;
+attribute vec4 position;
+attribute vec2 inputTextureCoordinate;
+
+uniform float texelWidthOffset;
+uniform float texelHeightOffset;
+uniform vec2 inputOffset;
+
+varying vec2 centerCoordinate;)");
+  if (kNumberOfVaryingTaps > 0) {
+    AppendFormat(&shader_string, R"(
+varying vec4 sampleCoordinates[%d];)", kNumberOfVaryingTaps);
+  }
+  shader_string.append(R"(
+
+void main() {
+  gl_Position = position;
+
+  vec2 singleStepOffset = vec2(texelWidthOffset, texelHeightOffset);)");
+
+  // Inner offset loop. Each vector holds the coordinates on both sides.
+  shader_string.append(R"(
+  centerCoordinate = inputTextureCoordinate.xy - inputOffset;)");
+  for (int index = 0; index < kNumberOfVaryingTaps; ++index) {
+    AppendFormat(&shader_string, R"(
+  sampleCoordinates[%d] = vec4(
+      centerCoordinate + singleStepOffset * %f,
+      centerCoordinate - singleStepOffset * %f);)",
+                 index, kTaps[index].offset, kTaps[index].offset);
+  }
+
+  // Footer
+  shader_string.append(R"(
+})");
+  return shader_string;
+}
+
+bool SeparableConvolutionFilter::IsPlainConvolution() const {
+  return !has_mask_ && GetFramebufferScale() == 1 &&
+         GetOutputExpression() == kDefaultOutputExpression &&
+         GetSamplingShader(true) == GetSamplingShader(false);
+}
+
+std::vector<float> SeparableConvolutionFilter::MakeBoxKernel(
+    const int radius) {
+  if (radius < 0) return std::vector<float>();
+  return std::vector<float>(radius + 1, 1.0f / (radius * 2 + 1));
+}
+
+std::vector<float> SeparableConvolutionFilter::MakeSharpenKernel(
+    const float amount) {
+  return std::vector<float>{1 + amount * 2, -amount};
+}
+
+std::vector<float> SeparableConvolutionFilter::MakeTentKernel(
+    const int radius) {
+  if (radius < 0) return std::vector<float>();
+  // The weights `radius + 1 - distance` sum up to `(radius + 1)^2`.
+  const float kSumOfWeights = static_cast<float>(radius + 1) * (radius + 1);
+  std::vector<float> kernel(radius + 1);
+  for (int distance = 0; distance <= radius; ++distance)
+    kernel[distance] = (radius + 1 - distance) / kSumOfWeights;
+  return kernel;
+}
+
+bool SeparableConvolutionFilter::Render(const YuvInput& input,
+                                        const float width, const float height,
+                                        const float device_pixel_ratio) {
+  yuv_input_ = &input;
+  const bool kResult = Filter::Render(input.y_texture, width, height,
+                                      device_pixel_ratio);
+  yuv_input_ = nullptr;
+  return kResult;
+}
+
+void SeparableConvolutionFilter::SetUniforms(Program* program) const {
+  GLint texel_width_offset_uniform = \
+      glGetUniformLocation(program->program(), "texelWidthOffset");
+  glUniform1f(texel_width_offset_uniform, texel_width_offset_);
+
+  GLint texel_height_offset_uniform = \
+      glGetUniformLocation(program->program(), "texelHeightOffset");
+  glUniform1f(texel_height_offset_uniform, texel_height_offset_);
+}
+
+bool SeparableConvolutionFilter::ShouldUpdateShaders() const {
+  return should_update_shaders_;
+}
+
+void SeparableConvolutionFilter::set_mask(const ConvolutionMask& mask) {
+  mask_ = mask;
+  has_mask_ = true;
+  InvalidateCache();
+}
+
+bool SeparableConvolutionFilter::WriteMaskToStencil(const float scale,
+                                                    const float dilation,
+                                                    const int origin_x,
+                                                    const int origin_y) {
+  if (!mask_program_->is_initialized() &&
+      !mask_program_->Init(kMaskVertexShader, kMaskFragmentShader)) {
+#ifdef DEBUG
+    GLFC_LOG("!! Failed to initialize program for mask.\n");
+#endif
+    return false;
+  }
+
+  // Only the stencil is written, each covered fragment sets it to 1.
+  glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+  glEnable(GL_STENCIL_TEST);
+  glStencilFunc(GL_ALWAYS, 1, 0xFF);
+  glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
+
+  const GLuint kProgram = mask_program_->program();
+  const GLfloat kMaskRect[4] = {
+      origin_x + (mask_.x + mask_.width / 2) * scale,
+      origin_y + (mask_.y + mask_.height / 2) * scale,
+      mask_.width / 2 * scale,
+      mask_.height / 2 * scale};
+  const float kCornerRadius = std::min(
+      mask_.corner_radius, std::min(mask_.width, mask_.height) / 2);
+  mask_program_->Use();
+  glUniform4fv(glGetUniformLocation(kProgram, "maskRect"), 1, kMaskRect);
+  glUniform1f(glGetUniformLocation(kProgram, "cornerRadius"),
+              std::max(0.0f, kCornerRadius) * scale);
+  glUniform1f(glGetUniformLocation(kProgram, "dilation"), dilation);
+  glUniform1i(glGetUniformLocation(kProgram, "maskTextureEnabled"),
+              mask_.texture != 0 && dilation <= 0);
+  mask_program_->Render(mask_.texture);
+
+  // Following draws only cover the fragments with the stencil set.
+  glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+  glStencilFunc(GL_EQUAL, 1, 0xFF);
+  glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+  return true;
+}
+
+}  // namespace glfc
@@ -0,0 +1,284 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_SEPARABLE_CONVOLUTION_FILTER_H_
+#define GLFC_SEPARABLE_CONVOLUTION_FILTER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/filter.h"
+#include "glfc/opengl_hook.h"
+#include "glfc/yuv.h"
+
+namespace glfc {
+
+// Limits a `SeparableConvolutionFilter` to a region of its output. The
+// region is a rounded rectangle in points relative to the lower-left corner
+// of the output, optionally intersected with the pixels of an alpha texture
+// covering the whole output whose alpha is at least 0.5.
+struct ConvolutionMask {
+  ConvolutionMask()
+      : corner_radius(0), height(0), texture(0), width(0), x(0), y(0) {}
+
+  // The radius in points of the corners of the rectangle.
+  float corner_radius;
+
+  // The height in points of the rectangle.
+  float height;
+
+  // The alpha texture further limiting the rectangle, or 0 to use the
+  // rectangle alone. It's sampled with the coordinates of the input texture.
+  GLuint texture;
+
+  // The width in points of the rectangle.
+  float width;
+
+  // The horizontal position in points of the rectangle.
+  float x;
+
+  // The vertical position in points of the rectangle.
+  float y;
+};
+
+// This class applies a symmetric 1D kernel horizontally and then vertically.
+// The kernel is given by its center weight followed by the weights at
+// increasing distances in pixels, each applying to both sides.
+//
+// Adjacent taps with weights of the same sign are folded into a single
+// bilinear fetch, halving the number of texture reads. The coordinates of
+// the nearest folded taps are computed in the vertex shader and passed as
+// varyings, the rest are dependent reads in the fragment shader. The number
+// of varying taps is one less than the varying vectors of the context, i.e.
+// at least 7 on OpenGL ES 2 and 14 on OpenGL ES 3.
+//
+// The intermediate result is stored in an 8-bit framebuffer, so kernels with
+// negative weights such as sharpening have their horizontal result clamped
+// to [0, 1] before the vertical pass.
+//
+// Subclasses can customize the sampling of each pass and the output of the
+// vertical pass, e.g. to convolve a single channel, in which case the
+// horizontal pass of RGBA inputs gets a program of its own.
+//
+// Besides RGBA textures, the filter accepts planar YUV inputs. The conversion
+// to RGB is fused into the horizontal pass so no separate conversion pass and
+// intermediate texture are needed.
+//
+// When a mask is set, both passes are limited to the masked region with the
+// stencil test so the pixels outside are rejected before shading. The
+// horizontal pass covers the rounded rectangle of the mask grown by the
+// kernel radius, which the vertical pass reads from. The vertical pass covers
+// the exact mask. If the current framebuffer has a stencil buffer, the
+// vertical pass renders to it directly, overwriting its stencil values, and
+// the pixels outside the mask are left untouched. Otherwise it renders to an
+// intermediate framebuffer that is then drawn to the current framebuffer,
+// leaving the pixels outside the mask transparent. This pays off when the
+// mask is much smaller than the output.
+class SeparableConvolutionFilter : public Filter {
+ public:
+  SeparableConvolutionFilter();
+  ~SeparableConvolutionFilter();
+
+  // Returns a normalized box kernel averaging `radius` pixels on each side.
+  static std::vector<float> MakeBoxKernel(const int radius);
+
+  // Returns a sharpening kernel subtracting `amount` times each neighbor.
+  static std::vector<float> MakeSharpenKernel(const float amount);
+
+  // Returns a normalized tent kernel whose weights fall off linearly to zero
+  // beyond `radius` pixels.
+  static std::vector<float> MakeTentKernel(const int radius);
+
+  // Inherited from `Filter` class.
+  std::string GetFragmentShader() const final;
+
+  // Returns the kernel to apply at `device_pixel_ratio`. The default
+  // implementation returns `kernel()`. Subclasses deriving the kernel from
+  // their own parameters override this and call `InvalidateShaders()`
+  // whenever those parameters change. An empty kernel renders nothing.
+  virtual std::vector<float> GetKernel(const float device_pixel_ratio) const;
+
+  // Inherited from `Filter` class.
+  int GetKernelRadius(const float device_pixel_ratio) const override;
+
+  // Inherited from `Filter` class.
+  std::string GetVertexShader() const final;
+
+  // Returns `true` if the filter only applies `GetKernel()` to the RGBA
+  // input at full resolution followed by its color stages, which can be
+  // reproduced without OpenGL such as by `CpuRenderer`. Masks and subclasses
+  // customizing the passes make the filter not plain.
+  bool IsPlainConvolution() const;
+
+  using Filter::Render;
+
+  // Renders the filter with the planar YUV `input` to the framebuffer that is
+  // currently binded to OpenGL. The `width` and `height` are the dimension of
+  // the Y plane in points. When caching is enabled, the result is identified
+  // by the Y plane texture and the input generation, so the generation must
+  // change whenever any plane or conversion setting changes.
+  bool Render(const YuvInput& input, const float width, const float height,
+              const float device_pixel_ratio);
+
+  // Removes the mask so the filter covers the whole output again.
+  void ClearMask();
+
+  // Setters and accessors.
+  bool has_mask() const { return has_mask_; }
+  const std::vector<float>& kernel() const { return kernel_; }
+  void set_kernel(const std::vector<float>& kernel) {
+    if (kernel != kernel_) {
+      kernel_ = kernel;
+      InvalidateShaders();
+    }
+  }
+  const ConvolutionMask& mask() const { return mask_; }
+  void set_mask(const ConvolutionMask& mask);
+  float texel_spacing_multiplier() const { return texel_spacing_multiplier_; }
+  void set_texel_spacing_multiplier(const float texel_spacing_multiplier) {
+    if (texel_spacing_multiplier != texel_spacing_multiplier_) {
+      texel_spacing_multiplier_ = texel_spacing_multiplier;
+      InvalidateShaders();
+    }
+  }
+
+ protected:
+  // Returns the GLSL expression of the output of the vertical pass computed
+  // from the weighted sum of the samples in the `vec4 sum` variable. The
+  // default implementation returns the sum as is. The horizontal pass always
+  // outputs the sum.
+  virtual std::string GetOutputExpression() const;
+
+  // Returns the GLSL declarations preceding `main()` in the fragment shader of
+  // the given pass, which must define `sampleInput()` returning the input
+  // color at a texture coordinate along with the uniforms used by
+  // `GetOutputExpression()`. The default implementation samples the input
+  // texture as is. The horizontal pass of YUV inputs has its own sampling.
+  virtual std::string GetSamplingShader(const bool is_horizontal_pass) const;
+
+  // Regenerates the shaders and discards the cached result before the next
+  // render.
+  void InvalidateShaders() {
+    should_update_shaders_ = true;
+    InvalidateCache();
+  }
+
+  // Sets the uniforms declared by `GetSamplingShader()` for `program`, which
+  // is in use for the given pass. The `framebuffer` holds the intermediate
+  // result between the passes. Besides, the `vec2 inputOffset` uniform of the
+  // vertex shader, which is 0 unless set here, is subtracted from the
+  // texture coordinates sampled by the pass. The default implementation does
+  // nothing.
+  virtual void SetPassUniforms(Program* program,
+                               const Framebuffer& framebuffer,
+                               const bool is_horizontal_pass) const {}
+
+  // Inherited from `Filter` class.
+  FramebufferDescriptor GetFramebufferDescriptor() const override;
+
+  // Inherited from `Filter` class.
+  void set_device_pixel_ratio(const float ratio) final {
+    if (ratio != device_pixel_ratio()) {
+      Filter::set_device_pixel_ratio(ratio);
+      should_update_shaders_ = true;
+    }
+  }
+
+ private:
+  // Inherited from `Filter` class.
+  bool ApplyFilterToFramebuffer(const GLuint input_texture, Program* program,
+                                Framebuffer* framebuffer) final;
+
+  // Returns the fragment shader applying the kernel to the samples returned
+  // by the `sampleInput()` function defined in `sampling_shader` and writing
+  // `output_expression`.
+  std::string GenerateFragmentShader(
+      const std::string& sampling_shader,
+      const std::string& output_expression) const;
+
+  // Inherited from `Filter` class.
+  void SetUniforms(Program* program) const final;
+
+  // Inherited from `Filter` class.
+  bool ShouldUpdateShaders() const final;
+
+  // Writes the mask grown by `dilation` pixels to the cleared stencil buffer
+  // of the currently binded framebuffer, which has `scale` pixels per point,
+  // and enables the stencil test for it. The mask is placed relative to the
+  // pixel at `origin_x` and `origin_y`, the origin of the viewport. The
+  // texture of the mask is ignored when `dilation` is positive. Returns
+  // `false` on failure, in which case the stencil test is left disabled.
+  bool WriteMaskToStencil(const float scale, const float dilation,
+                          const int origin_x, const int origin_y);
+
+  // Indicates whether the filter is limited to `mask_`.
+  bool has_mask_;
+
+  // The program for the horizontal pass of RGBA inputs. It's only
+  // initialized when subclasses customize the shaders of the passes,
+  // otherwise both passes use the filter's program.
+  std::unique_ptr<Program> horizontal_program_;
+
+  // The kernel returned by the default `GetKernel()`. The default value is
+  // the identity kernel.
+  std::vector<float> kernel_;
+
+  // The region the filter is limited to when `has_mask_` is `true`.
+  ConvolutionMask mask_;
+
+  // The framebuffer holding the result of the vertical pass of masked
+  // renders to framebuffers without a stencil buffer. It's deleted when the
+  // mask is cleared or rendered directly.
+  std::unique_ptr<Framebuffer> mask_framebuffer_;
+
+  // The program writing the mask to stencil.
+  std::unique_ptr<Program> mask_program_;
+
+  // Indicates whether the shaders should update. This is initially `true` as
+  // no shader has been generated yet.
+  bool should_update_shaders_;
+
+  // Indicates the vertical offset of a single step used in the vertex shader.
+  float texel_height_offset_;
+
+  // A multiplier for the spacing between texels, ranging from 0.0 on up, with
+  // a default of 1.0. Adjusting this value may slightly increase the blur
+  // strength but will introduce artifacs in the result.
+  float texel_spacing_multiplier_;
+
+  // Indicates the horizontal offset of a single step used in the vertex shader.
+  float texel_width_offset_;
+
+  // The weak reference to the YUV input being rendered. This is only set
+  // during `Render()` calls with a YUV input.
+  const YuvInput* yuv_input_;
+
+  // The program for the horizontal pass of YUV inputs. It's finalized
+  // whenever the shaders should update.
+  std::unique_ptr<Program> yuv_program_;
+
+  // The format the `yuv_program_` was generated for.
+  YuvFormat yuv_program_format_;
+
+  GLFC_DISALLOW_COPY_AND_ASSIGN(SeparableConvolutionFilter);
+};
+
+}  // namespace glfc
+
+#endif  // GLFC_SEPARABLE_CONVOLUTION_FILTER_H_
@@ -0,0 +1,136 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/shadow_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "glfc/framebuffer.h"
+#include "glfc/opengl_hook.h"
+#include "glfc/program.h"
+
+namespace {
+
+// The largest spread, which keeps the alpha scale finite.
+const float kMaxSpread = 0.99f;
+
+}  // namespace
+
+namespace glfc {
+
+ShadowFilter::ShadowFilter()
+    : color_{0, 0, 0, 1}, downsample_factor_(1), offset_x_(0), offset_y_(0),
+      spread_(0) {
+}
+
+ShadowFilter::~ShadowFilter() {
+}
+
+FramebufferDescriptor ShadowFilter::GetFramebufferDescriptor() const {
+  FramebufferDescriptor descriptor = \
+      SeparableConvolutionFilter::GetFramebufferDescriptor();
+  descriptor.color_format = kFramebufferColorFormatR8;
+  return descriptor;
+}
+
+float ShadowFilter::GetFramebufferScale() const {
+  return 1.0f / downsample_factor_;
+}
+
+std::vector<float> ShadowFilter::GetKernel(
+    const float device_pixel_ratio) const {
+  return GaussianBlurFilter::GetKernel(device_pixel_ratio /
+                                       downsample_factor_);
+}
+
+int ShadowFilter::GetKernelRadius(const float device_pixel_ratio) const {
+  const float kOffset = std::max(std::abs(offset_x_), std::abs(offset_y_));
+  return SeparableConvolutionFilter::GetKernelRadius(device_pixel_ratio) + \
+         static_cast<int>(std::ceil(kOffset * device_pixel_ratio));
+}
+
+std::string ShadowFilter::GetOutputExpression() const {
+  return "shadowColor * clamp(sum.r * shadowAlphaScale, 0.0, 1.0)";
+}
+
+std::string ShadowFilter::GetSamplingShader(
+    const bool is_horizontal_pass) const {
+  // The horizontal pass reads the alpha of the input, the vertical pass reads
+  // the single channel of the intermediate.
+  if (is_horizontal_pass) {
+    return R"(
+#define sampleInput(coordinate) texture2D(inputImageTexture, coordinate).aaaa)";
+  }
+  return SeparableConvolutionFilter::GetSamplingShader(false) + R"(
+uniform vec4 shadowColor;
+uniform float shadowAlphaScale;)";
+}
+
+void ShadowFilter::SetPassUniforms(Program* program,
+                                   const Framebuffer& framebuffer,
+                                   const bool is_horizontal_pass) const {
+  const GLuint kProgram = program->program();
+  // The offset is applied while reading the input so the intermediate
+  // already holds the moved shadow.
+  if (is_horizontal_pass) {
+    const float kScale = device_pixel_ratio() / downsample_factor_;
+    glUniform2f(glGetUniformLocation(kProgram, "inputOffset"),
+                offset_x_ * kScale / framebuffer.width(),
+                offset_y_ * kScale / framebuffer.height());
+    return;
+  }
+  const GLfloat kPremultipliedColor[4] = {
+      color_[0] * color_[3], color_[1] * color_[3], color_[2] * color_[3],
+      color_[3]};
+  glUniform4fv(glGetUniformLocation(kProgram, "shadowColor"), 1,
+               kPremultipliedColor);
+  glUniform1f(glGetUniformLocation(kProgram, "shadowAlphaScale"),
+              1.0f / (1.0f - spread_));
+}
+
+void ShadowFilter::set_color(const float red, const float green,
+                             const float blue, const float alpha) {
+  color_[0] = red;
+  color_[1] = green;
+  color_[2] = blue;
+  color_[3] = alpha;
+  InvalidateCache();
+}
+
+void ShadowFilter::set_downsample_factor(const int downsample_factor) {
+  const int kDownsampleFactor = std::max(1, downsample_factor);
+  if (kDownsampleFactor != downsample_factor_) {
+    downsample_factor_ = kDownsampleFactor;
+    InvalidateShaders();
+  }
+}
+
+void ShadowFilter::set_offset(const float x, const float y) {
+  offset_x_ = x;
+  offset_y_ = y;
+  InvalidateCache();
+}
+
+void ShadowFilter::set_spread(const float spread) {
+  spread_ = std::min(std::max(spread, 0.0f), kMaxSpread);
+  InvalidateCache();
+}
+
+}  // namespace glfc
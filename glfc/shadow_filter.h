@@ -0,0 +1,113 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_SHADOW_FILTER_H_
+#define GLFC_SHADOW_FILTER_H_
+
+#include <string>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/framebuffer.h"
+#include "glfc/gaussian_blur_filter.h"
+
+namespace glfc {
+
+// This class renders the drop shadow or glow of the input's alpha channel,
+// i.e. the blurred alpha filled with a color, moved by an offset and
+// optionally spread. Only the shadow is rendered, the input itself is
+// expected to be drawn over it.
+//
+// Unlike `GaussianBlurFilter`, only the alpha channel is convolved. The
+// horizontal pass extracts it from the input into a single channel R8
+// intermediate on contexts with `GL_RED` textures, which takes a quarter of
+// the memory and bandwidth of RGBA8, and the vertical pass applies the
+// color and spread while writing the result. The intermediate can also have
+// a lower resolution than the output since shadows rarely have fine details.
+//
+// Changing the color, offset or spread doesn't regenerate the shaders.
+class ShadowFilter : public GaussianBlurFilter {
+ public:
+  ShadowFilter();
+  ~ShadowFilter();
+
+  // Inherited from `GaussianBlurFilter` class. The kernel is in texels of
+  // the intermediate.
+  std::vector<float> GetKernel(const float device_pixel_ratio) const override;
+
+  // Inherited from `Filter` class. The offset of the shadow is included.
+  int GetKernelRadius(const float device_pixel_ratio) const override;
+
+  // Sets the color of the shadow, which is not premultiplied by alpha. The
+  // default value is opaque black.
+  void set_color(const float red, const float green, const float blue,
+                 const float alpha);
+
+  // Sets the offset of the shadow in points along the coordinates of the
+  // input texture. The default value is 0.
+  void set_offset(const float x, const float y);
+
+  // Setters and accessors.
+  const float* color() const { return color_; }
+  int downsample_factor() const { return downsample_factor_; }
+  void set_downsample_factor(const int downsample_factor);
+  float offset_x() const { return offset_x_; }
+  float offset_y() const { return offset_y_; }
+  float spread() const { return spread_; }
+  void set_spread(const float spread);
+
+ private:
+  // Inherited from `SeparableConvolutionFilter` class.
+  FramebufferDescriptor GetFramebufferDescriptor() const override;
+
+  // Inherited from `Filter` class.
+  float GetFramebufferScale() const override;
+
+  // Inherited from `SeparableConvolutionFilter` class.
+  std::string GetOutputExpression() const override;
+
+  // Inherited from `SeparableConvolutionFilter` class.
+  std::string GetSamplingShader(const bool is_horizontal_pass) const override;
+
+  // Inherited from `SeparableConvolutionFilter` class.
+  void SetPassUniforms(Program* program, const Framebuffer& framebuffer,
+                       const bool is_horizontal_pass) const override;
+
+  // The RGBA color of the shadow, which is not premultiplied.
+  float color_[4];
+
+  // The factor by which the intermediate has a lower resolution than the
+  // output. The default value is 1.
+  int downsample_factor_;
+
+  // The horizontal offset in points of the shadow.
+  float offset_x_;
+
+  // The vertical offset in points of the shadow.
+  float offset_y_;
+
+  // The fraction of the blurred alpha range that is made opaque, ranging
+  // from 0 to 1 exclusively. Larger values grow the solid part of the shadow
+  // and harden its edges. The default value is 0.
+  float spread_;
+
+  GLFC_DISALLOW_COPY_AND_ASSIGN(ShadowFilter);
+};
+
+}  // namespace glfc
+
+#endif  // GLFC_SHADOW_FILTER_H_
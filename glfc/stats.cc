@@ -0,0 +1,112 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/stats.h"
+
+#include <cstddef>
+#include <memory>
+
+#include "glfc/context_state.h"
+
+namespace {
+
+// Returns the statistics of the context current on the calling thread, or
+// `nullptr` if no context is current.
+glfc::internal::ContextStats* GetContextStats() {
+  glfc::internal::ContextState* state = \
+      glfc::internal::GetCurrentContextState();
+  return state == nullptr ? nullptr : state->stats.get();
+}
+
+}  // namespace
+
+namespace glfc {
+
+Stats GetStats() {
+  const internal::ContextStats* context_stats = GetContextStats();
+  if (context_stats == nullptr)
+    return Stats();
+
+  Stats stats = context_stats->stats;
+  stats.framebuffer_bytes = context_stats->framebuffer_bytes.load();
+  stats.framebuffer_releases = context_stats->framebuffer_releases.load();
+  return stats;
+}
+
+void ResetStats() {
+  internal::ContextStats* context_stats = GetContextStats();
+  if (context_stats == nullptr)
+    return;
+
+  context_stats->framebuffer_releases = 0;
+  context_stats->stats = Stats();
+}
+
+namespace internal {
+
+ContextStats::ContextStats() : framebuffer_bytes(0), framebuffer_releases(0),
+                               stats() {
+}
+
+std::shared_ptr<ContextStats> CountFramebufferAllocation(const size_t bytes) {
+  ContextState* state = GetCurrentContextState();
+  if (state == nullptr)
+    return nullptr;
+
+  ++state->stats->stats.framebuffer_allocations;
+  state->stats->framebuffer_bytes += bytes;
+  return state->stats;
+}
+
+void CountFramebufferRelease(ContextStats* stats, const size_t bytes) {
+  if (stats == nullptr)
+    return;
+
+  ++stats->framebuffer_releases;
+  stats->framebuffer_bytes -= bytes;
+}
+
+void CountFramebufferResize() {
+  ContextStats* stats = GetContextStats();
+  if (stats != nullptr)
+    ++stats->stats.framebuffer_resizes;
+}
+
+void CountPass() {
+  ContextStats* stats = GetContextStats();
+  if (stats != nullptr)
+    ++stats->stats.passes;
+}
+
+void CountProgramCompile(const double milliseconds) {
+  ContextStats* stats = GetContextStats();
+  if (stats == nullptr)
+    return;
+
+  ++stats->stats.program_compiles;
+  stats->stats.program_compile_time += milliseconds;
+}
+
+void CountShaderRegeneration() {
+  ContextStats* stats = GetContextStats();
+  if (stats != nullptr)
+    ++stats->stats.shader_regenerations;
+}
+
+}  // namespace internal
+
+}  // namespace glfc
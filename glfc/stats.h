@@ -0,0 +1,123 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_STATS_H_
+#define GLFC_STATS_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace glfc {
+
+// The operational statistics of the OpenGL context current on the calling
+// thread. Like `GetCapabilities()`, the statistics are kept per context until
+// `ForgetCurrentContext()` is called, so they follow a context that moves
+// between threads. Counting is a plain increment of memory owned by the
+// context so it's always enabled. Nothing is counted while no context is
+// current.
+struct Stats {
+  // The number of framebuffers successfully initialized.
+  uint64_t framebuffer_allocations;
+
+  // The bytes held by the attachments of the live framebuffers initialized
+  // with the context, wherever they are released. Unlike the other members,
+  // this isn't cleared by `ResetStats()` since it reflects the current
+  // memory rather than past events.
+  size_t framebuffer_bytes;
+
+  // The number of initialized framebuffers finalized or destroyed.
+  uint64_t framebuffer_releases;
+
+  // The number of `Filter::Render()` calls that recreated the framebuffers
+  // of the filter because the dimension of the input changed. A call counts
+  // once even if the cache framebuffer is recreated as well.
+  uint64_t framebuffer_resizes;
+
+  // The number of quads drawn by `Program::Render()`, which includes every
+  // pass of the filters and every copy of a framebuffer.
+  uint64_t passes;
+
+  // The total time in milliseconds spent in `Program::Init()`, including
+  // shader translation, compilation and linking.
+  double program_compile_time;
+
+  // The number of `Program::Init()` calls that compiled shaders, whether
+  // they succeeded or not.
+  uint64_t program_compiles;
+
+  // The number of times a filter regenerated the shaders of an initialized
+  // program because its parameters or color stages changed.
+  uint64_t shader_regenerations;
+};
+
+// Returns the statistics of the context current on the calling thread, or
+// cleared statistics if no context is current.
+Stats GetStats();
+
+// Clears the statistics of the context current on the calling thread, except
+// for the bytes held by live framebuffers.
+void ResetStats();
+
+namespace internal {
+
+// The statistics of a single context. The framebuffer counters are atomic
+// since a framebuffer may be released while another context is current,
+// possibly on another thread, and after its own context was forgotten.
+struct ContextStats {
+  ContextStats();
+
+  // The value of `Stats::framebuffer_bytes`.
+  std::atomic<size_t> framebuffer_bytes;
+
+  // The value of `Stats::framebuffer_releases`.
+  std::atomic<uint64_t> framebuffer_releases;
+
+  // The remaining statistics, which are only counted with the context
+  // current. Its framebuffer counters are unused.
+  Stats stats;
+};
+
+// Counts a framebuffer initialized with `bytes` of attachments on the
+// current context. Returns the statistics it was counted against, which
+// must be passed to `CountFramebufferRelease()`, or `nullptr` if no context
+// is current.
+std::shared_ptr<ContextStats> CountFramebufferAllocation(const size_t bytes);
+
+// Counts a framebuffer with `bytes` of attachments being finalized against
+// the `stats` returned when it was initialized. Does nothing if `stats` is
+// `nullptr`.
+void CountFramebufferRelease(ContextStats* stats, const size_t bytes);
+
+// Counts a framebuffer recreated for a new input dimension.
+void CountFramebufferResize();
+
+// Counts a quad drawn by a program.
+void CountPass();
+
+// Counts a program compilation taking `milliseconds`.
+void CountProgramCompile(const double milliseconds);
+
+// Counts the shaders of a filter being regenerated.
+void CountShaderRegeneration();
+
+}  // namespace internal
+
+}  // namespace glfc
+
+#endif  // GLFC_STATS_H_
@@ -0,0 +1,241 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/texture_uploader.h"
+
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/capabilities.h"
+#include "glfc/gl_handle.h"
+#include "glfc/memory_usage.h"
+#include "glfc/opengl_hook.h"
+
+namespace {
+
+// The number of bytes of a `GL_RGBA` and `GL_UNSIGNED_BYTE` pixel.
+const int kBytesPerPixel = 4;
+
+}  // namespace
+
+namespace glfc {
+
+TextureUploader::TextureUploader(const int width, const int height)
+    : current_index_(-1), height_(height), is_initialized_(false),
+      is_mapped_(false), number_of_buffers_(2),
+      row_stride_(width * kBytesPerPixel), uses_pixel_buffers_(false),
+      width_(width) {
+}
+
+TextureUploader::TextureUploader(const int width, const int height,
+                                 const int number_of_buffers,
+                                 const size_t row_stride)
+    : current_index_(-1), height_(height), is_initialized_(false),
+      is_mapped_(false), number_of_buffers_(number_of_buffers),
+      row_stride_(row_stride > 0 ? row_stride : width * kBytesPerPixel),
+      uses_pixel_buffers_(false), width_(width) {
+}
+
+TextureUploader::~TextureUploader() {
+  if (is_initialized_)
+    Finalize();
+}
+
+bool TextureUploader::Init() {
+  if (is_initialized_)
+    Finalize();
+
+  if (number_of_buffers_ <= 0 || width_ <= 0 || height_ <= 0 ||
+      row_stride_ % kBytesPerPixel != 0 ||
+      row_stride_ < static_cast<size_t>(width_) * kBytesPerPixel) {
+#ifdef DEBUG
+    GLFC_LOG("!! Invalid texture uploader configuration.\n");
+#endif
+    return false;
+  }
+
+  // Creates the textures.
+  std::vector<GLuint> textures(number_of_buffers_);
+  glGenTextures(number_of_buffers_, textures.data());
+  for (const GLuint texture : textures) {
+    textures_.push_back(TextureHandle(texture));
+    glBindTexture(GL_TEXTURE_2D, texture);
+#ifdef GLFC_GL3_API
+    if (GetCapabilities().supports_immutable_textures) {
+      glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width_, height_);
+    } else {
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA,
+                   GL_UNSIGNED_BYTE, NULL);
+    }
+#else
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width_, height_, 0, GL_RGBA,
+                 GL_UNSIGNED_BYTE, NULL);
+#endif
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  internal::TrackTextureMemory(static_cast<std::ptrdiff_t>(
+      static_cast<size_t>(width_) * height_ * kBytesPerPixel *
+      number_of_buffers_));
+
+  // Creates the pixel buffer objects.
+#ifdef GLFC_GL3_API
+  uses_pixel_buffers_ = GetCapabilities().supports_pixel_buffer_objects;
+  if (uses_pixel_buffers_) {
+    GLint original_buffer;
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &original_buffer);
+    std::vector<GLuint> buffers(number_of_buffers_);
+    glGenBuffers(number_of_buffers_, buffers.data());
+    for (const GLuint buffer : buffers) {
+      buffers_.push_back(BufferHandle(buffer));
+      glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+      glBufferData(GL_PIXEL_UNPACK_BUFFER, buffer_size(), NULL,
+                   GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, original_buffer);
+    internal::TrackBufferMemory(
+        static_cast<std::ptrdiff_t>(buffer_size() * number_of_buffers_));
+  }
+#endif
+  if (!uses_pixel_buffers_)
+    client_buffer_.resize(buffer_size());
+  is_initialized_ = true;
+  return true;
+}
+
+void* TextureUploader::Map() {
+  if (!is_initialized_ || is_mapped_)
+    return nullptr;
+
+  void* pixels = nullptr;
+#ifdef GLFC_GL3_API
+  if (uses_pixel_buffers_) {
+    // Invalidating the buffer lets the driver hand out fresh memory instead
+    // of waiting for a pending transfer from the same buffer.
+    const int kIndex = (current_index_ + 1) % number_of_buffers_;
+    GLint original_buffer;
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &original_buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers_[kIndex].get());
+    pixels = glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER, 0, buffer_size(),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, original_buffer);
+  }
+#endif
+  if (!uses_pixel_buffers_)
+    pixels = client_buffer_.data();
+  is_mapped_ = pixels != nullptr;
+  return pixels;
+}
+
+bool TextureUploader::Commit() {
+  if (!is_mapped_)
+    return false;
+
+  const int kIndex = (current_index_ + 1) % number_of_buffers_;
+  glBindTexture(GL_TEXTURE_2D, textures_[kIndex].get());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, kBytesPerPixel);
+  GLboolean result = GL_TRUE;
+#ifdef GLFC_GL3_API
+  if (uses_pixel_buffers_) {
+    GLint original_buffer;
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &original_buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers_[kIndex].get());
+    result = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    if (result == GL_TRUE) {
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, row_stride_ / kBytesPerPixel);
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, GL_RGBA,
+                      GL_UNSIGNED_BYTE, reinterpret_cast<GLvoid*>(0));
+      glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, original_buffer);
+  }
+#endif
+  if (!uses_pixel_buffers_) {
+    // `GL_UNPACK_ROW_LENGTH` is not available, packs the rows in place
+    // first. Rows only move backwards so no row is overwritten before moved.
+    unsigned char* pixels = client_buffer_.data();
+    const size_t kPackedRowSize = \
+        static_cast<size_t>(width_) * kBytesPerPixel;
+    if (row_stride_ != kPackedRowSize) {
+      for (int row = 1; row < height_; ++row) {
+        std::memmove(pixels + kPackedRowSize * row,
+                     pixels + row_stride_ * row, kPackedRowSize);
+      }
+    }
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, GL_RGBA,
+                    GL_UNSIGNED_BYTE, pixels);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  is_mapped_ = false;
+
+  // A buffer whose contents got corrupted while mapped can't be used, the
+  // previous frame stays current in that case.
+  if (result != GL_TRUE)
+    return false;
+  current_index_ = kIndex;
+  return true;
+}
+
+bool TextureUploader::Upload(const void* pixels) {
+  void* buffer = Map();
+  if (buffer == nullptr)
+    return false;
+
+  std::memcpy(buffer, pixels, buffer_size());
+  return Commit();
+}
+
+GLuint TextureUploader::texture() const {
+  return current_index_ < 0 ? 0 : textures_[current_index_].get();
+}
+
+void TextureUploader::Finalize() {
+#ifdef GLFC_GL3_API
+  if (is_mapped_ && uses_pixel_buffers_) {
+    const int kIndex = (current_index_ + 1) % number_of_buffers_;
+    GLint original_buffer;
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &original_buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers_[kIndex].get());
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, original_buffer);
+  }
+  if (!buffers_.empty()) {
+    internal::TrackBufferMemory(
+        -static_cast<std::ptrdiff_t>(buffer_size() * number_of_buffers_));
+  }
+#endif
+  if (!textures_.empty()) {
+    internal::TrackTextureMemory(-static_cast<std::ptrdiff_t>(
+        static_cast<size_t>(width_) * height_ * kBytesPerPixel *
+        number_of_buffers_));
+  }
+  buffers_.clear();
+  client_buffer_.clear();
+  textures_.clear();
+  current_index_ = -1;
+  is_mapped_ = false;
+  is_initialized_ = false;
+  uses_pixel_buffers_ = false;
+}
+
+}  // namespace glfc
@@ -0,0 +1,129 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_TEXTURE_UPLOADER_H_
+#define GLFC_TEXTURE_UPLOADER_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/gl_handle.h"
+#include "glfc/opengl_hook.h"
+
+namespace glfc {
+
+// This class streams `GL_RGBA` frames from client memory into a ring of
+// reusable textures, which is typically used to feed decoded video frames to
+// filters. Each frame is written into the next pixel buffer object of a ring
+// and then copied to the next texture, so the driver can transfer frame N+1
+// while frame N is still being filtered.
+//
+// Frames can either be copied with `Upload()` or written in place between
+// `Map()` and `Commit()`, which saves a copy if the decoder can write to the
+// returned memory directly.
+//
+// Pixel buffer objects require OpenGL ES 3.0. On contexts without them the
+// frames are uploaded synchronously from client memory.
+class TextureUploader {
+ public:
+  // Creates a double-buffered uploader for tightly-packed frames.
+  TextureUploader(const int width, const int height);
+
+  // Creates an uploader using a ring of `number_of_buffers` buffers and
+  // textures. Each row of the uploaded frames occupies `row_stride` bytes,
+  // which must be a multiple of 4 and at least `width * 4`. Passing 0 to
+  // `row_stride` means tightly-packed rows.
+  TextureUploader(const int width, const int height,
+                  const int number_of_buffers, const size_t row_stride);
+  ~TextureUploader();
+
+  // Allocates the buffers and textures. Returns `false` on failure.
+  bool Init();
+
+  // Returns the memory where the next frame should be written, laid out with
+  // `row_stride()` bytes per row. `Commit()` must be called once the frame
+  // is written. Returns `nullptr` on failure.
+  void* Map();
+
+  // Uploads the frame written to the memory returned by `Map()` to the next
+  // texture, which becomes the one returned by `texture()`.
+  bool Commit();
+
+  // Uploads `pixels` to the next texture, which becomes the one returned by
+  // `texture()`. This is a shortcut for `Map()`, a copy and `Commit()`.
+  bool Upload(const void* pixels);
+
+  // Returns the texture holding the most recently committed frame. Returns 0
+  // if no frame has been committed.
+  GLuint texture() const;
+
+  // Accessors.
+  int height() const { return height_; }
+  size_t row_stride() const { return row_stride_; }
+  int width() const { return width_; }
+
+ private:
+  // Releases all buffers and textures.
+  void Finalize();
+
+  // Returns the number of bytes of a single frame.
+  size_t buffer_size() const { return row_stride_ * height_; }
+
+  // The pixel buffer objects.
+  std::vector<BufferHandle> buffers_;
+
+  // The client memory holding the mapped frame when pixel buffer objects are
+  // not supported.
+  std::vector<unsigned char> client_buffer_;
+
+  // The index of the most recently committed frame, or -1 if no frame has
+  // been committed yet.
+  int current_index_;
+
+  // The height of the frames.
+  const int height_;
+
+  // Indicates if the uploader has been initialized.
+  bool is_initialized_;
+
+  // Indicates whether the next buffer is currently mapped.
+  bool is_mapped_;
+
+  // The number of buffers and textures in the ring.
+  const int number_of_buffers_;
+
+  // The number of bytes per row.
+  const size_t row_stride_;
+
+  // The textures.
+  std::vector<TextureHandle> textures_;
+
+  // Indicates whether the frames are written to `buffers_` rather than
+  // `client_buffer_`. This is decided in `Init()` from the capabilities of
+  // the current context.
+  bool uses_pixel_buffers_;
+
+  // The width of the frames.
+  const int width_;
+
+  GLFC_DISALLOW_COPY_AND_ASSIGN(TextureUploader);
+};
+
+}  // namespace glfc
+
+#endif  // GLFC_TEXTURE_UPLOADER_H_
@@ -0,0 +1,222 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/tiled_renderer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <deque>
+#include <memory>
+
+#include "glfc/base.h"
+#include "glfc/filter.h"
+#include "glfc/framebuffer.h"
+#include "glfc/opengl_hook.h"
+#include "glfc/pixel_reader.h"
+#include "glfc/texture_uploader.h"
+#include "glfc/trace.h"
+
+namespace {
+
+// The number of bytes of a `GL_RGBA` and `GL_UNSIGNED_BYTE` pixel.
+const int kBytesPerPixel = 4;
+
+// A tile of the image. The interior is the region written to the output and
+// the window is the larger region uploaded and filtered.
+struct Tile {
+  int height;
+  int width;
+  int window_x;
+  int window_y;
+  int x;
+  int y;
+};
+
+// Writes the interior of `tile` from the oldest pending read of `reader` to
+// `output`. Returns `false` on failure.
+bool WriteTile(const Tile& tile, glfc::PixelReader* reader,
+               unsigned char* output, const size_t output_row_stride) {
+  const unsigned char* pixels = \
+      reinterpret_cast<const unsigned char*>(reader->Map(true));
+  if (pixels == nullptr)
+    return false;
+
+  const size_t kRowSize = static_cast<size_t>(tile.width) * kBytesPerPixel;
+  for (int row = 0; row < tile.height; ++row) {
+    const unsigned char* source = \
+        pixels + reader->row_stride() * (tile.y - tile.window_y + row) +
+        (tile.x - tile.window_x) * kBytesPerPixel;
+    std::memcpy(output + output_row_stride * (tile.y + row) +
+                    static_cast<size_t>(tile.x) * kBytesPerPixel,
+                source, kRowSize);
+  }
+  reader->Unmap();
+  return true;
+}
+
+}  // namespace
+
+namespace glfc {
+
+TiledRenderer::TiledRenderer(const int tile_size) : tile_size_(tile_size) {
+}
+
+TiledRenderer::~TiledRenderer() {
+}
+
+bool TiledRenderer::PrepareTileObjects(const int width, const int height) {
+  if (uploader_ && uploader_->width() == width &&
+      uploader_->height() == height) {
+    return true;
+  }
+
+  ReleaseTileObjects();
+  framebuffer_.reset(new Framebuffer(width, height));
+  reader_.reset(new PixelReader(width, height));
+  uploader_.reset(new TextureUploader(width, height));
+  if (!framebuffer_->Init() || !reader_->Init() || !uploader_->Init()) {
+    ReleaseTileObjects();
+#ifdef DEBUG
+    GLFC_LOG("!! Failed to initialize objects for tiled rendering.\n");
+#endif
+    return false;
+  }
+  return true;
+}
+
+void TiledRenderer::ReleaseTileObjects() {
+  framebuffer_.reset();
+  reader_.reset();
+  uploader_.reset();
+}
+
+bool TiledRenderer::Render(Filter* filter, const void* input, void* output,
+                           const int width, const int height,
+                           const size_t input_row_stride,
+                           const size_t output_row_stride) {
+  GLFC_TRACE_SCOPE("TiledRenderer::Render");
+  if (filter == nullptr || input == nullptr || output == nullptr ||
+      width <= 0 || height <= 0) {
+    return false;
+  }
+
+  const size_t kPackedRowSize = static_cast<size_t>(width) * kBytesPerPixel;
+  const size_t kInputRowStride = \
+      input_row_stride > 0 ? input_row_stride : kPackedRowSize;
+  const size_t kOutputRowStride = \
+      output_row_stride > 0 ? output_row_stride : kPackedRowSize;
+
+  // Determines the window size and the distance between tiles. A dimension
+  // fitting in a single window needs no halo.
+  GLint max_texture_size;
+  glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+  const int kTileSize = tile_size_ > 0 ? \
+                        std::min<int>(tile_size_, max_texture_size) : \
+                        max_texture_size;
+  const int kHalo = filter->GetKernelRadius(1);
+  const int kWindowWidth = std::min(kTileSize, width);
+  const int kWindowHeight = std::min(kTileSize, height);
+  const int kStepX = kWindowWidth == width ? width : kWindowWidth - 2 * kHalo;
+  const int kStepY = \
+      kWindowHeight == height ? height : kWindowHeight - 2 * kHalo;
+  if (kStepX <= 0 || kStepY <= 0) {
+#ifdef DEBUG
+    GLFC_LOG("!! Tile size is too small for the kernel radius.\n");
+#endif
+    return false;
+  }
+  if (!PrepareTileObjects(kWindowWidth, kWindowHeight))
+    return false;
+
+  const bool kCachingEnabled = filter->caching_enabled();
+  filter->set_caching_enabled(false);
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+
+  const unsigned char* input_pixels = \
+      reinterpret_cast<const unsigned char*>(input);
+  unsigned char* output_pixels = reinterpret_cast<unsigned char*>(output);
+  const size_t kWindowRowSize = \
+      static_cast<size_t>(kWindowWidth) * kBytesPerPixel;
+  std::deque<Tile> pending_tiles;
+  bool result = true;
+  for (int y = 0; result && y < height; y += kStepY) {
+    for (int x = 0; result && x < width; x += kStepX) {
+      Tile tile;
+      tile.x = x;
+      tile.y = y;
+      tile.width = std::min(kStepX, width - x);
+      tile.height = std::min(kStepY, height - y);
+      tile.window_x = std::max(0, std::min(x - kHalo, width - kWindowWidth));
+      tile.window_y = std::max(0, std::min(y - kHalo,
+                                           height - kWindowHeight));
+
+      // Writes the oldest tile before its read buffer is reused.
+      if (reader_->number_of_pending_reads() == 2) {
+        result = WriteTile(pending_tiles.front(), reader_.get(),
+                           output_pixels, kOutputRowStride);
+        pending_tiles.pop_front();
+        if (!result)
+          break;
+      }
+
+      // Uploads the window.
+      unsigned char* pixels = \
+          reinterpret_cast<unsigned char*>(uploader_->Map());
+      if (pixels == nullptr) {
+        result = false;
+        break;
+      }
+      const unsigned char* source = \
+          input_pixels + kInputRowStride * tile.window_y +
+          static_cast<size_t>(tile.window_x) * kBytesPerPixel;
+      for (int row = 0; row < kWindowHeight; ++row) {
+        std::memcpy(pixels + kWindowRowSize * row,
+                    source + kInputRowStride * row, kWindowRowSize);
+      }
+      result = uploader_->Commit();
+
+      // Filters the window and starts reading back the result.
+      if (result) {
+        framebuffer_->Bind();
+        framebuffer_->Clear();
+        result = filter->Render(uploader_->texture(), kWindowWidth,
+                                kWindowHeight, 1) && reader_->Read();
+        framebuffer_->Unbind();
+        if (result)
+          pending_tiles.push_back(tile);
+      }
+    }
+  }
+
+  // Writes the remaining tiles, or just releases their buffers on failure.
+  for (const Tile& tile : pending_tiles) {
+    if (result) {
+      result = WriteTile(tile, reader_.get(), output_pixels,
+                         kOutputRowStride);
+    } else if (reader_->Map(true) != nullptr) {
+      reader_->Unmap();
+    }
+  }
+
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+  filter->set_caching_enabled(kCachingEnabled);
+  return result;
+}
+
+}  // namespace glfc
@@ -0,0 +1,87 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_TILED_RENDERER_H_
+#define GLFC_TILED_RENDERER_H_
+
+#include <cstddef>
+#include <memory>
+
+#include "glfc/base.h"
+#include "glfc/opengl_hook.h"
+
+namespace glfc {
+
+class Filter;
+class Framebuffer;
+class PixelReader;
+class TextureUploader;
+
+// This class applies a filter to `GL_RGBA` images in client memory that may
+// exceed `GL_MAX_TEXTURE_SIZE`. The image is split into tiles that overlap by
+// the filter's kernel radius. Each tile is uploaded, filtered and read back
+// on its own, and only its interior is written to the output, so the result
+// is seamless. Tiles touching the image border are shifted inward so the
+// border is sampled with the same clamping as an untiled render.
+//
+// Uploads and readbacks are double-buffered so the transfer of one tile
+// overlaps the filtering of another, while the number of resident textures
+// stays bounded regardless of the image size.
+class TiledRenderer {
+ public:
+  // Creates a renderer whose tiles are at most `tile_size` pixels on each
+  // side, including the halo. Passing 0 uses `GL_MAX_TEXTURE_SIZE`.
+  explicit TiledRenderer(const int tile_size);
+  ~TiledRenderer();
+
+  // Applies `filter` to `input` and writes the result to `output`, both of
+  // `width` x `height` pixels with `input_row_stride` and `output_row_stride`
+  // bytes per row. Passing 0 to a stride means tightly-packed rows. Caching
+  // of `filter` is suspended during the call. Returns `false` on failure.
+  bool Render(Filter* filter, const void* input, void* output,
+              const int width, const int height,
+              const size_t input_row_stride, const size_t output_row_stride);
+
+  // Accessors.
+  int tile_size() const { return tile_size_; }
+
+ private:
+  // Prepares the objects for tiles of `width` x `height` pixels, reusing the
+  // existing ones if possible. Returns `false` on failure.
+  bool PrepareTileObjects(const int width, const int height);
+
+  // Releases the objects created by `PrepareTileObjects()`.
+  void ReleaseTileObjects();
+
+  // The framebuffer receiving the filtered tile.
+  std::unique_ptr<Framebuffer> framebuffer_;
+
+  // The reader of the filtered tiles.
+  std::unique_ptr<PixelReader> reader_;
+
+  // The maximum size of a tile including the halo.
+  const int tile_size_;
+
+  // The uploader of the input tiles.
+  std::unique_ptr<TextureUploader> uploader_;
+
+  GLFC_DISALLOW_COPY_AND_ASSIGN(TiledRenderer);
+};
+
+}  // namespace glfc
+
+#endif  // GLFC_TILED_RENDERER_H_
@@ -0,0 +1,1015 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+//
+// A command-line batch processor applying the Gaussian blur filter to raw
+// RGBA, PPM and PAM images headlessly. Inputs and outputs are memory-mapped
+// and the read, filter and write stages run on separate threads, while
+// uploads, filtering and readbacks overlap within the filter stage through
+// `TiledRenderer`. Images larger than the maximum texture size are tiled.
+//
+// The `--verify` mode instead checks the filter for regressions by
+// comparing its output on a synthetic image with a reference Gaussian blur
+// computed on the CPU, and its render times with a baseline file or with
+// limits relative to the fastest case, which hold across machines. The
+// `--benchmark-workers` mode measures the throughput of rendering synthetic
+// images with an increasing number of worker contexts.
+//
+// Usage: glfc_cli [options] -o <output directory> <input>...
+//        glfc_cli --verify [--baseline <path> [--update-baseline]]
+//                          [--limits <path>]
+//        glfc_cli --benchmark-workers <count> [options]
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "glfc/glfc.h"
+
+namespace {
+
+// The supported file formats.
+enum ImageFormat {
+  // Headerless RGBA pixels whose dimension is given by the `--size` option.
+  kImageFormatRaw,
+  // Binary portable pixmap (P6) with RGB pixels.
+  kImageFormatPpm,
+  // Portable arbitrary map (P7) with RGB or RGB_ALPHA tuples.
+  kImageFormatPam,
+};
+
+// A memory-mapped file.
+struct MappedFile {
+  MappedFile() : data(nullptr), size(0) {}
+
+  unsigned char* data;
+  size_t size;
+};
+
+// An image to process, from mapping the input to writing the output.
+struct Job {
+  Job() : channels(0), created_output(false), height(0),
+          input_pixels(nullptr), output_pixels(nullptr), succeeded(false),
+          width(0) {}
+
+  // The number of channels per pixel in both files, either 3 or 4.
+  int channels;
+  // Indicates whether this job created the output file, which is only
+  // removed on failure in that case.
+  bool created_output;
+  ImageFormat format;
+  int height;
+  MappedFile input;
+  // The RGBA pixels passed to the renderer. This either points into the
+  // mapped input or to `rgba_input` if the input needs conversion.
+  const unsigned char* input_pixels;
+  std::string input_path;
+  MappedFile output;
+  // The RGBA pixels written by the renderer. This either points into the
+  // mapped output or to `rgba_output` if the output needs conversion.
+  unsigned char* output_pixels;
+  std::string output_path;
+  std::vector<unsigned char> rgba_input;
+  std::vector<unsigned char> rgba_output;
+  bool succeeded;
+  int width;
+};
+
+// A minimal blocking queue connecting the pipeline stages.
+template <typename T>
+class BlockingQueue {
+ public:
+  void Push(T value) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      values_.push_back(std::move(value));
+    }
+    condition_.notify_one();
+  }
+
+  T Pop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this] { return !values_.empty(); });
+    T value = std::move(values_.front());
+    values_.pop_front();
+    return value;
+  }
+
+ private:
+  std::condition_variable condition_;
+  std::mutex mutex_;
+  std::deque<T> values_;
+};
+
+// Limits the number of images in flight so memory stays bounded.
+class Semaphore {
+ public:
+  explicit Semaphore(const int count) : count_(count) {}
+
+  void Acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    condition_.wait(lock, [this] { return count_ > 0; });
+    --count_;
+  }
+
+  void Release() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++count_;
+    }
+    condition_.notify_one();
+  }
+
+ private:
+  std::condition_variable condition_;
+  int count_;
+  std::mutex mutex_;
+};
+
+void PrintUsage() {
+  std::fprintf(stderr,
+      "Usage: glfc_cli [options] -o <output directory> <input>...\n"
+      "       glfc_cli --verify [--baseline <path> [--update-baseline]]\n"
+      "                         [--limits <path>]\n"
+      "       glfc_cli --benchmark-workers <count> [options]\n"
+      "\n"
+      "Applies the Gaussian blur filter to raw RGBA (.rgba), PPM (P6) and\n"
+      "PAM (P7) images, verifies the filter's quality and speed, or\n"
+      "measures the throughput for each number of workers up to <count>.\n"
+      "\n"
+      "Options:\n"
+      "  -o, --output <dir>     Directory receiving the filtered images.\n"
+      "  -r, --radius <points>  Blur radius. Defaults to 2.\n"
+      "  -s, --sigma <points>   Gaussian sigma. Defaults to 2.\n"
+      "  -e, --max-error <frac> Derives the radius from the sigma as the\n"
+      "                         smallest one dropping at most this fraction\n"
+      "                         of the Gaussian's weight, e.g. 0.001.\n"
+      "  -m, --spacing <value>  Texel spacing multiplier. Defaults to 1.\n"
+      "  -S, --stats            Prints the statistics of each worker.\n"
+      "  -t, --tile <pixels>    Maximum tile size. Defaults to\n"
+      "                         GL_MAX_TEXTURE_SIZE.\n"
+#ifdef GLFC_ENABLE_TRACING
+      "  -T, --trace <path>     Writes a Chrome trace with one frame per\n"
+      "                         image.\n"
+#endif
+      "  -W, --benchmark-workers <count>\n"
+      "                         Renders synthetic images with 1 to <count>\n"
+      "                         workers and prints the throughput of each.\n"
+      "  -b, --baseline <path>  With --verify, fails cases slower than the\n"
+      "                         render times in this file by over 50%%.\n"
+      "  -u, --update-baseline  With --verify, writes the render times to\n"
+      "                         the baseline file instead.\n"
+      "  -l, --limits <path>    With --verify, fails cases whose fastest\n"
+      "                         render time exceeds the one of the first\n"
+      "                         case by more than the ratios in this file.\n"
+      "  -v, --verify           Compares the filter output with a CPU\n"
+      "                         reference and exits with 1 on regressions.\n"
+      "  -w, --workers <count>  Number of GPU worker contexts. Defaults "
+      "to 1.\n"
+      "  -z, --size <WxH>       Dimension of raw RGBA inputs.\n");
+}
+
+// Maps the file at `path` for reading. Returns `false` on failure.
+bool MapInputFile(const std::string& path, MappedFile* file) {
+  const int kDescriptor = open(path.c_str(), O_RDONLY);
+  if (kDescriptor < 0)
+    return false;
+
+  struct stat status;
+  if (fstat(kDescriptor, &status) != 0 || status.st_size == 0) {
+    close(kDescriptor);
+    return false;
+  }
+  void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE,
+                    kDescriptor, 0);
+  close(kDescriptor);
+  if (data == MAP_FAILED)
+    return false;
+
+  // The pixels are read sequentially, asks the kernel to read ahead.
+  madvise(data, status.st_size, MADV_SEQUENTIAL | MADV_WILLNEED);
+  file->data = reinterpret_cast<unsigned char*>(data);
+  file->size = status.st_size;
+  return true;
+}
+
+// Creates the file at `path` with `size` bytes and maps it for writing.
+// Returns `false` on failure, in which case the file is removed again if it
+// was opened.
+bool MapOutputFile(const std::string& path, const size_t size,
+                   MappedFile* file) {
+  const int kDescriptor = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC,
+                               0644);
+  if (kDescriptor < 0)
+    return false;
+
+  if (ftruncate(kDescriptor, size) != 0) {
+    close(kDescriptor);
+    unlink(path.c_str());
+    return false;
+  }
+  void* data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    kDescriptor, 0);
+  close(kDescriptor);
+  if (data == MAP_FAILED) {
+    unlink(path.c_str());
+    return false;
+  }
+
+  file->data = reinterpret_cast<unsigned char*>(data);
+  file->size = size;
+  return true;
+}
+
+void UnmapFile(MappedFile* file) {
+  if (file->data != nullptr)
+    munmap(file->data, file->size);
+  file->data = nullptr;
+  file->size = 0;
+}
+
+// Returns the canonical absolute path of `path`, or an empty string if it
+// doesn't exist.
+std::string GetRealPath(const std::string& path) {
+  char* real_path = realpath(path.c_str(), nullptr);
+  if (real_path == nullptr)
+    return std::string();
+  const std::string kRealPath = real_path;
+  std::free(real_path);
+  return kRealPath;
+}
+
+// Reads the next whitespace-separated token of a PNM header starting at
+// `*offset`, skipping comments. Returns an empty string at the end of data.
+std::string ReadHeaderToken(const MappedFile& file, size_t* offset) {
+  std::string token;
+  while (*offset < file.size) {
+    const char kCharacter = file.data[*offset];
+    if (kCharacter == '#' && token.empty()) {
+      while (*offset < file.size && file.data[*offset] != '\n')
+        ++*offset;
+    } else if (std::isspace(static_cast<unsigned char>(kCharacter))) {
+      if (!token.empty())
+        break;
+      ++*offset;
+    } else {
+      token.push_back(kCharacter);
+      ++*offset;
+    }
+  }
+  return token;
+}
+
+// Parses the header of the mapped input of `job` and determines where its
+// pixels start. Returns the offset of the pixels, which is 0 for raw RGBA
+// files, or `std::string::npos` on failure.
+size_t ParseHeader(Job* job, const int raw_width, const int raw_height) {
+  const MappedFile& file = job->input;
+  const std::string& path = job->input_path;
+  if (path.size() > 5 && path.compare(path.size() - 5, 5, ".rgba") == 0) {
+    job->format = kImageFormatRaw;
+    job->width = raw_width;
+    job->height = raw_height;
+    job->channels = 4;
+    return raw_width > 0 && raw_height > 0 ? 0 : std::string::npos;
+  }
+
+  size_t offset = 0;
+  const std::string kMagic = ReadHeaderToken(file, &offset);
+  int max_value = 0;
+  if (kMagic == "P6") {
+    job->format = kImageFormatPpm;
+    job->channels = 3;
+    job->width = std::atoi(ReadHeaderToken(file, &offset).c_str());
+    job->height = std::atoi(ReadHeaderToken(file, &offset).c_str());
+    max_value = std::atoi(ReadHeaderToken(file, &offset).c_str());
+  } else if (kMagic == "P7") {
+    job->format = kImageFormatPam;
+    while (offset < file.size) {
+      const std::string kKey = ReadHeaderToken(file, &offset);
+      if (kKey == "ENDHDR" || kKey.empty())
+        break;
+      const std::string kValue = ReadHeaderToken(file, &offset);
+      if (kKey == "WIDTH")
+        job->width = std::atoi(kValue.c_str());
+      else if (kKey == "HEIGHT")
+        job->height = std::atoi(kValue.c_str());
+      else if (kKey == "DEPTH")
+        job->channels = std::atoi(kValue.c_str());
+      else if (kKey == "MAXVAL")
+        max_value = std::atoi(kValue.c_str());
+    }
+  } else {
+    return std::string::npos;
+  }
+  // A single whitespace character separates the header from the pixels.
+  ++offset;
+  if (max_value != 255 || job->width <= 0 || job->height <= 0 ||
+      (job->channels != 3 && job->channels != 4)) {
+    return std::string::npos;
+  }
+  return offset;
+}
+
+// Returns the header written to the output of `job`.
+std::string GetOutputHeader(const Job& job) {
+  char header[256];
+  if (job.format == kImageFormatPpm) {
+    std::snprintf(header, sizeof(header), "P6\n%d %d\n255\n", job.width,
+                  job.height);
+  } else if (job.format == kImageFormatPam) {
+    std::snprintf(header, sizeof(header),
+                  "P7\nWIDTH %d\nHEIGHT %d\nDEPTH %d\nMAXVAL 255\n"
+                  "TUPLTYPE %s\nENDHDR\n",
+                  job.width, job.height, job.channels,
+                  job.channels == 4 ? "RGB_ALPHA" : "RGB");
+  } else {
+    header[0] = '\0';
+  }
+  return header;
+}
+
+// Maps the input and output of `job`. RGBA files are filtered in place from
+// the input mapping to the output mapping, RGB files go through buffers.
+// Jobs whose output is their input fail as truncating the output would
+// destroy the mapped input.
+bool PrepareJob(Job* job, const int raw_width, const int raw_height) {
+  const std::string kRealInputPath = GetRealPath(job->input_path);
+  if (!kRealInputPath.empty() &&
+      kRealInputPath == GetRealPath(job->output_path)) {
+    std::fprintf(stderr, "%s would overwrite its input\n",
+                 job->output_path.c_str());
+    return false;
+  }
+  if (!MapInputFile(job->input_path, &job->input))
+    return false;
+
+  const size_t kOffset = ParseHeader(job, raw_width, raw_height);
+  const size_t kNumberOfPixels = \
+      static_cast<size_t>(job->width) * job->height;
+  if (kOffset == std::string::npos ||
+      kOffset + kNumberOfPixels * job->channels > job->input.size) {
+    return false;
+  }
+
+  const std::string kHeader = GetOutputHeader(*job);
+  const size_t kOutputSize = kHeader.size() + \
+                             kNumberOfPixels * job->channels;
+  if (!MapOutputFile(job->output_path, kOutputSize, &job->output))
+    return false;
+  job->created_output = true;
+  std::memcpy(job->output.data, kHeader.data(), kHeader.size());
+
+  if (job->channels == 4) {
+    job->input_pixels = job->input.data + kOffset;
+    job->output_pixels = job->output.data + kHeader.size();
+    return true;
+  }
+
+  // Expands RGB to RGBA with opaque alpha.
+  job->rgba_input.resize(kNumberOfPixels * 4);
+  job->rgba_output.resize(kNumberOfPixels * 4);
+  const unsigned char* source = job->input.data + kOffset;
+  for (size_t index = 0; index < kNumberOfPixels; ++index) {
+    std::memcpy(&job->rgba_input[index * 4], source + index * 3, 3);
+    job->rgba_input[index * 4 + 3] = 255;
+  }
+  job->input_pixels = job->rgba_input.data();
+  job->output_pixels = job->rgba_output.data();
+  return true;
+}
+
+// Writes the filtered pixels of `job` and releases its mappings. The output
+// of a failed job is removed if the job created it.
+void FinishJob(Job* job) {
+  if (job->succeeded && job->channels == 3) {
+    unsigned char* destination = \
+        job->output.data + GetOutputHeader(*job).size();
+    const size_t kNumberOfPixels = \
+        static_cast<size_t>(job->width) * job->height;
+    for (size_t index = 0; index < kNumberOfPixels; ++index)
+      std::memcpy(destination + index * 3, &job->rgba_output[index * 4], 3);
+  }
+  UnmapFile(&job->input);
+  UnmapFile(&job->output);
+  if (!job->succeeded && job->created_output)
+    unlink(job->output_path.c_str());
+}
+
+// A filter configuration rendered by `--verify`.
+struct VerificationCase {
+  // The name identifying the case in baseline and limit files.
+  const char* name;
+  // The blur radius in points, ignored if `max_truncation_error` is set.
+  float blur_radius;
+  float max_truncation_error;
+  float sigma;
+};
+
+// The grid of configurations rendered by `--verify`, covering small and
+// large sigmas with both ways of choosing the kernel radius. The first case
+// is the cheapest one and serves as the reference of the relative limits.
+const VerificationCase kVerificationCases[] = {
+    {"sigma1-radius3", 3, 0, 1},
+    {"sigma2-radius6", 6, 0, 2},
+    {"sigma4-radius12", 12, 0, 4},
+    {"sigma8-radius24", 24, 0, 8},
+    {"sigma1-error0.001", 0, 0.001f, 1},
+    {"sigma2-error0.001", 0, 0.001f, 2},
+    {"sigma4-error0.001", 0, 0.001f, 4},
+    {"sigma8-error0.001", 0, 0.001f, 8}};
+
+// The width and height in pixels of the image rendered by `--verify`.
+const int kVerificationImageSize = 256;
+
+// The minimum PSNR in dB of the filter output against the reference. The
+// output differs from the reference by the 8-bit intermediate, the
+// truncated kernel and the interpolation of folded taps.
+const double kMinPsnr = 48;
+
+// The maximum difference of any channel against the reference.
+const int kMaxError = 4;
+
+// The number of timed renders of each case, whose median is reported.
+const int kNumberOfTimedRenders = 5;
+
+// The fraction by which a case may be slower than its baseline.
+const double kTimingTolerance = 0.5;
+
+// Returns a deterministic opaque RGBA image of `size` x `size` pixels made
+// of gradients, ripples and mild noise, which has the content of typical
+// blur inputs without the hard edges whose results depend on the texture
+// coordinate precision of the GPU.
+std::vector<unsigned char> GenerateVerificationImage(const int size) {
+  std::vector<unsigned char> pixels(static_cast<size_t>(size) * size * 4);
+  unsigned seed = 1;
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      unsigned char* pixel = &pixels[(static_cast<size_t>(y) * size + x) * 4];
+      for (int channel = 0; channel < 3; ++channel) {
+        seed = seed * 1103515245 + 12345;
+        const double kRipple = std::sin((x * (channel + 1) + y * 2) * 0.15);
+        const double kValue = \
+            64 + 64.0 * x / size + 64.0 * y / size + 48 * kRipple +
+            static_cast<int>((seed >> 16) % 17) - 8;
+        pixel[channel] = static_cast<unsigned char>(
+            std::min(std::max(kValue, 0.0), 255.0));
+      }
+      pixel[3] = 255;
+    }
+  }
+  return pixels;
+}
+
+// Blurs `input` of `size` x `size` RGBA pixels with a Gaussian of `sigma`
+// in pixels, truncated where the weights become negligible, in double
+// precision. Reads beyond the border are clamped like the GPU path.
+std::vector<unsigned char> RenderReferenceBlur(
+    const std::vector<unsigned char>& input, const int size,
+    const double sigma) {
+  const int kRadius = static_cast<int>(std::ceil(sigma * 4));
+  std::vector<double> kernel(kRadius * 2 + 1);
+  double sum_of_weights = 0;
+  for (int offset = -kRadius; offset <= kRadius; ++offset) {
+    kernel[offset + kRadius] = std::exp(-offset * offset /
+                                        (2 * sigma * sigma));
+    sum_of_weights += kernel[offset + kRadius];
+  }
+  for (double& weight : kernel)
+    weight /= sum_of_weights;
+
+  std::vector<double> horizontal(input.size());
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      for (int channel = 0; channel < 4; ++channel) {
+        double sum = 0;
+        for (int offset = -kRadius; offset <= kRadius; ++offset) {
+          const int kX = std::min(std::max(x + offset, 0), size - 1);
+          sum += input[(y * size + kX) * 4 + channel] * \
+                 kernel[offset + kRadius];
+        }
+        horizontal[(y * size + x) * 4 + channel] = sum;
+      }
+    }
+  }
+  std::vector<unsigned char> output(input.size());
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) {
+      for (int channel = 0; channel < 4; ++channel) {
+        double sum = 0;
+        for (int offset = -kRadius; offset <= kRadius; ++offset) {
+          const int kY = std::min(std::max(y + offset, 0), size - 1);
+          sum += horizontal[(kY * size + x) * 4 + channel] * \
+                 kernel[offset + kRadius];
+        }
+        output[(y * size + x) * 4 + channel] = static_cast<unsigned char>(
+            std::min(std::max(std::round(sum), 0.0), 255.0));
+      }
+    }
+  }
+  return output;
+}
+
+// Returns the PSNR in dB of `output` against `reference` and stores the
+// maximum difference of any channel in `max_error`.
+double ComparePixels(const std::vector<unsigned char>& output,
+                     const std::vector<unsigned char>& reference,
+                     int* max_error) {
+  double squared_error = 0;
+  *max_error = 0;
+  for (size_t index = 0; index < output.size(); ++index) {
+    const int kError = std::abs(output[index] - reference[index]);
+    *max_error = std::max(*max_error, kError);
+    squared_error += kError * kError;
+  }
+  if (squared_error == 0)
+    return std::numeric_limits<double>::infinity();
+  const double kMeanSquaredError = squared_error / output.size();
+  return 10 * std::log10(255.0 * 255.0 / kMeanSquaredError);
+}
+
+// Reads the timings in milliseconds keyed by case name from the baseline
+// file at `path`, which has one "<name> <milliseconds>" line per case.
+// Limit files share the format with ratios in place of the timings.
+// Returns an empty map if the file doesn't exist.
+std::map<std::string, double> ReadBaseline(const std::string& path) {
+  std::map<std::string, double> baseline;
+  FILE* file = std::fopen(path.c_str(), "r");
+  if (file == nullptr)
+    return baseline;
+  char name[128];
+  double milliseconds;
+  while (std::fscanf(file, "%127s %lf", name, &milliseconds) == 2)
+    baseline[name] = milliseconds;
+  std::fclose(file);
+  return baseline;
+}
+
+// Writes `baseline` to the file at `path` in the format read by
+// `ReadBaseline()`. Returns `false` on failure.
+bool WriteBaseline(const std::string& path,
+                   const std::map<std::string, double>& baseline) {
+  FILE* file = std::fopen(path.c_str(), "w");
+  if (file == nullptr)
+    return false;
+  for (const auto& entry : baseline)
+    std::fprintf(file, "%s %.3f\n", entry.first.c_str(), entry.second);
+  return std::fclose(file) == 0;
+}
+
+// Renders `kVerificationCases` with `GaussianBlurFilter` on the current
+// context and compares the results with `RenderReferenceBlur()`. If
+// `baseline_path` is set, the median render times are compared with the
+// ones in the file, or written to it if `should_update_baseline` is `true`.
+// If `limits_path` is set, the ratio of the fastest render time of each case
+// to the one of the first case must not exceed the limit of the case in the
+// file. The fastest times are compared since interference from other
+// processes only slows renders down. Every limit fails if the first case
+// fails to render.
+// Returns `false` if any case fails a quality or timing threshold.
+bool Verify(const std::string& baseline_path,
+            const bool should_update_baseline,
+            const std::string& limits_path) {
+  const int kSize = kVerificationImageSize;
+  const std::vector<unsigned char> kInput = GenerateVerificationImage(kSize);
+  std::map<std::string, double> baseline;
+  if (!baseline_path.empty() && !should_update_baseline)
+    baseline = ReadBaseline(baseline_path);
+  std::map<std::string, double> limits;
+  if (!limits_path.empty()) {
+    limits = ReadBaseline(limits_path);
+    if (limits.empty()) {
+      std::fprintf(stderr, "Failed to read limits from %s\n",
+                   limits_path.c_str());
+      return false;
+    }
+  }
+
+  bool passed = true;
+  // The fastest render time of the first case, stays 0 if it fails.
+  double reference_time = 0;
+  std::vector<unsigned char> output(kInput.size());
+  for (const VerificationCase& kCase : kVerificationCases) {
+    const bool kIsReferenceCase = &kCase == kVerificationCases;
+    glfc::GaussianBlurFilter filter;
+    filter.set_blur_radius(kCase.blur_radius);
+    filter.set_max_truncation_error(kCase.max_truncation_error);
+    filter.set_sigma(kCase.sigma);
+    glfc::TiledRenderer renderer(0);
+
+    // The first render compiles the shaders and allocates the framebuffers
+    // so it's only used for the quality check.
+    if (!renderer.Render(&filter, kInput.data(), output.data(), kSize, kSize,
+                         0, 0)) {
+      std::printf("%-20s FAILED to render\n", kCase.name);
+      passed = false;
+      continue;
+    }
+    int max_error;
+    const double kPsnr = ComparePixels(
+        output, RenderReferenceBlur(kInput, kSize, kCase.sigma), &max_error);
+    const bool kIsQualityPassed = kPsnr >= kMinPsnr && max_error <= kMaxError;
+
+    std::vector<double> times(kNumberOfTimedRenders);
+    bool is_rendered = true;
+    for (double& time : times) {
+      const std::chrono::steady_clock::time_point kStartTime = \
+          std::chrono::steady_clock::now();
+      if (!renderer.Render(&filter, kInput.data(), output.data(), kSize,
+                           kSize, 0, 0)) {
+        is_rendered = false;
+        break;
+      }
+      time = std::chrono::duration<double, std::milli>(
+          std::chrono::steady_clock::now() - kStartTime).count();
+    }
+    if (!is_rendered) {
+      std::printf("%-20s FAILED to render\n", kCase.name);
+      passed = false;
+      continue;
+    }
+    std::sort(times.begin(), times.end());
+    const double kTime = times[times.size() / 2];
+    bool is_timing_passed = true;
+    auto iterator = baseline.find(kCase.name);
+    if (should_update_baseline) {
+      baseline[kCase.name] = kTime;
+    } else if (iterator != baseline.end()) {
+      is_timing_passed = kTime <= iterator->second * (1 + kTimingTolerance);
+    }
+    if (kIsReferenceCase)
+      reference_time = times.front();
+    const double kRatio = \
+        reference_time > 0 ? times.front() / reference_time : 0;
+    auto limit_iterator = limits.find(kCase.name);
+    const bool kIsThroughputPassed = \
+        limit_iterator == limits.end() ||
+        (reference_time > 0 && kRatio <= limit_iterator->second);
+
+    std::printf("%-20s PSNR %6.2f dB, max error %d, %.2f ms", kCase.name,
+                kPsnr, max_error, kTime);
+    if (iterator != baseline.end() && !should_update_baseline)
+      std::printf(" (baseline %.2f ms)", iterator->second);
+    if (limit_iterator != limits.end() && reference_time > 0) {
+      std::printf(" (ratio %.2f, limit %.2f)", kRatio,
+                  limit_iterator->second);
+    } else if (limit_iterator != limits.end()) {
+      std::printf(" (no reference time, limit %.2f)",
+                  limit_iterator->second);
+    }
+    std::printf("%s%s%s\n", kIsQualityPassed ? "" : " QUALITY REGRESSION",
+                is_timing_passed ? "" : " TIMING REGRESSION",
+                kIsThroughputPassed ? "" : " THROUGHPUT REGRESSION");
+    passed = passed && kIsQualityPassed && is_timing_passed &&
+             kIsThroughputPassed;
+  }
+
+  if (should_update_baseline && !WriteBaseline(baseline_path, baseline)) {
+    std::fprintf(stderr, "Failed to write baseline to %s\n",
+                 baseline_path.c_str());
+    return false;
+  }
+  return passed;
+}
+
+// The width and height in pixels of the images rendered by
+// `--benchmark-workers`.
+const int kBenchmarkImageSize = 1024;
+
+// The number of images rendered for each number of workers by
+// `--benchmark-workers`.
+const int kNumberOfBenchmarkImages = 48;
+
+// Renders `kNumberOfBenchmarkImages` synthetic images with `ContextGroup`
+// of 1 to `max_workers` workers on `display` and prints the throughput of
+// each number of workers. The filter and the renderers are configured like
+// the batch mode. Returns `false` if any group fails to initialize or any
+// render fails.
+bool BenchmarkWorkers(EGLDisplay display, const int max_workers,
+                      const float blur_radius, const float sigma,
+                      const float max_truncation_error,
+                      const float texel_spacing_multiplier,
+                      const int tile_size) {
+  const int kSize = kBenchmarkImageSize;
+  const std::vector<unsigned char> kInput = GenerateVerificationImage(kSize);
+  double single_worker_throughput = 0;
+  for (int number_of_workers = 1; number_of_workers <= max_workers;
+       ++number_of_workers) {
+    glfc::ContextGroup context_group(display, EGL_NO_CONTEXT,
+                                     number_of_workers);
+    if (!context_group.Init()) {
+      std::fprintf(stderr, "Failed to create %d OpenGL ES contexts.\n",
+                   number_of_workers);
+      return false;
+    }
+
+    // Each worker keeps its own filter, renderer and output. The first
+    // render compiles the shaders and allocates the framebuffers so it's
+    // excluded from the measurement.
+    std::vector<std::unique_ptr<glfc::GaussianBlurFilter>> filters(
+        number_of_workers);
+    std::vector<std::unique_ptr<glfc::TiledRenderer>> renderers(
+        number_of_workers);
+    std::vector<std::vector<unsigned char>> outputs(
+        number_of_workers, std::vector<unsigned char>(kInput.size()));
+    std::atomic<int> number_of_failures(0);
+    auto render = [&](const int worker_index) {
+      if (!renderers[worker_index]->Render(
+              filters[worker_index].get(), kInput.data(),
+              outputs[worker_index].data(), kSize, kSize, 0, 0)) {
+        ++number_of_failures;
+      }
+    };
+    context_group.RunOnEachWorker([&](const int worker_index) {
+      glfc::GaussianBlurFilter* filter = new glfc::GaussianBlurFilter;
+      filter->set_blur_radius(blur_radius);
+      filter->set_sigma(sigma);
+      filter->set_max_truncation_error(max_truncation_error);
+      filter->set_texel_spacing_multiplier(texel_spacing_multiplier);
+      filters[worker_index].reset(filter);
+      renderers[worker_index].reset(new glfc::TiledRenderer(tile_size));
+      render(worker_index);
+    });
+    context_group.Wait();
+
+    const std::chrono::steady_clock::time_point kStartTime = \
+        std::chrono::steady_clock::now();
+    for (int index = 0; index < kNumberOfBenchmarkImages; ++index)
+      context_group.Submit(render);
+    context_group.Wait();
+    const double kSeconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - kStartTime).count();
+
+    context_group.RunOnEachWorker([&](const int worker_index) {
+      renderers[worker_index].reset();
+      filters[worker_index].reset();
+    });
+    context_group.Wait();
+    if (number_of_failures > 0) {
+      std::fprintf(stderr, "%d renders failed with %d workers.\n",
+                   number_of_failures.load(), number_of_workers);
+      return false;
+    }
+
+    const double kThroughput = kNumberOfBenchmarkImages / kSeconds;
+    if (number_of_workers == 1)
+      single_worker_throughput = kThroughput;
+    std::printf("%2d workers: %7.2f images/s, %6.2f MB/s, %.2fx\n",
+                number_of_workers, kThroughput,
+                kThroughput * kInput.size() / (1024 * 1024),
+                kThroughput / single_worker_throughput);
+  }
+  return true;
+}
+
+// Returns a display that works without a window system if possible.
+EGLDisplay GetHeadlessDisplay() {
+  PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display = \
+      reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+          eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  if (get_platform_display != nullptr) {
+    EGLDisplay display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                              EGL_DEFAULT_DISPLAY, nullptr);
+    if (display != EGL_NO_DISPLAY)
+      return display;
+  }
+  return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const option kOptions[] = {
+      {"output", required_argument, nullptr, 'o'},
+      {"radius", required_argument, nullptr, 'r'},
+      {"sigma", required_argument, nullptr, 's'},
+      {"max-error", required_argument, nullptr, 'e'},
+      {"spacing", required_argument, nullptr, 'm'},
+      {"stats", no_argument, nullptr, 'S'},
+      {"tile", required_argument, nullptr, 't'},
+      {"trace", required_argument, nullptr, 'T'},
+      {"benchmark-workers", required_argument, nullptr, 'W'},
+      {"baseline", required_argument, nullptr, 'b'},
+      {"update-baseline", no_argument, nullptr, 'u'},
+      {"limits", required_argument, nullptr, 'l'},
+      {"verify", no_argument, nullptr, 'v'},
+      {"workers", required_argument, nullptr, 'w'},
+      {"size", required_argument, nullptr, 'z'},
+      {nullptr, 0, nullptr, 0}};
+  std::string baseline_path;
+  std::string limits_path;
+  std::string output_directory;
+  std::string trace_path;
+  float blur_radius = 2;
+  float sigma = 2;
+  float max_truncation_error = 0;
+  float texel_spacing_multiplier = 1;
+  int tile_size = 0;
+  int number_of_benchmarked_workers = 0;
+  int number_of_workers = 1;
+  int raw_width = 0;
+  int raw_height = 0;
+  bool should_print_stats = false;
+  bool should_update_baseline = false;
+  bool should_verify = false;
+  int option;
+  while ((option = getopt_long(argc, argv, "o:r:s:e:m:St:T:W:b:ul:vw:z:",
+                               kOptions, nullptr)) != -1) {
+    switch (option) {
+      case 'o': output_directory = optarg; break;
+      case 'r': blur_radius = std::atof(optarg); break;
+      case 's': sigma = std::atof(optarg); break;
+      case 'e': max_truncation_error = std::atof(optarg); break;
+      case 'm': texel_spacing_multiplier = std::atof(optarg); break;
+      case 'S': should_print_stats = true; break;
+      case 't': tile_size = std::atoi(optarg); break;
+      case 'T': trace_path = optarg; break;
+      case 'W': number_of_benchmarked_workers = std::atoi(optarg); break;
+      case 'b': baseline_path = optarg; break;
+      case 'u': should_update_baseline = true; break;
+      case 'l': limits_path = optarg; break;
+      case 'v': should_verify = true; break;
+      case 'w': number_of_workers = std::atoi(optarg); break;
+      case 'z': std::sscanf(optarg, "%dx%d", &raw_width, &raw_height); break;
+      default:
+        PrintUsage();
+        return 1;
+    }
+  }
+  const bool kIsBenchmarking = !should_verify &&
+                               number_of_benchmarked_workers > 0;
+  const bool kHasValidArguments = should_verify ? \
+      !should_update_baseline || !baseline_path.empty() :
+      kIsBenchmarking ||
+      (!output_directory.empty() && optind < argc && number_of_workers > 0);
+  if (!kHasValidArguments) {
+    PrintUsage();
+    return 1;
+  }
+  if (should_verify)
+    number_of_workers = 1;
+
+  EGLDisplay display = GetHeadlessDisplay();
+  if (!eglInitialize(display, nullptr, nullptr) ||
+      !eglBindAPI(EGL_OPENGL_ES_API)) {
+    std::fprintf(stderr, "Failed to initialize EGL.\n");
+    return 1;
+  }
+  if (kIsBenchmarking) {
+    return BenchmarkWorkers(display, number_of_benchmarked_workers,
+                            blur_radius, sigma, max_truncation_error,
+                            texel_spacing_multiplier, tile_size) ? 0 : 1;
+  }
+  glfc::ContextGroup context_group(display, EGL_NO_CONTEXT,
+                                   number_of_workers);
+  if (!context_group.Init()) {
+    std::fprintf(stderr, "Failed to create OpenGL ES contexts.\n");
+    return 1;
+  }
+
+  if (should_verify) {
+    bool passed = false;
+    context_group.RunOnEachWorker([&](const int worker_index) {
+      passed = Verify(baseline_path, should_update_baseline, limits_path);
+    });
+    context_group.Wait();
+    return passed ? 0 : 1;
+  }
+
+  // Each worker keeps its own filter and renderer.
+  std::vector<std::unique_ptr<glfc::GaussianBlurFilter>> filters(
+      number_of_workers);
+  std::vector<std::unique_ptr<glfc::TiledRenderer>> renderers(
+      number_of_workers);
+  context_group.RunOnEachWorker([&](const int worker_index) {
+    glfc::GaussianBlurFilter* filter = new glfc::GaussianBlurFilter;
+    filter->set_blur_radius(blur_radius);
+    filter->set_sigma(sigma);
+    filter->set_max_truncation_error(max_truncation_error);
+    filter->set_texel_spacing_multiplier(texel_spacing_multiplier);
+    filters[worker_index].reset(filter);
+    renderers[worker_index].reset(new glfc::TiledRenderer(tile_size));
+  });
+  context_group.Wait();
+
+  // The writer stage runs on its own thread. A null job stops it.
+  BlockingQueue<Job*> finished_jobs;
+  Semaphore in_flight_jobs(number_of_workers * 2);
+  int number_of_failures = 0;
+  size_t number_of_bytes = 0;
+  std::thread writer([&] {
+    while (Job* job = finished_jobs.Pop()) {
+      FinishJob(job);
+      if (job->succeeded) {
+        number_of_bytes += static_cast<size_t>(job->width) * job->height * \
+                           job->channels;
+      } else {
+        std::fprintf(stderr, "Failed to process %s\n",
+                     job->input_path.c_str());
+        ++number_of_failures;
+      }
+      delete job;
+      in_flight_jobs.Release();
+    }
+  });
+
+  // The reader stage runs on this thread and feeds the workers.
+  const std::chrono::steady_clock::time_point kStartTime = \
+      std::chrono::steady_clock::now();
+  const int kNumberOfImages = argc - optind;
+  for (int index = optind; index < argc; ++index) {
+    in_flight_jobs.Acquire();
+    Job* job = new Job;
+    job->input_path = argv[index];
+    const size_t kSlash = job->input_path.find_last_of('/');
+    job->output_path = output_directory + "/" + job->input_path.substr(
+        kSlash == std::string::npos ? 0 : kSlash + 1);
+    if (!PrepareJob(job, raw_width, raw_height)) {
+      finished_jobs.Push(job);
+      continue;
+    }
+    context_group.Submit([&, job](const int worker_index) {
+      job->succeeded = renderers[worker_index]->Render(
+          filters[worker_index].get(), job->input_pixels, job->output_pixels,
+          job->width, job->height, 0, 0);
+#ifdef GLFC_ENABLE_TRACING
+      glfc::EndTraceFrame();
+#endif
+      finished_jobs.Push(job);
+    });
+  }
+  context_group.Wait();
+  finished_jobs.Push(nullptr);
+  writer.join();
+  const double kSeconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - kStartTime).count();
+
+  // The statistics are taken after releasing the resources of the workers
+  // so the framebuffers are balanced.
+  std::vector<glfc::Stats> stats(number_of_workers);
+  context_group.RunOnEachWorker([&](const int worker_index) {
+    renderers[worker_index].reset();
+    filters[worker_index].reset();
+    stats[worker_index] = glfc::GetStats();
+  });
+  context_group.Wait();
+
+#ifdef GLFC_ENABLE_TRACING
+  if (!trace_path.empty() && !glfc::WriteChromeTrace(trace_path))
+    std::fprintf(stderr, "Failed to write trace to %s\n", trace_path.c_str());
+#endif
+
+  const int kNumberOfProcessedImages = kNumberOfImages - number_of_failures;
+  std::printf("Processed %d of %d images in %.3f s: %.2f images/s, "
+              "%.2f MB/s\n", kNumberOfProcessedImages, kNumberOfImages,
+              kSeconds, kNumberOfProcessedImages / kSeconds,
+              number_of_bytes / kSeconds / (1024 * 1024));
+  for (int index = 0; should_print_stats && index < number_of_workers;
+       ++index) {
+    const glfc::Stats& kStats = stats[index];
+    std::printf("Worker %d: %" PRIu64 " passes, %" PRIu64 " programs "
+                "compiled in %.1f ms, %" PRIu64 " shader regenerations, "
+                "%" PRIu64 " framebuffers allocated, %" PRIu64 " released, "
+                "%" PRIu64 " resized\n", index, kStats.passes,
+                kStats.program_compiles, kStats.program_compile_time,
+                kStats.shader_regenerations, kStats.framebuffer_allocations,
+                kStats.framebuffer_releases, kStats.framebuffer_resizes);
+  }
+  return number_of_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+//
+// Measures the CPU cost of glfc itself against the null OpenGL backend,
+// where OpenGL calls cost almost nothing. Each benchmark reports the time
+// per call and checks the exact OpenGL calls made by a single call, so
+// redundant state queries or uniform lookups sneaking into the hot paths
+// fail the run. The timings are only reported since they depend on the
+// machine.
+//
+// Usage: glfc_null_gl_benchmark
+//
+// Exits with 1 if any call count differs from the expected one. The
+// expected counts must be updated along with intentional changes to the
+// OpenGL calls of the measured paths.
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <string>
+
+#include "glfc/glfc.h"
+#include "glfc/framebuffer.h"
+
+namespace {
+
+// The OpenGL calls made by a single call of a benchmark keyed by function.
+typedef std::map<std::string, uint64_t> CallCounts;
+
+// The number of timed runs of each benchmark, the fastest one is reported.
+const int kNumberOfRuns = 5;
+
+// The width and height in points of the renders.
+const float kRenderSize = 256;
+
+// Returns the microseconds per call of the fastest of `kNumberOfRuns` runs
+// calling `function` `iterations` times each.
+double MeasureMicroseconds(const int iterations,
+                           const std::function<void()>& function) {
+  double fastest_time = 0;
+  for (int run = 0; run < kNumberOfRuns; ++run) {
+    const std::chrono::steady_clock::time_point kStartTime = \
+        std::chrono::steady_clock::now();
+    for (int iteration = 0; iteration < iterations; ++iteration)
+      function();
+    const double kTime = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - kStartTime).count() / iterations;
+    if (run == 0 || kTime < fastest_time)
+      fastest_time = kTime;
+  }
+  return fastest_time;
+}
+
+// Calls `function` once to record its OpenGL calls, then times it with
+// `iterations` calls per run and prints the result under `name`. Returns
+// `false` if the recorded calls differ from `expected_counts`, in which case
+// the differences are printed.
+bool RunBenchmark(const char* name, const int iterations,
+                  const CallCounts& expected_counts,
+                  const std::function<void()>& function) {
+  glfc::ResetNullGlCallCounts();
+  function();
+  const CallCounts kCounts = glfc::GetNullGlCallCounts();
+  const double kTime = MeasureMicroseconds(iterations, function);
+  uint64_t number_of_calls = 0;
+  for (const auto& count : kCounts)
+    number_of_calls += count.second;
+  std::printf("%-44s %9.3f us %4" PRIu64 " GL calls\n", name, kTime,
+              number_of_calls);
+  if (kCounts == expected_counts)
+    return true;
+
+  // Prints the functions whose counts differ, including missing ones.
+  CallCounts all_counts = expected_counts;
+  all_counts.insert(kCounts.begin(), kCounts.end());
+  for (const auto& count : all_counts) {
+    const auto kExpected = expected_counts.find(count.first);
+    const auto kActual = kCounts.find(count.first);
+    const uint64_t kExpectedCount = \
+        kExpected == expected_counts.end() ? 0 : kExpected->second;
+    const uint64_t kActualCount = \
+        kActual == kCounts.end() ? 0 : kActual->second;
+    if (kExpectedCount != kActualCount) {
+      std::printf("  CALL COUNT REGRESSION %s: %" PRIu64 " (expected %"
+                  PRIu64 ")\n", count.first.c_str(), kActualCount,
+                  kExpectedCount);
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+int main() {
+  bool passed = true;
+
+  // Shader generation. The filter is referenced as a `Filter` since the
+  // subclasses only expose the shaders through their base.
+  glfc::GaussianBlurFilter blur_filter;
+  blur_filter.set_sigma(4);
+  blur_filter.set_blur_radius(12);
+  const glfc::Filter& kFilter = blur_filter;
+  // The capabilities are queried on first use.
+  kFilter.GetFragmentShader();
+  passed &= RunBenchmark(
+      "GaussianBlurFilter::GetFragmentShader()", 2000, CallCounts(),
+      [&] { kFilter.GetFragmentShader(); });
+  passed &= RunBenchmark(
+      "GaussianBlurFilter::GetVertexShader()", 2000, CallCounts(),
+      [&] { kFilter.GetVertexShader(); });
+
+  // Rendering after the first render compiled the programs and allocated
+  // the framebuffers.
+  GLuint input_texture;
+  glGenTextures(1, &input_texture);
+  blur_filter.Render(input_texture, kRenderSize, kRenderSize, 1);
+  passed &= RunBenchmark(
+      "GaussianBlurFilter::Render()", 20000,
+      {{"glActiveTexture", 2},
+       {"glBindFramebuffer", 4},
+       {"glBindTexture", 4},
+       {"glBindVertexArray", 4},
+       {"glBlendFunc", 2},
+       {"glBlendFuncSeparate", 1},
+       {"glClear", 1},
+       {"glClearColor", 1},
+       {"glColorMask", 2},
+       {"glDrawElements", 2},
+       {"glEnable", 2},
+       {"glFlush", 2},
+       {"glGetIntegerv", 6},
+       {"glGetUniformLocation", 4},
+       {"glInvalidateFramebuffer", 1},
+       {"glIsEnabled", 1},
+       {"glUniform1f", 4},
+       {"glUniform1i", 2},
+       {"glUseProgram", 4},
+       {"glViewport", 1}},
+      [&] {
+        blur_filter.Render(input_texture, kRenderSize, kRenderSize, 1);
+      });
+
+  // Saving and restoring the binding and blending of the current
+  // framebuffer around a pass.
+  glfc::Framebuffer framebuffer(kRenderSize, kRenderSize);
+  framebuffer.Init();
+  passed &= RunBenchmark(
+      "Framebuffer::Bind() and Unbind()", 200000,
+      {{"glBindFramebuffer", 2},
+       {"glBlendFunc", 1},
+       {"glBlendFuncSeparate", 1},
+       {"glGetIntegerv", 5},
+       {"glIsEnabled", 1}},
+      [&] {
+        framebuffer.Bind();
+        framebuffer.Unbind();
+      });
+
+  if (!passed)
+    std::printf("The OpenGL calls changed, see above.\n");
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,283 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/trace.h"
+
+#ifdef GLFC_ENABLE_TRACING
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "glfc/opengl_hook.h"
+
+namespace {
+
+// The maximum number of recorded events. Later events are dropped so a
+// forgotten trace doesn't grow without bound.
+const size_t kMaxNumberOfEvents = 1 << 20;
+
+// The names of the call types in the trace, indexed by `TraceCallType`.
+const char* kCallTypeNames[glfc::kNumberOfTraceCallTypes] = {
+    "draw", "query", "readback", "resource", "state", "sync", "uniform",
+    "upload"};
+
+// A recorded event.
+struct Event {
+  // The counters of a frame event.
+  glfc::TraceCounters counters;
+  // The duration in microseconds of a scope event.
+  int64_t duration;
+  // Indicates whether this is a frame event or a scope event.
+  bool is_frame;
+  // The name of a scope event.
+  const char* name;
+  // The identifier of the recording thread.
+  int thread_id;
+  // The time in microseconds since the trace origin.
+  int64_t timestamp;
+};
+
+// The counters of the current frame, indexed by `TraceCallType`.
+std::atomic<uint64_t> call_counters[glfc::kNumberOfTraceCallTypes];
+
+// The number of bytes read back during the current frame.
+std::atomic<uint64_t> bytes_read_back_counter(0);
+
+// The number of bytes uploaded during the current frame.
+std::atomic<uint64_t> bytes_uploaded_counter(0);
+
+// The recorded events, guarded by `events_mutex`.
+std::vector<Event> events;
+
+// Guards `events`.
+std::mutex events_mutex;
+
+// The next identifier assigned to a recording thread.
+std::atomic<int> next_thread_id(1);
+
+// The origin of the timestamps.
+const std::chrono::steady_clock::time_point kOrigin = \
+    std::chrono::steady_clock::now();
+
+// Returns the identifier of the calling thread.
+int GetThreadId() {
+  thread_local const int kThreadId = next_thread_id++;
+  return kThreadId;
+}
+
+// Returns the number of microseconds between the trace origin and `time`.
+int64_t GetTimestamp(const std::chrono::steady_clock::time_point time) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+      time - kOrigin).count();
+}
+
+void RecordEvent(const Event& event) {
+  std::lock_guard<std::mutex> lock(events_mutex);
+  if (events.size() < kMaxNumberOfEvents)
+    events.push_back(event);
+}
+
+}  // namespace
+
+namespace glfc {
+
+TraceCounters::TraceCounters() : bytes_read_back(0), bytes_uploaded(0) {
+  for (uint64_t& count : calls)
+    count = 0;
+}
+
+uint64_t TraceCounters::total_calls() const {
+  uint64_t total = 0;
+  for (const uint64_t count : calls)
+    total += count;
+  return total;
+}
+
+void ClearTrace() {
+  {
+    std::lock_guard<std::mutex> lock(events_mutex);
+    events.clear();
+  }
+  EndTraceFrame();
+}
+
+TraceCounters EndTraceFrame() {
+  TraceCounters counters;
+  for (int type = 0; type < kNumberOfTraceCallTypes; ++type)
+    counters.calls[type] = call_counters[type].exchange(0);
+  counters.bytes_read_back = bytes_read_back_counter.exchange(0);
+  counters.bytes_uploaded = bytes_uploaded_counter.exchange(0);
+
+  Event event;
+  event.counters = counters;
+  event.duration = 0;
+  event.is_frame = true;
+  event.name = "Frame";
+  event.thread_id = GetThreadId();
+  event.timestamp = GetTimestamp(std::chrono::steady_clock::now());
+  RecordEvent(event);
+  return counters;
+}
+
+TraceCounters GetTraceCounters() {
+  TraceCounters counters;
+  for (int type = 0; type < kNumberOfTraceCallTypes; ++type)
+    counters.calls[type] = call_counters[type].load();
+  counters.bytes_read_back = bytes_read_back_counter.load();
+  counters.bytes_uploaded = bytes_uploaded_counter.load();
+  return counters;
+}
+
+bool WriteChromeTrace(const std::string& path) {
+  std::FILE* file = std::fopen(path.c_str(), "w");
+  if (file == nullptr)
+    return false;
+
+  std::lock_guard<std::mutex> lock(events_mutex);
+  std::fprintf(file, "{\"traceEvents\":[");
+  for (size_t index = 0; index < events.size(); ++index) {
+    const Event& event = events[index];
+    if (index > 0)
+      std::fprintf(file, ",");
+    if (!event.is_frame) {
+      std::fprintf(file,
+                   "\n{\"name\":\"%s\",\"cat\":\"glfc\",\"ph\":\"X\","
+                   "\"ts\":%lld,\"dur\":%lld,\"pid\":1,\"tid\":%d}",
+                   event.name, static_cast<long long>(event.timestamp),
+                   static_cast<long long>(event.duration), event.thread_id);
+      continue;
+    }
+
+    // A frame is recorded as an instant event marking its end and counter
+    // events plotting its calls and transferred bytes.
+    std::fprintf(file,
+                 "\n{\"name\":\"Frame\",\"cat\":\"glfc\",\"ph\":\"i\","
+                 "\"s\":\"g\",\"ts\":%lld,\"pid\":1,\"tid\":%d,"
+                 "\"args\":{\"total_calls\":%llu}}",
+                 static_cast<long long>(event.timestamp), event.thread_id,
+                 static_cast<unsigned long long>(
+                     event.counters.total_calls()));
+    std::fprintf(file,
+                 ",\n{\"name\":\"GL calls\",\"cat\":\"glfc\",\"ph\":\"C\","
+                 "\"ts\":%lld,\"pid\":1,\"args\":{",
+                 static_cast<long long>(event.timestamp));
+    for (int type = 0; type < kNumberOfTraceCallTypes; ++type) {
+      std::fprintf(file, "%s\"%s\":%llu", type > 0 ? "," : "",
+                   kCallTypeNames[type],
+                   static_cast<unsigned long long>(
+                       event.counters.calls[type]));
+    }
+    std::fprintf(file,
+                 "}},\n{\"name\":\"GL bytes\",\"cat\":\"glfc\",\"ph\":\"C\","
+                 "\"ts\":%lld,\"pid\":1,\"args\":{\"uploaded\":%llu,"
+                 "\"read_back\":%llu}}",
+                 static_cast<long long>(event.timestamp),
+                 static_cast<unsigned long long>(
+                     event.counters.bytes_uploaded),
+                 static_cast<unsigned long long>(
+                     event.counters.bytes_read_back));
+  }
+  std::fprintf(file, "\n]}\n");
+  return std::fclose(file) == 0;
+}
+
+TraceScope::TraceScope(const char* name)
+    : name_(name), start_time_(std::chrono::steady_clock::now()) {
+}
+
+TraceScope::~TraceScope() {
+  const std::chrono::steady_clock::time_point kEndTime = \
+      std::chrono::steady_clock::now();
+  Event event;
+  event.duration = std::chrono::duration_cast<std::chrono::microseconds>(
+      kEndTime - start_time_).count();
+  event.is_frame = false;
+  event.name = name_;
+  event.thread_id = GetThreadId();
+  event.timestamp = GetTimestamp(start_time_);
+  RecordEvent(event);
+}
+
+namespace internal {
+
+size_t GetPixelDataSize(const int width, const int height, const int depth,
+                        const unsigned int format, const unsigned int type) {
+  int number_of_components;
+  switch (format) {
+#ifndef GLFC_GL3  // the luminance formats were removed from the core profile
+    case GL_ALPHA:
+    case GL_LUMINANCE:
+#endif
+#ifdef GLFC_GL3_API
+    case GL_RED:
+#endif
+      number_of_components = 1;
+      break;
+#ifndef GLFC_GL3
+    case GL_LUMINANCE_ALPHA:
+#endif
+#ifdef GLFC_GL3_API
+    case GL_RG:
+#endif
+      number_of_components = 2;
+      break;
+    case GL_RGB:
+      number_of_components = 3;
+      break;
+    default:
+      number_of_components = 4;
+  }
+  int bytes_per_pixel;
+  switch (type) {
+    case GL_UNSIGNED_SHORT_5_6_5:
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_5_5_5_1:
+      bytes_per_pixel = 2;
+      break;
+    case GL_FLOAT:
+      bytes_per_pixel = number_of_components * 4;
+      break;
+    default:
+      bytes_per_pixel = number_of_components;
+  }
+  return static_cast<size_t>(width) * height * depth * bytes_per_pixel;
+}
+
+void TraceGlCall(const TraceCallType type, const size_t bytes_uploaded,
+                 const size_t bytes_read_back) {
+  call_counters[type].fetch_add(1, std::memory_order_relaxed);
+  if (bytes_uploaded > 0) {
+    bytes_uploaded_counter.fetch_add(bytes_uploaded,
+                                     std::memory_order_relaxed);
+  }
+  if (bytes_read_back > 0) {
+    bytes_read_back_counter.fetch_add(bytes_read_back,
+                                      std::memory_order_relaxed);
+  }
+}
+
+}  // namespace internal
+
+}  // namespace glfc
+
+#endif  // GLFC_ENABLE_TRACING
@@ -0,0 +1,147 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+//
+// Opt-in instrumentation of the OpenGL calls made by glfc through
+// `opengl_hook.h`. Tracing is enabled by defining `GLFC_ENABLE_TRACING`, e.g.
+// with the CMake option of the same name, which also defines
+// `GLFC_TRACE_GL_CALLS` when compiling glfc to wrap its OpenGL calls.
+// Otherwise nothing here is compiled and `GLFC_TRACE_SCOPE()` expands to
+// nothing.
+//
+// When enabled, every wrapped GL call is counted by type along with the bytes
+// uploaded and read back. The counters accumulate until `EndTraceFrame()`
+// is called, which also records them in the trace. Scopes marked with
+// `GLFC_TRACE_SCOPE()` are recorded with CPU timestamps, so they measure the
+// time spent issuing commands rather than the GPU execution time. The trace
+// can be written as a JSON file loadable by Chrome's about:tracing.
+
+#ifndef GLFC_TRACE_H_
+#define GLFC_TRACE_H_
+
+#ifdef GLFC_ENABLE_TRACING
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "glfc/base.h"
+
+namespace glfc {
+
+// The categories of traced OpenGL calls.
+enum TraceCallType {
+  // Draws and clears.
+  kTraceCallTypeDraw,
+  // Queries that may stall the pipeline, such as `glGetIntegerv()`.
+  kTraceCallTypeQuery,
+  // Transfers from GPU memory, i.e. `glReadPixels()`.
+  kTraceCallTypeReadback,
+  // Creation and deletion of objects, including shader compilation.
+  kTraceCallTypeResource,
+  // State changes such as bindings, blending and texture parameters.
+  kTraceCallTypeState,
+  // Synchronization such as `glFinish()` and fences.
+  kTraceCallTypeSync,
+  // Uniform updates.
+  kTraceCallTypeUniform,
+  // Transfers to GPU memory, such as `glTexImage2D()` and `glBufferData()`.
+  kTraceCallTypeUpload,
+  // The number of call types.
+  kNumberOfTraceCallTypes,
+};
+
+// The GL activity accumulated during a frame.
+struct TraceCounters {
+  TraceCounters();
+
+  // Returns the number of calls of all types.
+  uint64_t total_calls() const;
+
+  // The number of bytes transferred from GPU memory.
+  uint64_t bytes_read_back;
+
+  // The number of bytes transferred to GPU memory. Pixels uploaded through a
+  // pixel buffer object are counted when the buffer is mapped for writing.
+  uint64_t bytes_uploaded;
+
+  // The number of calls indexed by `TraceCallType`.
+  uint64_t calls[kNumberOfTraceCallTypes];
+};
+
+// Discards the recorded events and resets the counters.
+void ClearTrace();
+
+// Ends the current frame. Returns its counters, records them in the trace
+// and resets them for the next frame.
+TraceCounters EndTraceFrame();
+
+// Returns the counters of the current frame.
+TraceCounters GetTraceCounters();
+
+// Writes the recorded events as a Chrome trace JSON file at `path`. Returns
+// `false` on failure.
+bool WriteChromeTrace(const std::string& path);
+
+// Records the lifetime of an instance as a trace event named `name`, which
+// must be a string literal. Use the `GLFC_TRACE_SCOPE()` macro instead of
+// this class directly.
+class TraceScope {
+ public:
+  explicit TraceScope(const char* name);
+  ~TraceScope();
+
+ private:
+  // The name of the event.
+  const char* name_;
+
+  // The time the scope began.
+  std::chrono::steady_clock::time_point start_time_;
+
+  GLFC_DISALLOW_COPY_AND_ASSIGN(TraceScope);
+};
+
+namespace internal {
+
+// Returns the number of bytes of pixel data with the dimension, `format` and
+// `type` passed to the GL transfer functions.
+size_t GetPixelDataSize(const int width, const int height, const int depth,
+                        const unsigned int format, const unsigned int type);
+
+// Counts a GL call of `type` transferring the given number of bytes.
+void TraceGlCall(const TraceCallType type, const size_t bytes_uploaded,
+                 const size_t bytes_read_back);
+
+}  // namespace internal
+
+}  // namespace glfc
+
+#define GLFC_TRACE_CONCATENATE_(first, second) first##second
+#define GLFC_TRACE_CONCATENATE(first, second) \
+  GLFC_TRACE_CONCATENATE_(first, second)
+
+// Records the enclosing scope as a trace event named `name`.
+#define GLFC_TRACE_SCOPE(name) \
+  ::glfc::TraceScope GLFC_TRACE_CONCATENATE(glfc_trace_scope_, __LINE__)(name)
+
+#else  // GLFC_ENABLE_TRACING
+
+#define GLFC_TRACE_SCOPE(name)
+
+#endif  // GLFC_ENABLE_TRACING
+
+#endif  // GLFC_TRACE_H_
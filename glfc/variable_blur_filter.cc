@@ -0,0 +1,217 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/variable_blur_filter.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/framebuffer.h"
+#include "glfc/gaussian_blur_pyramid.h"
+#include "glfc/opengl_hook.h"
+#include "glfc/program.h"
+
+namespace {
+
+// The texture unit of the first level. The other levels follow.
+const int kFirstLevelTextureUnit = 1;
+
+// The maximum number of levels, which keeps the input, the levels and the
+// radius map within the 8 texture units guaranteed by OpenGL ES 2.
+const int kMaxNumberOfLevels = 6;
+
+// The sigma in pixels below which a level is dropped. Smaller blurs are
+// approximated by blending the input with the first level.
+const float kMinLevelSigma = 0.5;
+
+const char* kVertexShader = R"(
+attribute vec4 position;
+attribute vec2 inputTextureCoordinate;
+varying vec2 textureCoordinate;
+
+void main() {
+  gl_Position = position;
+  textureCoordinate = inputTextureCoordinate;
+})";
+
+// Returns the GLSL float literal of `value`.
+std::string ToLiteral(const float value) {
+  return std::to_string(value);
+}
+
+}  // namespace
+
+namespace glfc {
+
+VariableBlurFilter::VariableBlurFilter()
+    : max_sigma_(8), pyramid_(new GaussianBlurPyramid), radius_map_(0),
+      should_update_shaders_(true) {
+  UpdateLevelSigmas();
+}
+
+VariableBlurFilter::~VariableBlurFilter() {
+}
+
+bool VariableBlurFilter::ApplyFilterToFramebuffer(const GLuint input_texture,
+                                                  Program* program,
+                                                  Framebuffer* framebuffer) {
+  should_update_shaders_ = false;
+  const int kNumberOfLevels = static_cast<int>(level_sigmas_.size());
+  if (radius_map_ != 0 && kNumberOfLevels > 0) {
+    const float kDevicePixelRatio = device_pixel_ratio();
+    pyramid_->set_sigmas(level_sigmas_);
+    if (!pyramid_->Render(input_texture,
+                          framebuffer->width() / kDevicePixelRatio,
+                          framebuffer->height() / kDevicePixelRatio,
+                          kDevicePixelRatio)) {
+#ifdef DEBUG
+      GLFC_LOG("!! Failed to render the variable blur pyramid.\n");
+#endif
+      return false;
+    }
+  }
+
+  // Without a radius map, the levels stay unbound and get no weight.
+  const int kRadiusMapTextureUnit = kFirstLevelTextureUnit + kNumberOfLevels;
+  if (radius_map_ != 0) {
+    for (int index = 0; index < kNumberOfLevels; ++index) {
+      glActiveTexture(GL_TEXTURE0 + kFirstLevelTextureUnit + index);
+      glBindTexture(GL_TEXTURE_2D, pyramid_->GetLevelTexture(index));
+    }
+    glActiveTexture(GL_TEXTURE0 + kRadiusMapTextureUnit);
+    glBindTexture(GL_TEXTURE_2D, radius_map_);
+    glActiveTexture(GL_TEXTURE0);
+  }
+  const bool kResult = Filter::ApplyFilterToFramebuffer(input_texture,
+                                                       program, framebuffer);
+  if (radius_map_ != 0) {
+    for (int unit = kFirstLevelTextureUnit; unit <= kRadiusMapTextureUnit;
+         ++unit) {
+      glActiveTexture(GL_TEXTURE0 + unit);
+      glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    glActiveTexture(GL_TEXTURE0);
+  }
+  return kResult;
+}
+
+std::string VariableBlurFilter::GetFragmentShader() const {
+  std::string shader = R"(
+precision mediump float;
+uniform sampler2D inputImageTexture;
+uniform sampler2D radiusMapTexture;
+varying vec2 textureCoordinate;
+)";
+  const int kNumberOfLevels = static_cast<int>(level_sigmas_.size());
+  for (int index = 0; index < kNumberOfLevels; ++index)
+    shader += "uniform sampler2D levelTexture" + std::to_string(index) + ";\n";
+  shader += R"(
+void main() {
+  vec4 color = texture2D(inputImageTexture, textureCoordinate);)";
+  if (kNumberOfLevels == 0) {
+    shader += "\n  gl_FragColor = color;\n}";
+    return shader;
+  }
+
+  // Each level, including the input at sigma 0, is weighted by a hat
+  // function peaking at its sigma and reaching 0 at the sigmas of its
+  // neighbors, so the weights of any sigma sum to 1.
+  shader += R"(
+  float sigma = texture2D(radiusMapTexture, textureCoordinate).r * )" +
+            ToLiteral(max_sigma_) + R"(;
+  color *= clamp(1.0 - sigma / )" + ToLiteral(level_sigmas_[0]) +
+            ", 0.0, 1.0);";
+  for (int index = 0; index < kNumberOfLevels; ++index) {
+    const float kLowerSigma = index == 0 ? 0 : level_sigmas_[index - 1];
+    const float kSigma = level_sigmas_[index];
+    std::string weight = "(sigma - " + ToLiteral(kLowerSigma) + ") / " +
+                         ToLiteral(kSigma - kLowerSigma);
+    if (index + 1 < kNumberOfLevels) {
+      const float kUpperSigma = level_sigmas_[index + 1];
+      weight = "min(" + weight + ", (" + ToLiteral(kUpperSigma) +
+               " - sigma) / " + ToLiteral(kUpperSigma - kSigma) + ")";
+    }
+    shader += "\n  color += texture2D(levelTexture" + std::to_string(index) +
+              ", textureCoordinate) *\n           clamp(" + weight +
+              ", 0.0, 1.0);";
+  }
+  shader += "\n  gl_FragColor = color;\n}";
+  return shader;
+}
+
+std::vector<float> VariableBlurFilter::GetLevelSigmas(
+    const float device_pixel_ratio) const {
+  std::vector<float> sigmas;
+  for (float sigma = max_sigma_;
+       sigmas.size() < kMaxNumberOfLevels &&
+       sigma * device_pixel_ratio >= kMinLevelSigma;
+       sigma /= 2) {
+    sigmas.push_back(sigma);
+  }
+  std::reverse(sigmas.begin(), sigmas.end());
+  return sigmas;
+}
+
+std::string VariableBlurFilter::GetVertexShader() const {
+  return kVertexShader;
+}
+
+void VariableBlurFilter::SetUniforms(Program* program) const {
+  const int kNumberOfLevels = static_cast<int>(level_sigmas_.size());
+  for (int index = 0; index < kNumberOfLevels; ++index) {
+    const std::string kName = "levelTexture" + std::to_string(index);
+    glUniform1i(glGetUniformLocation(program->program(), kName.c_str()),
+                kFirstLevelTextureUnit + index);
+  }
+  glUniform1i(glGetUniformLocation(program->program(), "radiusMapTexture"),
+              kFirstLevelTextureUnit + kNumberOfLevels);
+}
+
+bool VariableBlurFilter::ShouldUpdateShaders() const {
+  return should_update_shaders_;
+}
+
+void VariableBlurFilter::UpdateLevelSigmas() {
+  const std::vector<float> kLevelSigmas = \
+      GetLevelSigmas(device_pixel_ratio());
+  if (kLevelSigmas != level_sigmas_) {
+    level_sigmas_ = kLevelSigmas;
+    should_update_shaders_ = true;
+  }
+}
+
+void VariableBlurFilter::set_device_pixel_ratio(const float ratio) {
+  if (ratio != device_pixel_ratio()) {
+    Filter::set_device_pixel_ratio(ratio);
+    UpdateLevelSigmas();
+  }
+}
+
+void VariableBlurFilter::set_max_sigma(const float max_sigma) {
+  if (max_sigma != max_sigma_) {
+    max_sigma_ = max_sigma;
+    // The maximum sigma is baked into the shader along with the levels.
+    level_sigmas_ = GetLevelSigmas(device_pixel_ratio());
+    should_update_shaders_ = true;
+    InvalidateCache();
+  }
+}
+
+}  // namespace glfc
@@ -0,0 +1,118 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_VARIABLE_BLUR_FILTER_H_
+#define GLFC_VARIABLE_BLUR_FILTER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glfc/base.h"
+#include "glfc/filter.h"
+#include "glfc/opengl_hook.h"
+
+namespace glfc {
+
+class GaussianBlurPyramid;
+
+// This class blurs each pixel by its own amount read from a radius map, such
+// as for depth of field effects where the blur grows with the distance from
+// the focal plane.
+//
+// The input is first blurred into a `GaussianBlurPyramid` whose sigmas
+// double from level to level up to `max_sigma()`, which downsamples the wide
+// levels. Each output pixel then reads its sigma from the radius map and
+// blends the two levels whose sigmas enclose it, where the input itself
+// serves as the level of sigma 0. Together with the bilinear filtering
+// within the levels, this is a trilinear lookup in a Gaussian mip pyramid.
+// All levels are sampled for every pixel so the cost doesn't depend on the
+// radius map, and the cost of the pyramid is close to the one of a single
+// blur of `max_sigma()`.
+//
+// Blending two Gaussians isn't exactly a Gaussian of the intermediate sigma,
+// but the difference isn't noticeable for focus effects.
+class VariableBlurFilter : public Filter {
+ public:
+  VariableBlurFilter();
+  ~VariableBlurFilter();
+
+  // Inherited from `Filter` class.
+  std::string GetFragmentShader() const final;
+
+  // Returns the sigma in points of each level of the pyramid for
+  // `device_pixel_ratio`, excluding the input itself.
+  std::vector<float> GetLevelSigmas(const float device_pixel_ratio) const;
+
+  // Inherited from `Filter` class.
+  std::string GetVertexShader() const final;
+
+  // Setters and accessors.
+  float max_sigma() const { return max_sigma_; }
+  void set_max_sigma(const float max_sigma);
+  GLuint radius_map() const { return radius_map_; }
+  // The red channel of the radius map scales `max_sigma()` for each pixel.
+  // The map is sampled with the texture coordinates of the input so it must
+  // cover the same area. Without a radius map, the input is drawn as is.
+  void set_radius_map(const GLuint radius_map) {
+    radius_map_ = radius_map;
+    InvalidateCache();
+  }
+
+ protected:
+  // Inherited from `Filter` class.
+  void set_device_pixel_ratio(const float ratio) final;
+
+ private:
+  // Inherited from `Filter` class.
+  bool ApplyFilterToFramebuffer(const GLuint input_texture, Program* program,
+                                Framebuffer* framebuffer) final;
+
+  // Inherited from `Filter` class.
+  void SetUniforms(Program* program) const final;
+
+  // Inherited from `Filter` class.
+  bool ShouldUpdateShaders() const final;
+
+  // Updates `level_sigmas_` for the current parameters and regenerates the
+  // shaders if they changed.
+  void UpdateLevelSigmas();
+
+  // The sigma in points of each level of the pyramid, which is baked into
+  // the fragment shader.
+  std::vector<float> level_sigmas_;
+
+  // The sigma in points of the pixels whose radius map value is 1. The
+  // default value is 8.
+  float max_sigma_;
+
+  // The pyramid holding the blurred levels.
+  std::unique_ptr<GaussianBlurPyramid> pyramid_;
+
+  // The weak reference to the radius map texture. The default value is 0.
+  GLuint radius_map_;
+
+  // Indicates whether the shaders should be regenerated because the levels
+  // changed.
+  bool should_update_shaders_;
+
+  GLFC_DISALLOW_COPY_AND_ASSIGN(VariableBlurFilter);
+};
+
+}  // namespace glfc
+
+#endif  // GLFC_VARIABLE_BLUR_FILTER_H_
@@ -0,0 +1,132 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#include "glfc/yuv.h"
+
+#include <cstdio>
+#include <string>
+
+#include "glfc/capabilities.h"
+#include "glfc/opengl_hook.h"
+#include "glfc/program.h"
+
+namespace {
+
+// The conversion is done with the `yuvMatrix` and `yuvOffset` uniforms so
+// switching color spaces or ranges doesn't require recompiling the program.
+// Each sample is clamped to keep the result identical to converting first.
+const char* kNV12SamplingShader = R"(
+uniform sampler2D chromaTexture;
+uniform mat3 yuvMatrix;
+uniform vec3 yuvOffset;
+
+vec4 sampleInput(vec2 coordinate) {
+  vec3 yuv = vec3(texture2D(inputImageTexture, coordinate).r,
+                  texture2D(chromaTexture, coordinate).%s);
+  return vec4(clamp(yuvMatrix * (yuv - yuvOffset), 0.0, 1.0), 1.0);
+})";
+
+const char* kI420SamplingShader = R"(
+uniform sampler2D chromaTexture;
+uniform sampler2D chromaVTexture;
+uniform mat3 yuvMatrix;
+uniform vec3 yuvOffset;
+
+vec4 sampleInput(vec2 coordinate) {
+  vec3 yuv = vec3(texture2D(inputImageTexture, coordinate).r,
+                  texture2D(chromaTexture, coordinate).r,
+                  texture2D(chromaVTexture, coordinate).r);
+  return vec4(clamp(yuvMatrix * (yuv - yuvOffset), 0.0, 1.0), 1.0);
+})";
+
+// Returns the swizzle of the U and V samples in an interleaved chroma plane,
+// which is a `GL_LUMINANCE_ALPHA` texture on contexts without `GL_RG`
+// textures.
+const char* GetChromaSwizzle() {
+#if defined GLFC_GL3_API
+  return glfc::GetCapabilities().supports_red_textures ? "rg" : "ra";
+#elif defined GLFC_GLES2
+  return "ra";
+#else
+  return "rg";
+#endif
+}
+
+}  // namespace
+
+namespace glfc {
+
+std::string GetYuvSamplingShader(const YuvFormat format) {
+  if (format == kYuvFormatI420)
+    return kI420SamplingShader;
+
+  const char* kChromaSwizzle = GetChromaSwizzle();
+  const int kLength = snprintf(NULL, 0, kNV12SamplingShader,
+                               kChromaSwizzle) + 1;
+  char shader[kLength];
+  snprintf(shader, kLength, kNV12SamplingShader, kChromaSwizzle);
+  return shader;
+}
+
+void SetYuvUniforms(const YuvInput& input, Program* program) {
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, input.u_texture);
+  glUniform1i(glGetUniformLocation(program->program(), "chromaTexture"), 1);
+  if (input.format == kYuvFormatI420) {
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, input.v_texture);
+    glUniform1i(glGetUniformLocation(program->program(), "chromaVTexture"),
+                2);
+  }
+  glActiveTexture(GL_TEXTURE0);
+
+  // The luma and chroma weights of the color space.
+  const float kRed = input.color_space == kYuvColorSpaceBT709 ? 0.2126 : 0.299;
+  const float kBlue = input.color_space == kYuvColorSpaceBT709 ? 0.0722 : 0.114;
+  const float kGreen = 1 - kRed - kBlue;
+
+  // The scales expanding video range samples to full range.
+  const bool kIsFullRange = input.range == kYuvRangeFull;
+  const float kLumaScale = kIsFullRange ? 1 : 255.0 / 219.0;
+  const float kChromaScale = kIsFullRange ? 1 : 255.0 / 224.0;
+
+  // Column-major matrix mapping (Y, U, V) to (R, G, B).
+  const GLfloat kMatrix[9] = {
+      kLumaScale, kLumaScale, kLumaScale,
+      0, -2 * kBlue * (1 - kBlue) / kGreen * kChromaScale,
+      2 * (1 - kBlue) * kChromaScale,
+      2 * (1 - kRed) * kChromaScale,
+      -2 * kRed * (1 - kRed) / kGreen * kChromaScale, 0};
+  const GLfloat kOffset[3] = {kIsFullRange ? 0 : 16.0f / 255,
+                              128.0f / 255, 128.0f / 255};
+  glUniformMatrix3fv(glGetUniformLocation(program->program(), "yuvMatrix"),
+                     1, GL_FALSE, kMatrix);
+  glUniform3fv(glGetUniformLocation(program->program(), "yuvOffset"), 1,
+               kOffset);
+}
+
+void UnbindYuvTextures(const YuvInput& input) {
+  if (input.format == kYuvFormatI420) {
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, 0);
+  }
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+}
+
+}  // namespace glfc
@@ -0,0 +1,92 @@
+// Copyright (c) 2015 Ollix. All rights reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// ---
+// Author: olliwang@ollix.com (Olli Wang)
+
+#ifndef GLFC_YUV_H_
+#define GLFC_YUV_H_
+
+#include <string>
+
+#include "glfc/base.h"
+#include "glfc/opengl_hook.h"
+
+namespace glfc {
+
+class Program;
+
+// The plane layouts of supported YUV inputs.
+enum YuvFormat {
+  // A full resolution Y plane followed by a half resolution plane of
+  // interleaved U and V samples. On OpenGL ES 2.0 contexts the chroma plane
+  // must be a `GL_LUMINANCE_ALPHA` texture, otherwise a `GL_RG8` texture.
+  kYuvFormatNV12,
+  // A full resolution Y plane followed by separate half resolution U and V
+  // planes.
+  kYuvFormatI420,
+};
+
+// The matrices for converting YUV to RGB.
+enum YuvColorSpace {
+  kYuvColorSpaceBT601,
+  kYuvColorSpaceBT709,
+};
+
+// The value ranges of the YUV samples.
+enum YuvRange {
+  // Y ranges from 16 to 235 and chroma ranges from 16 to 240.
+  kYuvRangeVideo,
+  // All samples range from 0 to 255.
+  kYuvRangeFull,
+};
+
+// Describes a planar YUV input. Single-channel planes can either be
+// `GL_LUMINANCE` or `GL_R8` textures. All textures should use linear
+// filtering so the chroma planes are upsampled while sampling.
+struct YuvInput {
+  YuvInput() : color_space(kYuvColorSpaceBT601), format(kYuvFormatNV12),
+               range(kYuvRangeVideo), u_texture(0), v_texture(0),
+               y_texture(0) {}
+
+  YuvColorSpace color_space;
+  YuvFormat format;
+  YuvRange range;
+
+  // The U plane texture, or the interleaved UV plane texture for NV12.
+  GLuint u_texture;
+
+  // The V plane texture. This is ignored for NV12.
+  GLuint v_texture;
+
+  // The Y plane texture.
+  GLuint y_texture;
+};
+
+// Returns the fragment shader source defining the
+// `vec4 sampleInput(vec2 coordinate)` function, which samples the planes of
+// `format` at `coordinate` and converts them to RGB. The Y plane is sampled
+// from the `inputImageTexture` uniform that must be declared before.
+std::string GetYuvSamplingShader(const YuvFormat format);
+
+// Binds the chroma planes of `input` to texture units 1 and 2 and sets the
+// uniforms declared by `GetYuvSamplingShader()`. The program must be in use.
+void SetYuvUniforms(const YuvInput& input, Program* program);
+
+// Unbinds the textures binded by `SetYuvUniforms()`.
+void UnbindYuvTextures(const YuvInput& input);
+
+}  // namespace glfc
+
+#endif  // GLFC_YUV_H_